@@ -1,27 +1,25 @@
 #include "stdlib.h"
 
-int main(char* args) {
-    if (!args) {
+int main(int argc, char** argv) {
+    if (argc < 2) {
         print("Usage: cat <filename>\n");
         return 1;
     }
 
-    int fd = open(args);
-    if (fd == -1) {
+    FILE* f = fopen(argv[1], "r");
+    if (!f) {
         print("Error: File not found.\n");
         return 1;
     }
 
-    char buf[64]; // Small buffer to test chunking
-    int bytes;
-    
+    char line[256];
+
     print("\n");
-    while ((bytes = read(fd, buf, 63)) > 0) {
-        buf[bytes] = 0; // Null terminate
-        print(buf);
+    while (fgets(line, sizeof(line), f)) {
+        print(line);
     }
     print("\n");
 
-    close(fd);
+    fclose(f);
     return 0;
-}
\ No newline at end of file
+}
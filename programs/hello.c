@@ -7,16 +7,15 @@ int main() {
     
     print("Type something (q to quit):\n");
 
+    // Raw mode so 'q' takes effect without Enter; the TTY echoes for us
+    int old_mode = tty_mode(TTY_ECHO);
     while(1) {
         char c = get_char();
         if (c == 'q') {
             break; // Break loop to exit
         }
-        if (c != 0) {
-            char temp[2] = {c, 0};
-            print(temp); // Echo back
-        }
     }
+    tty_mode(old_mode);
 
     print("\nGoodbye from User Space!\n");
     return 0; // This will trigger entry.S to call exit()
@@ -10,7 +10,7 @@ char* filename;
 
 void draw_ui() {
     clear_screen();
-    print("--- KEDIT: %s (Ctrl+S/tilde to Save, Ctrl+Q/backtick to Quit) ---\n\n", filename);
+    printf("--- KEDIT: %s (Ctrl+S/tilde to Save, Ctrl+Q/backtick to Quit) ---\n\n", filename);
     for(int i=0; i <= buffer_size; i++) {
         if (i == cursor_pos) print("|");
         if (i < buffer_size) {
@@ -63,6 +63,9 @@ int main(int argc, char** argv) {
         buffer_size = 0;
     }
 
+    // Full-screen: every key straight through, we draw the echo ourselves
+    int old_mode = tty_mode(0);
+
     while(1) {
         draw_ui();
         char c = get_char();
@@ -92,6 +95,7 @@ int main(int argc, char** argv) {
         }
     }
     
+    tty_mode(old_mode);
     free(file_buffer);
     clear_screen();
     return 0;
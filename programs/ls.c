@@ -1,16 +1,33 @@
 #include "stdlib.h"
 
-int main() {
-    char name[32];
-    int idx = 0;
+int main(int argc, char** argv) {
+    const char* path = (argc > 1) ? argv[1] : ".";
+    static char buf[4096];
 
-    print("\n--- Files ---\n"); // printf -> print
-    while (readdir(idx, name) == 1) {
-        print(" - ");
-        print(name);
-        print("\n");
-        idx++;
+    int fd = open(path);
+    if (fd < 0) {
+        print("ls: cannot open directory\n");
+        return 1;
+    }
+
+    print("\n--- Files ---\n");
+    int n;
+    while ((n = getdents(fd, buf, sizeof(buf))) > 0) {
+        for (int off = 0; off < n; ) {
+            dirent_t* d = (dirent_t*)(buf + off);
+            print(" - ");
+            print(d->name);
+            if (d->type == DT_DIR) print("/");
+            print("\n");
+            off += d->reclen;
+        }
     }
     print("-------------\n");
+
+    close(fd);
+    if (n < 0) {
+        print("ls: not a directory\n");
+        return 1;
+    }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,50 @@
+/* programs/spawnbench.c */
+#include "stdlib.h"
+
+// Spawn latency benchmark: spawn() + wait() of a child that exits at once.
+// The child is this same program started with "-child".
+
+#define ITERATIONS 50
+
+static int is_child(int argc, char** argv) {
+    if (argc < 2) return 0;
+    const char* a = argv[1];
+    return a[0] == '-' && a[1] == 'c' && a[2] == 'h' && a[3] == 'i' &&
+           a[4] == 'l' && a[5] == 'd' && a[6] == 0;
+}
+
+// Wall time of one spawn + wait round trip, in ns (0 on failure)
+static uint32_t spawn_once(const char* self) {
+    char* child_argv[] = { (char*)self, "-child", 0 };
+    uint64_t start = clock_ns();
+    int pid = spawn(self, child_argv);
+    if (pid < 0) return 0;
+    wait(pid, 0);
+    return (uint32_t)(clock_ns() - start);
+}
+
+int main(int argc, char** argv) {
+    if (is_child(argc, argv)) return 0;
+    const char* self = (argc > 0) ? argv[0] : "spawnbench.elf";
+
+    print("\n--- Spawn Latency ---\n");
+
+    // First run pays for the image cache and empty pools
+    uint32_t cold = spawn_once(self);
+    if (!cold) {
+        print("spawn failed\n");
+        return 1;
+    }
+
+    uint32_t best = 0xFFFFFFFF, total = 0;
+    for (int i = 0; i < ITERATIONS; i++) {
+        uint32_t ns = spawn_once(self);
+        total += ns;
+        if (ns < best) best = ns;
+    }
+
+    printf("cold : %d us\n", cold / 1000);
+    printf("warm : %d us avg, %d us best (%d runs)\n", total / ITERATIONS / 1000, best / 1000, ITERATIONS);
+    print("---------------------\n");
+    return 0;
+}
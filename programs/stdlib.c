@@ -3,111 +3,344 @@
 #include <stdint.h>
 #include <stdarg.h> // GCC builtin for varargs
 
+// --- System Call Entry ---
+// SYSENTER skips the IDT gate, the full segment reload and IRET. We use it
+// whenever the CPU supports it; int $0x80 remains the fallback.
+// -1 = not probed yet, 0 = int $0x80, 1 = sysenter
+static int syscall_fast = -1;
+
+static int probe_sysenter() {
+	uint32_t a, b, c, d;
+	__asm__ volatile ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(1), "c"(0));
+	if (!(d & (1 << 11))) return 0;
+	// Early Pentium Pro reports SEP without implementing it
+	uint32_t family = (a >> 8) & 0xF, model = (a >> 4) & 0xF, stepping = a & 0xF;
+	if (family == 6 && model < 3 && stepping < 3) return 0;
+	return 1;
+}
+
+int syscall_use_sysenter(int enable) {
+	if (enable) syscall_fast = probe_sysenter();
+	else syscall_fast = 0;
+	return syscall_fast;
+}
+
+int syscall(int num, int a, int b, int c) {
+	int ret;
+	if (syscall_fast < 0) syscall_fast = probe_sysenter();
+
+	if (syscall_fast) {
+		// Kernel contract: EBP = our ESP, ESI = where SYSEXIT should land.
+		// SYSEXIT returns through ECX/EDX, so both are clobbered.
+		__asm__ volatile (
+			"push %%ebp\n"
+			"call 2f\n"
+			"2: pop %%esi\n"
+			"add $1f-2b, %%esi\n"
+			"mov %%esp, %%ebp\n"
+			"sysenter\n"
+			"1: pop %%ebp\n"
+			: "=a"(ret), "+b"(a), "+c"(b), "+d"(c)
+			: "a"(num)
+			: "esi", "memory", "cc");
+	} else {
+		__asm__ volatile ("int $0x80"
+			: "=a"(ret), "+b"(a), "+c"(b), "+d"(c)
+			: "a"(num)
+			: "memory", "cc");
+	}
+	return ret;
+}
+
 // --- System Call Wrappers ---
 
 // 0: PRINT
 void print(const char* msg) {
-	__asm__ volatile ("int $0x80" : : "a" (0), "b" (msg)); 
+	syscall(0, (int)msg, 0, 0);
 }
 
 // 1: YIELD
 void yield() {
-	__asm__ volatile ("int $0x80" : : "a" (1)); 
+	syscall(1, 0, 0, 0);
 }
 
 // 2: READ CHAR
 char get_char() {
-	char c;
-	__asm__ volatile ("int $0x80" : "=a" (c) : "a" (2)); 
-	return c;
+	return (char)syscall(2, 0, 0, 0);
+}
+
+int get_char_timeout(int ms) {
+	if (ms <= 0) ms = 1;
+	int c = syscall(2, ms, 0, 0);
+	return c < 0 ? -1 : (c & 0xFF);
 }
 
 // 3: EXIT
 void exit(int code) {
-	__asm__ volatile ("int $0x80" : : "a" (3), "b"(code)); 
+	syscall(3, code, 0, 0);
 	while(1);
 }
 
+// 4: WAIT
+int wait(int pid, int* status) {
+	return syscall(4, pid, (int)status, 0);
+}
+
+int wait_timeout(int pid, int* status, int ms) {
+	if (ms <= 0) ms = 1;
+	return syscall(4, pid, (int)status, ms);
+}
+
 // 5: OPEN
 int open(const char* filename) {
-	int ret;
-	__asm__ volatile ("int $0x80" : "=a"(ret) : "a"(5), "b"(filename));
-	return ret;
+	return syscall(5, (int)filename, 0, 0);
 }
 
 // 6: CLOSE
 void close(int fd) {
-	__asm__ volatile ("int $0x80" : : "a"(6), "b"(fd));
+	syscall(6, fd, 0, 0);
 }
 
 // 7: READ
 int read(int fd, char* buf, int size) {
-	int ret;
-	__asm__ volatile ("int $0x80" : "=a"(ret) : "a"(7), "b"(fd), "c"(buf), "d"(size));
-	return ret;
+	return syscall(7, fd, (int)buf, size);
 }
 
 // 8: READDIR
 int readdir(int index, char* buf) {
-	int ret;
-	__asm__ volatile ("int $0x80" : "=a"(ret) : "a"(8), "b"(index), "c"(buf));
-	return ret;
+	return syscall(8, index, (int)buf, 0);
 }
 
 // 9: SBRK
 void* sbrk(int incr) {
-	int ret;
-	__asm__ volatile ("int $0x80" : "=a"(ret) : "a"(9), "b"(incr));
-	return (void*)ret;
+	return (void*)syscall(9, incr, 0, 0);
 }
 
-// 10: TIME
-void get_time(time_t* t) {
-	__asm__ volatile ("int $0x80" : : "a"(10), "b"(t));
-}
+// 10: TIME is still served by the kernel for old binaries; see get_time()
 
 // 11: WRITE
 int write(int fd, char* buf, int size) {
-	int ret;
-	__asm__ volatile ("int $0x80" : "=a"(ret) : "a"(11), "b"(fd), "c"(buf), "d"(size));
-	return ret;
+	return syscall(11, fd, (int)buf, size);
 }
 
 // 12: SEEK
 int seek(int fd, int offset, int whence) {
-	int ret;
-	__asm__ volatile ("int $0x80" : "=a"(ret) : "a"(12), "b"(fd), "c"(offset), "d"(whence));
-	return ret;
+	return syscall(12, fd, offset, whence);
 }
 
 // 13: CLEAR SCREEN
 void clear_screen() {
-	__asm__ volatile ("int $0x80" : : "a"(13));
+	syscall(13, 0, 0, 0);
 }
 
 // 14: UNLINK
 void unlink(const char* filename) {
-	__asm__ volatile ("int $0x80" : : "a"(14), "b"(filename)); 
+	syscall(14, (int)filename, 0, 0);
+}
+
+// 17: GETPID
+int getpid() {
+	return syscall(17, 0, 0, 0);
+}
+
+// 18: RING_SETUP
+static int sys_ring_setup(io_ring_t* ring) {
+	return syscall(18, (int)ring, 0, 0);
+}
+
+// 19: RING_ENTER
+static int sys_ring_enter(int to_submit) {
+	return syscall(19, to_submit, 0, 0);
+}
+
+// 20: READV
+int readv(int fd, const struct iovec* iov, int iovcnt) {
+	return syscall(20, fd, (int)iov, iovcnt);
+}
+
+// 21: WRITEV
+int writev(int fd, const struct iovec* iov, int iovcnt) {
+	return syscall(21, fd, (int)iov, iovcnt);
+}
+
+// 22: GETDENTS
+int getdents(int fd, void* buf, int size) {
+	return syscall(22, fd, (int)buf, size);
+}
+
+// 23: TTY_MODE
+int tty_mode(int mode) {
+	return syscall(23, mode, 0, 0);
+}
+
+// 24: SPAWN
+int spawn(const char* path, char** argv) {
+	return syscall(24, (int)path, (int)argv, 0);
+}
+
+// 25: SNAPSHOT
+int snapshot(const char* path) {
+	return syscall(25, (int)path, 0, 0);
+}
+
+// 26: SETPRIORITY
+int setpriority(int pid, int nice) {
+	return syscall(26, pid, nice, 0);
+}
+
+// 27: GETPRIORITY (returns 20 - nice)
+int getpriority(int pid, int* nice) {
+	int r = syscall(27, pid, 0, 0);
+	if (r < 0) return -1;
+	*nice = 20 - r;
+	return 0;
+}
+
+// 28: SCHED_SET
+int sched_set(int pid, int policy, const sched_attr_t* attr) {
+	return syscall(28, pid, policy, (int)attr);
+}
+
+// 29: NANOSLEEP
+int nanosleep(const struct timespec* ts) {
+	return syscall(29, (int)ts, 0, 0);
+}
+
+// 30: SLEEP_MS
+int sleep_ms(uint32_t ms) {
+	return syscall(30, (int)ms, 0, 0);
+}
+
+// The kernel starts a thread here with (fn, arg) on its new stack
+static void thread_start(void* (*fn)(void*), void* arg) {
+	thread_exit(fn(arg));
+}
+
+// 31: THREAD_CREATE
+int thread_create(void* (*fn)(void*), void* arg) {
+	return syscall(31, (int)thread_start, (int)fn, (int)arg);
+}
+
+// 32: THREAD_EXIT
+void thread_exit(void* ret) {
+	syscall(32, (int)ret, 0, 0);
+}
+
+// 33: THREAD_JOIN
+int thread_join(int tid, void** ret) {
+	int status;
+	int r = syscall(33, tid, (int)&status, 0);
+	if (r == 0 && ret) *ret = (void*)status;
+	return r;
+}
+
+// 34: FUTEX_WAIT
+int futex_wait(volatile uint32_t* addr, uint32_t val, uint32_t timeout_ms) {
+	return syscall(34, (int)addr, (int)val, (int)timeout_ms);
+}
+
+// 35: FUTEX_WAKE
+int futex_wake(volatile uint32_t* addr, int n) {
+	return syscall(35, (int)addr, n, 0);
+}
+
+// 36: FCNTL
+int fcntl(int fd, int cmd, int arg) {
+	return syscall(36, fd, cmd, arg);
+}
+
+// 37: PIPE
+int pipe(int fds[2]) {
+	return syscall(37, (int)fds, 0, 0);
+}
+
+// 38: TIMERFD_CREATE
+int timerfd_create() {
+	return syscall(38, 0, 0, 0);
+}
+
+// 39: TIMERFD_SET
+int timerfd_set(int fd, uint32_t first_ms, uint32_t period_ms) {
+	return syscall(39, fd, (int)first_ms, (int)period_ms);
+}
+
+// 40: EPOLL_CREATE
+int epoll_create() {
+	return syscall(40, 0, 0, 0);
+}
+
+// 41: EPOLL_CTL
+int epoll_ctl(int epfd, int op, int fd, epoll_event_t* ev) {
+	return syscall(41, epfd | (op << 16), fd, (int)ev);
+}
+
+// 42: EPOLL_WAIT
+int epoll_wait(int epfd, epoll_event_t* events, int max, int timeout_ms) {
+	if (max <= 0 || max > 0xFFFF) return -1;
+	return syscall(42, epfd | (max << 16), (int)events, timeout_ms);
 }
 
 // --- Utils & String Functions ---
 
+// Same word-at-a-time scan as the kernel's (src/kernel/memops.c)
 int strlen(const char* str) {
-	int len = 0;
-	while(str[len]) len++;
-	return len;
+	const char* p = str;
+	while ((uint32_t)p & 3) {
+		if (!*p) return p - str;
+		p++;
+	}
+
+	typedef uint32_t __attribute__((may_alias)) word_t;
+	const word_t* w = (const word_t*)p;
+	while (!((*w - 0x01010101) & ~*w & 0x80808080)) w++;
+
+	p = (const char*)w;
+	while (*p) p++;
+	return p - str;
+}
+
+// CPUID is unprivileged, so we pick the copy variant ourselves on first use.
+// -1 = not probed yet, 0 = rep movsd/stosd, 1 = ERMS rep movsb/stosb
+static int mem_erms = -1;
+
+static int mem_probe_erms() {
+	uint32_t a, b, c, d;
+	__asm__ volatile ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(0), "c"(0));
+	if (a < 7) return 0;
+	__asm__ volatile ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(7), "c"(0));
+	return (b >> 9) & 1;
 }
 
 void* memset(void* ptr, int value, int num) {
-	unsigned char* p = (unsigned char*)ptr;
-	while(num--) *p++ = (unsigned char)value;
+	if (num <= 0) return ptr;
+	if (mem_erms < 0) mem_erms = mem_probe_erms();
+
+	void* p = ptr;
+	if (mem_erms) {
+		__asm__ volatile ("rep stosb" : "+D"(p), "+c"(num) : "a"(value) : "memory");
+	} else {
+		uint32_t v = (uint8_t)value * 0x01010101;
+		uint32_t dwords = num >> 2;
+		uint32_t tail = num & 3;
+		__asm__ volatile ("rep stosl" : "+D"(p), "+c"(dwords) : "a"(v) : "memory");
+		__asm__ volatile ("rep stosb" : "+D"(p), "+c"(tail) : "a"(v) : "memory");
+	}
 	return ptr;
 }
 
 void* memcpy(void* dest, const void* src, int num) {
-	char* d = (char*)dest;
-	const char* s = (const char*)src;
-	while(num--) *d++ = *s++;
+	if (num <= 0) return dest;
+	if (mem_erms < 0) mem_erms = mem_probe_erms();
+
+	void* d = dest;
+	if (mem_erms) {
+		__asm__ volatile ("rep movsb" : "+D"(d), "+S"(src), "+c"(num) : : "memory");
+	} else {
+		uint32_t dwords = num >> 2;
+		uint32_t tail = num & 3;
+		__asm__ volatile ("rep movsl" : "+D"(d), "+S"(src), "+c"(dwords) : : "memory");
+		__asm__ volatile ("rep movsb" : "+D"(d), "+S"(src), "+c"(tail) : : "memory");
+	}
 	return dest;
 }
 
@@ -239,3 +472,406 @@ void free(void* ptr) {
 		block->free = 1;
 	}
 }
+
+// --- Buffered File Input ---
+// One read() syscall refills a whole buffer (BUFSIZ by default), so
+// line-oriented readers stop paying a kernel entry per small chunk.
+
+FILE* fopen(const char* path, const char* mode) {
+	if (!mode || mode[0] != 'r') return 0; // Kernel has no O_CREAT yet
+
+	int fd = open(path);
+	if (fd == -1) return 0;
+
+	FILE* f = (FILE*)malloc(sizeof(FILE));
+	if (!f) { close(fd); return 0; }
+
+	f->fd = fd;
+	f->buf = 0;         // Allocated on first fill so setvbuf() can still apply
+	f->buf_size = BUFSIZ;
+	f->pos = 0;
+	f->len = 0;
+	f->flags = 0;
+	return f;
+}
+
+int fclose(FILE* f) {
+	if (!f) return EOF;
+	close(f->fd);
+	if (f->flags & FILE_OWNBUF) free(f->buf);
+	free(f);
+	return 0;
+}
+
+int setvbuf(FILE* f, char* buf, int size) {
+	if (!f || f->buf || size <= 0) return -1;
+	f->buf = buf;
+	f->buf_size = size;
+	return 0;
+}
+
+// Refill the buffer with a single syscall. Returns bytes available.
+static int file_fill(FILE* f) {
+	if (f->flags & (FILE_EOF | FILE_ERR)) return 0;
+	if (!f->buf) {
+		f->buf = (char*)malloc(f->buf_size);
+		if (!f->buf) { f->flags |= FILE_ERR; return 0; }
+		f->flags |= FILE_OWNBUF;
+	}
+
+	int n = read(f->fd, f->buf, f->buf_size);
+	if (n < 0) { f->flags |= FILE_ERR; n = 0; }
+	else if (n == 0) f->flags |= FILE_EOF;
+
+	f->pos = 0;
+	f->len = n;
+	return n;
+}
+
+int fgetc(FILE* f) {
+	if (f->pos >= f->len && file_fill(f) == 0) return EOF;
+	return (unsigned char)f->buf[f->pos++];
+}
+
+char* fgets(char* s, int size, FILE* f) {
+	if (size <= 0) return 0;
+	int i = 0;
+
+	while (i < size - 1) {
+		if (f->pos >= f->len && file_fill(f) == 0) break;
+
+		// Scan the buffered chunk for a newline instead of going byte-by-byte through fgetc
+		char* p = f->buf + f->pos;
+		int avail = f->len - f->pos;
+		if (avail > size - 1 - i) avail = size - 1 - i;
+
+		int n = 0;
+		while (n < avail && p[n] != '\n') n++;
+		if (n < avail) n++; // Include the newline
+
+		memcpy(s + i, p, n);
+		i += n;
+		f->pos += n;
+		if (s[i - 1] == '\n') break;
+	}
+
+	if (i == 0) return 0;
+	s[i] = 0;
+	return s;
+}
+
+int getline(char** lineptr, int* n, FILE* f) {
+	if (!lineptr || !n) return -1;
+	if (!*lineptr || *n <= 0) {
+		*n = 128;
+		*lineptr = (char*)malloc(*n);
+		if (!*lineptr) return -1;
+	}
+
+	int len = 0;
+	while (1) {
+		if (f->pos >= f->len && file_fill(f) == 0) break;
+
+		char* p = f->buf + f->pos;
+		int avail = f->len - f->pos;
+		int k = 0;
+		while (k < avail && p[k] != '\n') k++;
+		int done = (k < avail);
+		if (done) k++;
+
+		// Grow the caller's line buffer (+1 for the terminator)
+		if (len + k + 1 > *n) {
+			int new_size = *n * 2;
+			while (new_size < len + k + 1) new_size *= 2;
+			char* grown = (char*)malloc(new_size);
+			if (!grown) return -1;
+			memcpy(grown, *lineptr, len);
+			free(*lineptr);
+			*lineptr = grown;
+			*n = new_size;
+		}
+
+		memcpy(*lineptr + len, p, k);
+		len += k;
+		f->pos += k;
+		if (done) break;
+	}
+
+	if (len == 0) return -1;
+	(*lineptr)[len] = 0;
+	return len;
+}
+
+int fread(void* ptr, int size, int nmemb, FILE* f) {
+	if (size <= 0 || nmemb <= 0) return 0;
+	char* dst = (char*)ptr;
+	int want = size * nmemb;
+	int got = 0;
+
+	// 1. Drain whatever is already buffered
+	int avail = f->len - f->pos;
+	if (avail > 0) {
+		int n = (avail < want) ? avail : want;
+		memcpy(dst, f->buf + f->pos, n);
+		f->pos += n;
+		got += n;
+	}
+
+	while (got < want && !(f->flags & (FILE_EOF | FILE_ERR))) {
+		int left = want - got;
+
+		// 2. Large requests bypass the buffer and land directly in the caller's memory
+		if (left >= f->buf_size) {
+			int n = read(f->fd, dst + got, left);
+			if (n < 0) { f->flags |= FILE_ERR; break; }
+			if (n == 0) { f->flags |= FILE_EOF; break; }
+			got += n;
+			continue;
+		}
+
+		// 3. Small tail: refill and copy out
+		if (file_fill(f) == 0) break;
+		int n = (f->len < left) ? f->len : left;
+		memcpy(dst + got, f->buf, n);
+		f->pos = n;
+		got += n;
+	}
+
+	return got / size;
+}
+
+int feof(FILE* f) { return (f->flags & FILE_EOF) != 0; }
+int ferror(FILE* f) { return (f->flags & FILE_ERR) != 0; }
+
+// --- Submission/Completion Ring ---
+
+int ring_setup(io_ring_t* ring, int entries, int flags) {
+	if (entries <= 0 || (entries & (entries - 1))) return -1;
+
+	memset(ring, 0, sizeof(io_ring_t));
+	ring->sq_entries = entries;
+	ring->cq_entries = entries * 2; // Room for a full SQ plus a full SQ in flight
+	ring->flags = flags;
+	ring->sqes = (ring_sqe_t*)malloc(ring->sq_entries * sizeof(ring_sqe_t));
+	ring->cqes = (ring_cqe_t*)malloc(ring->cq_entries * sizeof(ring_cqe_t));
+	if (!ring->sqes || !ring->cqes) return -1;
+
+	return sys_ring_setup(ring);
+}
+
+ring_sqe_t* ring_get_sqe(io_ring_t* ring) {
+	if (ring->sq_local_tail - ring->sq_head >= ring->sq_entries) return 0;
+	ring_sqe_t* sqe = &ring->sqes[ring->sq_local_tail & (ring->sq_entries - 1)];
+	ring->sq_local_tail++;
+	memset(sqe, 0, sizeof(ring_sqe_t));
+	return sqe;
+}
+
+static void ring_prep(ring_sqe_t* sqe, int op, int fd, uint32_t addr, uint32_t len, int off, uint32_t user_data) {
+	sqe->opcode = op;
+	sqe->fd = fd;
+	sqe->addr = addr;
+	sqe->len = len;
+	sqe->off = off;
+	sqe->user_data = user_data;
+}
+
+void ring_prep_open(ring_sqe_t* sqe, const char* path, uint32_t user_data) {
+	ring_prep(sqe, RING_OP_OPEN, -1, (uint32_t)path, 0, 0, user_data);
+}
+
+void ring_prep_read(ring_sqe_t* sqe, int fd, void* buf, int len, int off, uint32_t user_data) {
+	ring_prep(sqe, RING_OP_READ, fd, (uint32_t)buf, len, off, user_data);
+}
+
+void ring_prep_write(ring_sqe_t* sqe, int fd, const void* buf, int len, int off, uint32_t user_data) {
+	ring_prep(sqe, RING_OP_WRITE, fd, (uint32_t)buf, len, off, user_data);
+}
+
+void ring_prep_seek(ring_sqe_t* sqe, int fd, int offset, int whence, uint32_t user_data) {
+	ring_prep(sqe, RING_OP_SEEK, fd, 0, whence, offset, user_data);
+}
+
+void ring_prep_close(ring_sqe_t* sqe, int fd, uint32_t user_data) {
+	ring_prep(sqe, RING_OP_CLOSE, fd, 0, 0, 0, user_data);
+}
+
+void ring_prep_print(ring_sqe_t* sqe, const char* msg, uint32_t user_data) {
+	ring_prep(sqe, RING_OP_PRINT, -1, (uint32_t)msg, 0, 0, user_data);
+}
+
+int ring_submit(io_ring_t* ring) {
+	// Publish everything handed out by ring_get_sqe. The SQEs must be
+	// written before the tail moves; the kernel only reads up to sq_tail.
+	__asm__ volatile ("" : : : "memory");
+	ring->sq_tail = ring->sq_local_tail;
+	if (ring->sq_head == ring->sq_tail) return 0;
+	return sys_ring_enter(0);
+}
+
+ring_cqe_t* ring_peek_cqe(io_ring_t* ring) {
+	if (ring->cq_head == ring->cq_tail) return 0;
+	return &ring->cqes[ring->cq_head & (ring->cq_entries - 1)];
+}
+
+void ring_cqe_seen(io_ring_t* ring) {
+	ring->cq_head++;
+}
+
+// --- Clocks ---
+// Everything here reads the kernel's time page under its seqlock: retry
+// while the kernel is mid-update (odd seq) or if seq moved while reading.
+
+static const time_page_t* const time_page = (const time_page_t*)TIME_PAGE_ADDR;
+
+static inline uint32_t time_read_begin() {
+	uint32_t seq;
+	while ((seq = time_page->seq) & 1);
+	__asm__ volatile ("" : : : "memory");
+	return seq;
+}
+
+static inline int time_read_retry(uint32_t seq) {
+	__asm__ volatile ("" : : : "memory");
+	return time_page->seq != seq;
+}
+
+static uint64_t time_page_ns(const time_page_t* tp) {
+	if (!(tp->flags & TIME_PAGE_TSC)) return tp->base_ns; // Time of the last timer interrupt
+	uint32_t lo, hi;
+	__asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+	uint64_t delta = (((uint64_t)hi << 32) | lo) - tp->base_tsc;
+	return tp->base_ns + ((delta * tp->mult) >> tp->shift);
+}
+
+uint64_t clock_ns() {
+	uint64_t ns;
+	uint32_t seq;
+	do {
+		seq = time_read_begin();
+		ns = time_page_ns(time_page);
+	} while (time_read_retry(seq));
+	return ns;
+}
+
+int clock_gettime(int clock_id, struct timespec* ts) {
+	uint64_t ns;
+	uint32_t sec = 0;
+	uint32_t seq;
+	if (clock_id != CLOCK_REALTIME && clock_id != CLOCK_MONOTONIC) return -1;
+
+	do {
+		seq = time_read_begin();
+		ns = time_page_ns(time_page);
+		if (clock_id == CLOCK_REALTIME) {
+			sec = time_page->wall_sec;
+			ns -= time_page->wall_base_ns;
+		}
+	} while (time_read_retry(seq));
+
+	// Seconds fit in 32 bits, so one DIV does it (no libgcc here)
+	uint32_t q, nsec;
+	__asm__ ("divl %4" : "=a"(q), "=d"(nsec) : "a"((uint32_t)ns), "d"((uint32_t)(ns >> 32)), "rm"(1000000000));
+	sec += q;
+	ts->tv_sec = sec;
+	ts->tv_nsec = nsec;
+	return 0;
+}
+
+void get_time(time_t* t) {
+	uint32_t seq;
+	do {
+		seq = time_read_begin();
+		t->second = time_page->second;
+		t->minute = time_page->minute;
+		t->hour   = time_page->hour;
+		t->day    = time_page->day;
+		t->month  = time_page->month;
+		t->year   = time_page->year;
+	} while (time_read_retry(seq));
+}
+
+// --- Futex Locks ---
+
+void mutex_init(mutex_t* m) {
+	m->state = 0;
+}
+
+// The owner sets state 2 once anyone may be asleep, so that unlock knows
+// to call in; an uncontended lock and unlock are one atomic each.
+void mutex_lock(mutex_t* m) {
+	uint32_t c = __sync_val_compare_and_swap(&m->state, 0, 1);
+	if (c == 0) return;
+	if (c != 2) c = __sync_lock_test_and_set(&m->state, 2);
+	while (c != 0) {
+		futex_wait(&m->state, 2, 0);
+		c = __sync_lock_test_and_set(&m->state, 2);
+	}
+}
+
+int mutex_trylock(mutex_t* m) {
+	return __sync_bool_compare_and_swap(&m->state, 0, 1);
+}
+
+void mutex_unlock(mutex_t* m) {
+	if (__sync_fetch_and_sub(&m->state, 1) != 1) {
+		m->state = 0;
+		futex_wake(&m->state, 1);
+	}
+}
+
+void cond_init(cond_t* c) {
+	c->seq = 0;
+	c->waiters = 0;
+}
+
+// A signal between our unlock and the futex wait changes seq, so the wait
+// returns at once instead of missing it
+void cond_wait(cond_t* c, mutex_t* m) {
+	uint32_t seq = c->seq;
+	c->waiters++;
+	mutex_unlock(m);
+	futex_wait(&c->seq, seq, 0);
+
+	// Others may have been woken with us: take the lock as contended
+	while (__sync_lock_test_and_set(&m->state, 2) != 0)
+		futex_wait(&m->state, 2, 0);
+	c->waiters--;
+}
+
+void cond_signal(cond_t* c) {
+	__sync_fetch_and_add(&c->seq, 1);
+	if (c->waiters) futex_wake(&c->seq, 1);
+}
+
+void cond_broadcast(cond_t* c) {
+	__sync_fetch_and_add(&c->seq, 1);
+	if (c->waiters) futex_wake(&c->seq, 0x7FFFFFFF);
+}
+
+void sem_init(sem_t* s, uint32_t count) {
+	s->count = count;
+	s->waiters = 0;
+}
+
+int sem_trywait(sem_t* s) {
+	uint32_t c;
+	while ((c = s->count) > 0)
+		if (__sync_bool_compare_and_swap(&s->count, c, c - 1)) return 1;
+	return 0;
+}
+
+// The futex only sleeps while the count is still 0, so a post between our
+// look and the call is not lost
+void sem_wait(sem_t* s) {
+	while (!sem_trywait(s)) {
+		__sync_fetch_and_add(&s->waiters, 1);
+		futex_wait(&s->count, 0, 0);
+		__sync_fetch_and_sub(&s->waiters, 1);
+	}
+}
+
+void sem_post(sem_t* s) {
+	__sync_fetch_and_add(&s->count, 1);
+	if (s->waiters) futex_wake(&s->count, 1);
+}
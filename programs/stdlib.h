@@ -11,14 +11,81 @@ int read(int fd, char* buf, int size);
 int write(int fd, char* buf, int size); // Add write
 int seek(int fd, int offset, int whence); // Add seek
 int readdir(int index, char* buf);
+
+// --- Directory Enumeration ---
+// getdents fills buf with packed records and resumes on the next call;
+// seek(fd, 0, 0) rewinds. NOTE: Layout must match src/kernel/fs.h
+#define DT_FILE 0
+#define DT_DIR  1
+
+typedef struct {
+    uint16_t reclen;  // Bytes to the next record
+    uint8_t type;     // DT_*
+    uint8_t namelen;
+    uint32_t size;
+    char name[];
+} dirent_t;
+
+int getdents(int fd, void* buf, int size); // Bytes filled, 0 at end, -1 on error
+
+// Descriptors 0-2 are bound to the console
+#define STDIN_FILENO  0
+#define STDOUT_FILENO 1
+#define STDERR_FILENO 2
+
+// Vectored I/O: one kernel entry for the whole array (at most IOV_MAX)
+#define IOV_MAX 64
+
+struct iovec {
+    void* base;
+    uint32_t len;
+};
+
+int readv(int fd, const struct iovec* iov, int iovcnt);
+int writev(int fd, const struct iovec* iov, int iovcnt);
 void unlink(const char* filename); // Add unlink (delete)
 void print_int(int n);
 
+int syscall(int num, int a, int b, int c);
+int syscall_use_sysenter(int enable); // Returns 1 if the fast path is now active
+int getpid();
+
 void print(const char* msg);
 void printf(const char* fmt, ...); // Add printf prototype (we'll implement a dummy one or use print)
 void yield();
-char get_char();
+char get_char(); // Blocks; in canonical mode characters arrive a line at a time
+int get_char_timeout(int ms);             // The character, or -1 if none came in time
 void exit(int code);
+int spawn(const char* path, char** argv); // argv is NULL-terminated (max 16); returns pid or -1
+// Save this process to 'path'. Returns 0 here, and 1 in each copy started
+// later by spawning 'path' (which resumes from this call, skipping init).
+// -1 with other threads running or pipes, timerfds or epoll fds open.
+int snapshot(const char* path);
+int wait(int pid, int* status);           // pid -1: any child; returns the reaped pid or -1
+int wait_timeout(int pid, int* status, int ms); // As wait(), 0 if still running after ms
+// Nice value -20 (favoured) .. 19 (background) of 'pid', 0 for ourselves.
+// Children inherit it. Both return 0, or -1 for an unknown pid; setpriority
+// only accepts threads of our own process, and only a higher nice value.
+int setpriority(int pid, int nice);
+int getpriority(int pid, int* nice);
+
+// Scheduling classes, each strictly ahead of the next. Children always
+// start in SCHED_NORMAL.
+// NOTE: Mirrors src/kernel/sched.h - keep them in sync.
+#define SCHED_NORMAL   0
+#define SCHED_FIFO     1 // priority 0..31, higher first, runs until it blocks
+#define SCHED_DEADLINE 2 // budget_us of CPU every period_us, earliest deadline first
+
+typedef struct {
+    uint32_t priority;
+    uint32_t period_us;  // >= 1000
+    uint32_t budget_us;
+} sched_attr_t;
+
+// Only SCHED_NORMAL is open to user programs, and only for threads of our
+// own process; FIFO and DEADLINE are for kernel threads. Deadline
+// reservations are refused past 90% of the CPU. Returns 0 or -1.
+int sched_set(int pid, int policy, const sched_attr_t* attr);
 int strlen(const char* str);
 void clear_screen(); // Add clear_screen
 
@@ -28,6 +95,230 @@ typedef struct {
     uint8_t day;    uint8_t month;  uint16_t year;
 } time_t;
 
-void get_time(time_t* t);
+void get_time(time_t* t); // Reads the kernel time page, no syscall
+
+// --- Clocks ---
+// The kernel maps a read-only time page at TIME_PAGE_ADDR in every process.
+// NOTE: Layout must match src/kernel/clock.h
+#define TIME_PAGE_ADDR 0xC0000000
+#define TIME_PAGE_TSC  0x1
+
+typedef struct {
+    volatile uint32_t seq;
+    uint32_t flags;
+    uint32_t tsc_khz;
+    uint32_t tick_ns;
+    uint64_t ticks;
+    uint64_t base_tsc;
+    uint64_t base_ns;
+    uint32_t mult;
+    uint32_t shift;
+    uint32_t wall_sec;
+    uint64_t wall_base_ns;
+    uint8_t second; uint8_t minute; uint8_t hour;
+    uint8_t day;    uint8_t month;  uint16_t year;
+} time_page_t;
+
+#define CLOCK_REALTIME  0
+#define CLOCK_MONOTONIC 1
+
+struct timespec {
+    uint32_t tv_sec;
+    uint32_t tv_nsec;
+};
+
+// --- Terminal Modes ---
+// Canonical mode (default): the kernel echoes and edits the line and
+// reads return only after Enter. Clear TTY_ICANON for key-at-a-time input.
+#define TTY_ICANON 0x1
+#define TTY_ECHO   0x2
+#define TTY_DEFAULT_MODE (TTY_ICANON | TTY_ECHO)
+
+int tty_mode(int mode); // Returns the previous mode; -1 only queries
+
+int clock_gettime(int clock_id, struct timespec* ts);
+// Sleep without using the CPU (and without yield() loops). 0, or -1 if
+// tv_nsec is out of range.
+int nanosleep(const struct timespec* ts);
+int sleep_ms(uint32_t ms);
+uint64_t clock_ns(); // Monotonic nanoseconds since boot
+
+// --- Threads ---
+// Threads share the address space, open files and working directory.
+// exit() from any of them ends the whole process; a thread returning from
+// fn ends just itself, as thread_exit() would. Up to 16 per process, each
+// with a 16KB stack. malloc() is not thread-safe.
+int thread_create(void* (*fn)(void*), void* arg); // Returns the thread id or -1
+void thread_exit(void* ret);
+int thread_join(int tid, void** ret); // 0, or -1 if tid is not a joinable thread
+
+// --- Futexes & Locks ---
+// Sleep while *addr == val (timeout_ms 0: none): 0 once woken or if *addr
+// already differed, -1 on timeout or a bad address. addr must be 4-byte
+// aligned. Wake returns how many of the waiters on addr it woke.
+int futex_wait(volatile uint32_t* addr, uint32_t val, uint32_t timeout_ms);
+int futex_wake(volatile uint32_t* addr, int n);
+
+// Built on futexes: none of these enter the kernel unless they have to
+// sleep or there is a sleeper to wake. Zeroed memory is a valid unlocked
+// mutex and condition variable.
+typedef struct {
+    volatile uint32_t state; // 0 unlocked, 1 locked, 2 locked and maybe contended
+} mutex_t;
+
+typedef struct {
+    volatile uint32_t seq;     // Bumped by every signal
+    volatile uint32_t waiters; // Changed only with the mutex held
+} cond_t;
+
+typedef struct {
+    volatile uint32_t count;
+    volatile uint32_t waiters;
+} sem_t;
+
+#define MUTEX_INITIALIZER { 0 }
+#define COND_INITIALIZER  { 0, 0 }
+
+void mutex_init(mutex_t* m);
+void mutex_lock(mutex_t* m);
+int mutex_trylock(mutex_t* m); // 1 if we got it
+void mutex_unlock(mutex_t* m);
+
+// The condition must only change with m held for signals not to be lost
+void cond_init(cond_t* c);
+void cond_wait(cond_t* c, mutex_t* m);
+void cond_signal(cond_t* c);
+void cond_broadcast(cond_t* c);
+
+void sem_init(sem_t* s, uint32_t count);
+void sem_wait(sem_t* s);
+int sem_trywait(sem_t* s); // 1 if we took one
+void sem_post(sem_t* s);
+
+// --- Event Descriptors ---
+// With O_NONBLOCK set, a read or write that would sleep returns
+// E_WOULDBLOCK instead. Pipe reads return 0 once the write end is closed.
+#define O_NONBLOCK   0x1
+#define F_GETFL      3
+#define F_SETFL      4
+#define E_WOULDBLOCK (-2)
+
+int fcntl(int fd, int cmd, int arg);
+int pipe(int fds[2]);                     // fds[0] reads what fds[1] writes; 0 or -1
+// Readable once it expires; read() then yields the uint32_t number of
+// expirations since the last read. first_ms 0 disarms, period_ms 0 fires once.
+int timerfd_create();
+int timerfd_set(int fd, uint32_t first_ms, uint32_t period_ms);
+
+// Register descriptors once with epoll_ctl(); epoll_wait() returns only
+// those ready (level-triggered). The console, pipes and timerfds wake it;
+// regular files are always ready. Up to 32 descriptors per instance.
+#define EPOLLIN  0x001
+#define EPOLLOUT 0x004
+#define EPOLLERR 0x008 // Always reported
+#define EPOLLHUP 0x010 // Always reported
+
+#define EPOLL_CTL_ADD 1
+#define EPOLL_CTL_DEL 2
+#define EPOLL_CTL_MOD 3
+
+typedef struct {
+    uint32_t events;
+    uint32_t data;
+} epoll_event_t;
+
+int epoll_create();
+int epoll_ctl(int epfd, int op, int fd, epoll_event_t* ev);
+// timeout_ms -1 waits forever, 0 not at all. Returns the number of events.
+int epoll_wait(int epfd, epoll_event_t* events, int max, int timeout_ms);
+
+// --- Buffered File Input ---
+#define BUFSIZ 4096
+#define EOF    (-1)
+
+#define FILE_EOF    0x1
+#define FILE_ERR    0x2
+#define FILE_OWNBUF 0x4 // buf was malloc'd by the library
+
+typedef struct {
+    int fd;
+    char* buf;
+    int buf_size;
+    int pos;   // Next unread byte in buf
+    int len;   // Valid bytes in buf
+    int flags;
+} FILE;
+
+void* memcpy(void* dest, const void* src, int num);
+void* memset(void* ptr, int value, int num);
+
+FILE* fopen(const char* path, const char* mode); // Only "r" for now
+int fclose(FILE* f);
+int setvbuf(FILE* f, char* buf, int size); // Call before the first read; buf may be 0
+int fgetc(FILE* f);
+char* fgets(char* s, int size, FILE* f);
+int getline(char** lineptr, int* n, FILE* f);
+int fread(void* ptr, int size, int nmemb, FILE* f);
+int feof(FILE* f);
+int ferror(FILE* f);
+
+// --- Submission/Completion Ring ---
+// Queue many operations, then hand them all to the kernel with one
+// ring_submit(). With RING_SETUP_POLL the kernel also drains the queue on
+// timer ticks, so a producer that only peeks completions never traps; but
+// a tick stops at the first OPEN, READ or WRITE (they may sleep), and
+// those only run on ring_submit().
+// NOTE: Layout must match src/kernel/ring.h
+#define RING_OP_NOP   0
+#define RING_OP_OPEN  1
+#define RING_OP_READ  2
+#define RING_OP_WRITE 3
+#define RING_OP_SEEK  4
+#define RING_OP_CLOSE 5
+#define RING_OP_PRINT 6
+
+#define RING_OFF_CURRENT (-1)
+#define RING_SETUP_POLL  0x1
+
+typedef struct {
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t reserved;
+    int32_t fd;
+    uint32_t addr;
+    uint32_t len;
+    int32_t off;
+    uint32_t user_data;
+} ring_sqe_t;
+
+typedef struct {
+    uint32_t user_data;
+    int32_t res;
+} ring_cqe_t;
+
+typedef struct {
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t flags;
+    uint32_t sq_local_tail;
+    ring_sqe_t* sqes;
+    ring_cqe_t* cqes;
+} io_ring_t;
+
+int ring_setup(io_ring_t* ring, int entries, int flags); // entries: power of two; CQ gets 2x
+ring_sqe_t* ring_get_sqe(io_ring_t* ring);                // 0 if the SQ is full
+void ring_prep_open(ring_sqe_t* sqe, const char* path, uint32_t user_data);
+void ring_prep_read(ring_sqe_t* sqe, int fd, void* buf, int len, int off, uint32_t user_data);
+void ring_prep_write(ring_sqe_t* sqe, int fd, const void* buf, int len, int off, uint32_t user_data);
+void ring_prep_seek(ring_sqe_t* sqe, int fd, int offset, int whence, uint32_t user_data);
+void ring_prep_close(ring_sqe_t* sqe, int fd, uint32_t user_data);
+void ring_prep_print(ring_sqe_t* sqe, const char* msg, uint32_t user_data);
+int ring_submit(io_ring_t* ring);                         // Returns SQEs consumed by the kernel
+ring_cqe_t* ring_peek_cqe(io_ring_t* ring);               // 0 if no completion is ready
+void ring_cqe_seen(io_ring_t* ring);
 
-#endif
\ No newline at end of file
+#endif
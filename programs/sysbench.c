@@ -0,0 +1,42 @@
+/* programs/sysbench.c */
+#include "stdlib.h"
+
+// Syscall round-trip benchmark: getpid() via int $0x80 vs sysenter
+
+#define ITERATIONS 10000
+
+static inline uint32_t rdtsc_lo() {
+    uint32_t lo, hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return lo;
+}
+
+// Best of 5 runs, in cycles per call
+uint32_t measure() {
+    uint32_t best = 0xFFFFFFFF;
+    for (int run = 0; run < 5; run++) {
+        uint32_t start = rdtsc_lo();
+        for (int i = 0; i < ITERATIONS; i++) getpid();
+        uint32_t cycles = (rdtsc_lo() - start) / ITERATIONS;
+        if (cycles < best) best = cycles;
+    }
+    return best;
+}
+
+int main() {
+    print("\n--- Syscall Round Trip ---\n");
+
+    syscall_use_sysenter(0);
+    uint32_t slow = measure();
+    printf("int $0x80 : %d cycles/call\n", slow);
+
+    if (syscall_use_sysenter(1)) {
+        uint32_t fast = measure();
+        printf("sysenter  : %d cycles/call\n", fast);
+    } else {
+        print("sysenter  : not supported on this CPU\n");
+    }
+
+    print("--------------------------\n");
+    return 0;
+}
@@ -0,0 +1,175 @@
+/* src/cpu/acpi.c */
+#include "acpi.h"
+#include "../mm/vmm.h"
+#include "../drivers/serial.h"
+#include "../kernel/memops.h"
+
+#define ACPI_IDENTITY_LIMIT 0x08000000 // init_vmm identity-maps the first 128MB
+
+typedef struct {
+    char signature[8];      // "RSD PTR "
+    uint8_t checksum;       // Over these 20 bytes
+    char oem_id[6];
+    uint8_t revision;
+    uint32_t rsdt;
+} __attribute__((packed)) acpi_rsdp_t;
+
+typedef struct {
+    char signature[4];
+    uint32_t length;        // Header included
+    uint8_t revision;
+    uint8_t checksum;       // Over 'length' bytes
+    char oem_id[6];
+    char oem_table_id[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed)) acpi_sdt_t;
+
+typedef struct {
+    acpi_sdt_t header;
+    uint32_t lapic_base;
+    uint32_t flags;
+} __attribute__((packed)) acpi_madt_t;
+
+// MADT entries follow the fixed part back to back, each starting with these
+typedef struct {
+    uint8_t type;
+    uint8_t length;
+} __attribute__((packed)) madt_entry_t;
+
+#define MADT_LAPIC    0
+#define MADT_IOAPIC   1
+#define MADT_OVERRIDE 2
+
+typedef struct {
+    madt_entry_t h;
+    uint8_t acpi_id;
+    uint8_t apic_id;
+    uint32_t flags;
+} __attribute__((packed)) madt_lapic_t;
+
+#define MADT_LAPIC_ENABLED        (1 << 0)
+#define MADT_LAPIC_ONLINE_CAPABLE (1 << 1)
+
+typedef struct {
+    madt_entry_t h;
+    uint8_t ioapic_id;
+    uint8_t reserved;
+    uint32_t address;
+    uint32_t gsi_base;
+} __attribute__((packed)) madt_ioapic_t;
+
+typedef struct {
+    madt_entry_t h;
+    uint8_t bus;            // 0: ISA
+    uint8_t source;         // ISA IRQ
+    uint32_t gsi;
+    uint16_t flags;
+} __attribute__((packed)) madt_override_t;
+
+acpi_madt_info_t acpi_madt;
+
+static int acpi_sig(const char* a, const char* b, int n) {
+    for (int i = 0; i < n; i++)
+        if (a[i] != b[i]) return 0;
+    return 1;
+}
+
+static int acpi_checksum_ok(const void* p, uint32_t len) {
+    const uint8_t* b = (const uint8_t*)p;
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < len; i++) sum += b[i];
+    return sum == 0;
+}
+
+// Firmware tables may sit above the identity map (near the top of RAM)
+static void acpi_map(uint32_t phys, uint32_t len) {
+    for (uint32_t page = phys & ~0xFFF; page < phys + len; page += 4096)
+        if (page >= ACPI_IDENTITY_LIMIT) vmm_map_page((void*)page, (void*)page, I86_PTE_PRESENT);
+}
+
+static acpi_sdt_t* acpi_map_table(uint32_t phys) {
+    acpi_map(phys, sizeof(acpi_sdt_t));
+    acpi_sdt_t* t = (acpi_sdt_t*)phys;
+    acpi_map(phys, t->length);
+    return acpi_checksum_ok(t, t->length) ? t : 0;
+}
+
+// The RSDP is on a 16-byte boundary
+static acpi_rsdp_t* acpi_scan(uint32_t start, uint32_t len) {
+    for (uint32_t a = start; a + sizeof(acpi_rsdp_t) <= start + len; a += 16) {
+        acpi_rsdp_t* r = (acpi_rsdp_t*)a;
+        if (acpi_sig(r->signature, "RSD PTR ", 8) && acpi_checksum_ok(r, 20)) return r;
+    }
+    return 0;
+}
+
+static acpi_rsdp_t* acpi_find_rsdp() {
+    // First KB of the EBDA, whose segment the BIOS leaves at 0x40E
+    uint16_t ebda_seg;
+    memcpy(&ebda_seg, (void*)0x40E, sizeof(ebda_seg));
+    uint32_t ebda = (uint32_t)ebda_seg << 4;
+    acpi_rsdp_t* r = 0;
+    if (ebda >= 0x80000 && ebda < 0xA0000) r = acpi_scan(ebda, 1024);
+    return r ? r : acpi_scan(0xE0000, 0x20000);
+}
+
+static void acpi_parse_madt(acpi_madt_t* madt) {
+    acpi_madt.lapic_base = madt->lapic_base;
+    acpi_madt.cpu_count = 0;
+    acpi_madt.ioapic_base = 0;
+    for (int i = 0; i < ACPI_ISA_IRQS; i++) {
+        acpi_madt.isa_gsi[i] = i;   // Identity unless overridden
+        acpi_madt.isa_flags[i] = 0;
+    }
+
+    uint8_t* p = (uint8_t*)(madt + 1);
+    uint8_t* end = (uint8_t*)madt + madt->header.length;
+    while (p + sizeof(madt_entry_t) <= end) {
+        madt_entry_t* e = (madt_entry_t*)p;
+        if (e->length < sizeof(madt_entry_t)) break;
+
+        if (e->type == MADT_LAPIC) {
+            madt_lapic_t* l = (madt_lapic_t*)e;
+            if ((l->flags & (MADT_LAPIC_ENABLED | MADT_LAPIC_ONLINE_CAPABLE)) &&
+                acpi_madt.cpu_count < ACPI_MAX_CPUS)
+                acpi_madt.cpu_apic_id[acpi_madt.cpu_count++] = l->apic_id;
+        } else if (e->type == MADT_IOAPIC && !acpi_madt.ioapic_base) {
+            madt_ioapic_t* io = (madt_ioapic_t*)e;
+            acpi_madt.ioapic_base = io->address;
+            acpi_madt.ioapic_gsi_base = io->gsi_base;
+        } else if (e->type == MADT_OVERRIDE) {
+            madt_override_t* o = (madt_override_t*)e;
+            if (o->bus == 0 && o->source < ACPI_ISA_IRQS) {
+                acpi_madt.isa_gsi[o->source] = o->gsi;
+                acpi_madt.isa_flags[o->source] = o->flags;
+            }
+        }
+        p += e->length;
+    }
+}
+
+int init_acpi() {
+    acpi_rsdp_t* rsdp = acpi_find_rsdp();
+    if (!rsdp) {
+        serial_log(" [ACPI] No RSDP found.\n");
+        return 0;
+    }
+
+    acpi_sdt_t* rsdt = acpi_map_table(rsdp->rsdt);
+    if (!rsdt || !acpi_sig(rsdt->signature, "RSDT", 4)) return 0;
+
+    uint32_t* entries = (uint32_t*)(rsdt + 1);
+    uint32_t count = (rsdt->length - sizeof(acpi_sdt_t)) / 4;
+    for (uint32_t i = 0; i < count; i++) {
+        acpi_sdt_t* t = acpi_map_table(entries[i]);
+        if (t && acpi_sig(t->signature, "APIC", 4)) {
+            acpi_parse_madt((acpi_madt_t*)t);
+            serial_log(" [ACPI] MADT parsed.\n");
+            return 1;
+        }
+    }
+    serial_log(" [ACPI] No MADT.\n");
+    return 0;
+}
@@ -0,0 +1,36 @@
+/* src/cpu/acpi.h */
+#ifndef ACPI_H
+#define ACPI_H
+
+#include <stdint.h>
+
+// Just enough ACPI to find the processors and interrupt controllers: the
+// RSDP is located by its signature in the EBDA or the BIOS ROM area, its
+// RSDT leads to the MADT ("APIC"), and the MADT lists one local APIC per
+// processor, the I/O APICs and where the ISA IRQs really arrive.
+
+#define ACPI_MAX_CPUS 32
+#define ACPI_ISA_IRQS 16
+
+// MPS INTI flags of an interrupt source override
+#define ACPI_IRQ_ACTIVE_LOW (3 << 0)    // Polarity field
+#define ACPI_IRQ_LEVEL      (3 << 2)    // Trigger mode field
+
+typedef struct {
+    uint32_t lapic_base;                    // Physical, as the MADT reports it
+    int cpu_count;                          // Usable processors, boot CPU included
+    uint8_t cpu_apic_id[ACPI_MAX_CPUS];
+
+    uint32_t ioapic_base;                   // Physical, 0 if none; only the first is used
+    uint32_t ioapic_gsi_base;               // First global system interrupt it handles
+    uint32_t isa_gsi[ACPI_ISA_IRQS];        // ISA IRQ -> GSI, overrides applied
+    uint16_t isa_flags[ACPI_ISA_IRQS];      // 0: ISA default, active high and edge
+} acpi_madt_info_t;
+
+extern acpi_madt_info_t acpi_madt;
+
+// 1 if a MADT was found. Tables above the identity map are mapped on the
+// way, so like init_lapic() this must precede the first address space.
+int init_acpi();
+
+#endif
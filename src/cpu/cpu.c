@@ -0,0 +1,45 @@
+/* src/cpu/cpu.c */
+#include "cpu.h"
+#include "../drivers/serial.h"
+
+cpu_info_t cpu_info;
+
+// CPUID is present on everything we boot on (i586+), so no EFLAGS.ID probe.
+void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d) {
+    __asm__ volatile("cpuid"
+                     : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d)
+                     : "a"(leaf), "c"(subleaf));
+}
+
+void init_cpu() {
+    uint32_t a, b, c, d;
+
+    // Leaf 0: Max leaf + vendor string (EBX, EDX, ECX order)
+    cpuid(0, 0, &a, &b, &c, &d);
+    uint32_t max_leaf = a;
+    *(uint32_t*)&cpu_info.vendor[0] = b;
+    *(uint32_t*)&cpu_info.vendor[4] = d;
+    *(uint32_t*)&cpu_info.vendor[8] = c;
+    cpu_info.vendor[12] = 0;
+
+    // Leaf 1: Family/Model/Stepping + feature bits
+    cpuid(1, 0, &a, &b, &c, &d);
+    cpu_info.stepping = a & 0xF;
+    cpu_info.model    = (a >> 4) & 0xF;
+    cpu_info.family   = (a >> 8) & 0xF;
+    if (cpu_info.family == 0xF) cpu_info.family += (a >> 20) & 0xFF;
+    if (cpu_info.family >= 6)   cpu_info.model  |= ((a >> 16) & 0xF) << 4;
+    cpu_info.edx1 = d;
+    cpu_info.ecx1 = c;
+
+    // Leaf 7: Extended features (ERMS lives here)
+    cpu_info.ebx7 = 0;
+    if (max_leaf >= 7) {
+        cpuid(7, 0, &a, &b, &c, &d);
+        cpu_info.ebx7 = b;
+    }
+
+    serial_log(" [CPU] Vendor: ");
+    serial_log(cpu_info.vendor);
+    serial_log("\n");
+}
@@ -0,0 +1,55 @@
+/* src/cpu/cpu.h */
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+
+// CPUID leaf 1, EDX
+#define CPUID_EDX_FPU   (1 << 0)
+#define CPUID_EDX_TSC   (1 << 4)
+#define CPUID_EDX_MSR   (1 << 5)
+#define CPUID_EDX_APIC  (1 << 9)
+#define CPUID_EDX_SEP   (1 << 11)
+#define CPUID_EDX_FXSR  (1 << 24)
+#define CPUID_EDX_SSE   (1 << 25)
+#define CPUID_EDX_SSE2  (1 << 26)
+
+// CPUID leaf 7, EBX
+#define CPUID7_EBX_ERMS (1 << 9)
+
+// Feature summary filled in once at boot by init_cpu()
+typedef struct {
+    char vendor[13];
+    uint32_t family;
+    uint32_t model;
+    uint32_t stepping;
+    uint32_t edx1;      // Raw CPUID.1:EDX
+    uint32_t ecx1;      // Raw CPUID.1:ECX
+    uint32_t ebx7;      // Raw CPUID.7.0:EBX (0 if leaf 7 is missing)
+} cpu_info_t;
+
+extern cpu_info_t cpu_info;
+
+void init_cpu();
+void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d);
+
+static inline int cpu_has_edx1(uint32_t bit) { return (cpu_info.edx1 & bit) != 0; }
+static inline int cpu_has_erms() { return (cpu_info.ebx7 & CPUID7_EBX_ERMS) != 0; }
+
+static inline uint64_t rdtsc() {
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint32_t lo, hi;
+    __asm__ volatile("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t val) {
+    __asm__ volatile("wrmsr" : : "c"(msr), "a"((uint32_t)val), "d"((uint32_t)(val >> 32)));
+}
+
+#endif
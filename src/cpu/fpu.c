@@ -0,0 +1,167 @@
+/* src/cpu/fpu.c */
+#include "fpu.h"
+#include "cpu.h"
+#include "../kernel/process.h"
+#include "../kernel/memops.h"
+#include "../mm/heap.h"
+#include "../drivers/serial.h"
+
+#define CR0_MP (1 << 1)
+#define CR0_EM (1 << 2)
+#define CR0_TS (1 << 3)
+#define CR0_NE (1 << 5)
+#define CR4_OSFXSR     (1 << 9)
+#define CR4_OSXMMEXCPT (1 << 10)
+
+// Lazy switching: each CPU's registers hold its fpu_owner's state until
+// someone else touches the FPU there and traps with #NM. Processes that
+// never use it pay nothing.
+static process_t* fpu_owner[SMP_MAX_CPUS];
+
+static int use_fxsr = 0;
+static int sse_enabled = 0;
+static uint8_t fpu_clean_state[FPU_STATE_SIZE] __attribute__((aligned(16)));
+
+static uint32_t kfpu_eflags = 0;
+static int kfpu_active = 0;
+
+static inline uint32_t read_cr0() {
+    uint32_t v;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(v));
+    return v;
+}
+
+static inline void write_cr0(uint32_t v) {
+    __asm__ volatile("mov %0, %%cr0" : : "r"(v));
+}
+
+static inline void clts() {
+    __asm__ volatile("clts");
+}
+
+static inline void stts() {
+    write_cr0(read_cr0() | CR0_TS);
+}
+
+static void fpu_save(void* area) {
+    if (use_fxsr) __asm__ volatile("fxsave (%0)" : : "r"(area) : "memory");
+    else          __asm__ volatile("fnsave (%0)" : : "r"(area) : "memory");
+}
+
+static void fpu_restore(void* area) {
+    if (use_fxsr) __asm__ volatile("fxrstor (%0)" : : "r"(area) : "memory");
+    else          __asm__ volatile("frstor (%0)" : : "r"(area) : "memory");
+}
+
+// Control registers and a reset FPU, on whichever CPU runs this
+static void fpu_enable() {
+    // Native x87 error reporting, no emulation, WAIT honours TS
+    uint32_t cr0 = read_cr0();
+    cr0 &= ~(CR0_EM | CR0_TS);
+    cr0 |= CR0_MP | CR0_NE;
+    write_cr0(cr0);
+
+    if (use_fxsr) {
+        uint32_t cr4;
+        __asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+        cr4 |= CR4_OSFXSR;
+        if (sse_enabled) cr4 |= CR4_OSXMMEXCPT;
+        __asm__ volatile("mov %0, %%cr4" : : "r"(cr4));
+    }
+
+    __asm__ volatile("fninit");
+    if (sse_enabled) {
+        uint32_t mxcsr = 0x1F80; // All exceptions masked, round-to-nearest
+        __asm__ volatile("ldmxcsr %0" : : "m"(mxcsr));
+    }
+}
+
+void init_fpu() {
+    if (!cpu_has_edx1(CPUID_EDX_FPU)) {
+        serial_log(" [FPU] No FPU present.\n");
+        return;
+    }
+
+    use_fxsr = cpu_has_edx1(CPUID_EDX_FXSR);
+    sse_enabled = use_fxsr && cpu_has_edx1(CPUID_EDX_SSE);
+    fpu_enable();
+
+    // Every process starts from this image on its first FPU instruction
+    fpu_save(fpu_clean_state);
+
+    stts();
+    serial_log(sse_enabled ? " [FPU] x87 + SSE enabled (lazy FXSAVE).\n"
+                           : " [FPU] x87 enabled (lazy FNSAVE).\n");
+}
+
+void fpu_init_cpu() {
+    if (!cpu_has_edx1(CPUID_EDX_FPU)) return;
+    fpu_enable();
+    stts();
+}
+
+int fpu_sse_enabled() {
+    return sse_enabled;
+}
+
+void fpu_handle_nm() {
+    process_t** owner = &fpu_owner[this_cpu()->id];
+    clts();
+    if (!current_process || *owner == current_process) return;
+
+    if (*owner) fpu_save((*owner)->fpu_state);
+
+    if (!current_process->fpu_state) {
+        // kmalloc only guarantees 4-byte alignment; FXSAVE needs 16
+        current_process->fpu_alloc = kmalloc(FPU_STATE_SIZE + 16);
+        current_process->fpu_state = (void*)(((uint32_t)current_process->fpu_alloc + 15) & ~15);
+        memcpy(current_process->fpu_state, fpu_clean_state, FPU_STATE_SIZE);
+    }
+
+    fpu_restore(current_process->fpu_state);
+    *owner = current_process;
+}
+
+void fpu_switch_to(process_t* prev, process_t* next) {
+    process_t** owner = &fpu_owner[this_cpu()->id];
+    // Another CPU may pick prev up next, and it can only restore from
+    // memory: with more than one online, save on the way out
+    if (cpu_count > 1 && *owner == prev) {
+        clts();
+        fpu_save(prev->fpu_state);
+        *owner = 0;
+    }
+    if (next == *owner) clts();
+    else stts();
+}
+
+void fpu_release(process_t* proc) {
+    for (int i = 0; i < SMP_MAX_CPUS; i++)
+        if (fpu_owner[i] == proc) fpu_owner[i] = 0;
+    if (proc->fpu_alloc) kfree(proc->fpu_alloc);
+    proc->fpu_alloc = 0;
+    proc->fpu_state = 0;
+}
+
+void kernel_fpu_begin() {
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(kfpu_eflags));
+    clts();
+
+    // Park the user's registers in its save area; it reloads them via #NM later
+    process_t** owner = &fpu_owner[this_cpu()->id];
+    if (*owner) {
+        fpu_save((*owner)->fpu_state);
+        *owner = 0;
+    }
+    kfpu_active = 1;
+}
+
+void kernel_fpu_end() {
+    kfpu_active = 0;
+    stts();
+    __asm__ volatile("push %0; popf" : : "r"(kfpu_eflags));
+}
+
+int kernel_fpu_in_use() {
+    return kfpu_active;
+}
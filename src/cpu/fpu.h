@@ -0,0 +1,31 @@
+/* src/cpu/fpu.h */
+#ifndef FPU_H
+#define FPU_H
+
+#include <stdint.h>
+
+#define FPU_STATE_SIZE 512 // FXSAVE image (FNSAVE only needs 108)
+
+struct process;
+
+// Enable the FPU/SSE, capture a clean register image and arm CR0.TS
+void init_fpu();
+void fpu_init_cpu();    // The same for each further CPU
+int fpu_sse_enabled();
+
+// #NM (vector 7): load the current process's FPU state on first use
+void fpu_handle_nm();
+
+// Scheduler hook: arm CR0.TS unless 'next' already owns the live registers
+void fpu_switch_to(struct process* prev, struct process* next);
+
+// Drop a dying process's FPU state
+void fpu_release(struct process* proc);
+
+// Bracket kernel SIMD code. Not nestable; interrupts are off in between,
+// so keep each bracket short (see memcpy_sse2).
+void kernel_fpu_begin();
+void kernel_fpu_end();
+int kernel_fpu_in_use();
+
+#endif
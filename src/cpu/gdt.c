@@ -1,5 +1,6 @@
 /* src/cpu/gdt.c */
 #include "gdt.h"
+#include "smp.h"
 
 // Define the GDT structures locally
 struct gdt_entry {
@@ -16,12 +17,12 @@ struct gdt_ptr {
     uint32_t base;
 } __attribute__((packed));
 
-struct gdt_entry gdt[6]; // Null, KCode, KData, UCode, UData, TSS
+struct gdt_entry gdt[GDT_TSS_FIRST + SMP_MAX_CPUS]; // Null, KCode, KData, UCode, UData, one TSS per CPU
 struct gdt_ptr gp;
-tss_entry_t tss_entry;
+tss_entry_t tss_entry[SMP_MAX_CPUS];
 
 extern void gdt_flush(uint32_t);
-extern void tss_flush(); 
+extern void tss_flush(uint16_t sel);
 
 void gdt_set_gate(int num, uint32_t base, uint32_t limit, uint8_t access, uint8_t gran) {
     gdt[num].base_low    = (base & 0xFFFF);
@@ -33,9 +34,10 @@ void gdt_set_gate(int num, uint32_t base, uint32_t limit, uint8_t access, uint8_
     gdt[num].access      = access;
 }
 
-void write_tss(int num, uint16_t ss0, uint32_t esp0) {
-    uint32_t base = (uint32_t) &tss_entry;
-    uint32_t limit = sizeof(tss_entry);
+void write_tss(int cpu, uint16_t ss0, uint32_t esp0) {
+    tss_entry_t* tss = &tss_entry[cpu];
+    uint32_t base = (uint32_t)tss;
+    uint32_t limit = sizeof(tss_entry_t);
 
     // TSS Descriptor
     // Access: Present (1), Ring 0 (00), Executable (0), Type (9 = Available TSS 32-bit) -> 0xE9?
@@ -43,21 +45,21 @@ void write_tss(int num, uint16_t ss0, uint32_t esp0) {
     // 0xE9 is for Ring 3? No, TSS is a system segment.
     // Let's use 0xE9 for "Present, Ring 3, Accessed" if we want user to trigger it (rare)
     // Standard kernel TSS: 0x89 (Present, Ring 0, Type 9)
-    gdt_set_gate(num, base, limit, 0x89, 0x00); 
+    gdt_set_gate(GDT_TSS_FIRST + cpu, base, limit, 0x89, 0x00); 
 
     // Zero out
-    uint8_t *p = (uint8_t *)&tss_entry;
-    for(int i=0; i<sizeof(tss_entry); i++) p[i] = 0;
+    uint8_t *p = (uint8_t *)tss;
+    for(uint32_t i=0; i<sizeof(tss_entry_t); i++) p[i] = 0;
 
-    tss_entry.ss0  = ss0; 
-    tss_entry.esp0 = esp0; 
+    tss->ss0  = ss0; 
+    tss->esp0 = esp0; 
     
     // I/O Map Base > Limit disables I/O permission bitmap
-    tss_entry.iomap_base = sizeof(tss_entry);
+    tss->iomap_base = sizeof(tss_entry_t);
 }
 
 void init_gdt() {
-    gp.limit = (sizeof(struct gdt_entry) * 6) - 1;
+    gp.limit = sizeof(gdt) - 1;
     gp.base  = (uint32_t)&gdt;
 
     // 0: Null
@@ -79,16 +81,24 @@ void init_gdt() {
     // Access=0xF2 (Present, Ring3, Data, Write)
     gdt_set_gate(4, 0, 0xFFFFFFFF, 0xF2, 0xCF);
 
-    // 5: TSS (0x28)
+    // 5+: TSS per CPU (0x28, 0x30, ...)
     // Initial Kernel Stack is arbitrary, will be updated by scheduler
-    write_tss(5, 0x10, 0x0);
+    for (int cpu = 0; cpu < SMP_MAX_CPUS; cpu++)
+        write_tss(cpu, 0x10, 0x0);
 
+    gdt_init_cpu(0);
+}
+
+// Each CPU loads the shared GDT and its own TSS. The TR selector then
+// identifies the CPU (this_cpu()).
+void gdt_init_cpu(int cpu) {
     gdt_flush((uint32_t)&gp);
-    tss_flush(); // Load TR register
+    tss_flush((GDT_TSS_FIRST + cpu) * 8); // Load TR register
 }
 
 // Critical: Called by scheduler to update Kernel Stack for the NEXT interrupt
 void tss_set_stack(uint32_t kss, uint32_t kesp) {
-    tss_entry.ss0 = kss;
-    tss_entry.esp0 = kesp;
+    tss_entry_t* tss = &tss_entry[this_cpu()->id];
+    tss->ss0 = kss;
+    tss->esp0 = kesp;
 }
\ No newline at end of file
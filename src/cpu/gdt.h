@@ -3,7 +3,10 @@
 #define GDT_H
 #include <stdint.h>
 
+#define GDT_TSS_FIRST 5 // CPU n's TSS descriptor is entry GDT_TSS_FIRST + n
+
 void init_gdt();
+void gdt_init_cpu(int cpu); // Load the GDT and this CPU's TSS
 
 // A struct describing a Task State Segment.
 typedef struct {
@@ -36,7 +39,9 @@ typedef struct {
     uint16_t iomap_base;
 } __attribute__((packed)) tss_entry_t;
 
-// Update TSS ESP0 (Called by the scheduler)
+extern tss_entry_t tss_entry[];
+
+// Update this CPU's TSS ESP0 (Called by the scheduler)
 void tss_set_stack(uint32_t kss, uint32_t kesp);
 
 #endif
\ No newline at end of file
@@ -2,6 +2,17 @@
 #include "idt.h"
 #include "../drivers/serial.h"
 #include "../kernel/syscall.h"
+#include "fpu.h"
+#include "../kernel/ring.h"
+#include "../kernel/clock.h"
+#include "../mm/vmm.h"
+#include "lapic.h"
+#include "../kernel/timer.h"
+#include "../kernel/sched.h"
+#include "../kernel/process.h"
+#include "../drivers/ata.h"
+#include "smp.h"
+#include "irq.h"
 
 extern void isr0();
 extern void isr1();
@@ -28,9 +39,15 @@ extern void isr128(); // Syscall
 extern void isr32();  // Timer
 extern void isr33();  // Keyboard
 // NEW: Extern declaration for Mouse Interrupt Stub (must be in isr_asm.S)
+extern void isr40();
 extern void isr44();
 extern void isr46();
 extern void isr47();
+extern void isr48();  // Local APIC timer
+extern void isr49();  // Reschedule IPI
+extern void isr50();  // TLB shootdown IPI
+extern void isr255(); // Local APIC spurious
+extern uint32_t irq_stub_table[IRQ_APIC_VECTOR_COUNT]; // I/O APIC vectors
 
 idt_entry_t idt[256];
 idt_register_t idt_reg;
@@ -72,20 +89,6 @@ void set_idt_gate(int n, uint32_t handler)
     idt[n].base_high = (handler >> 16) & 0xFFFF;
 }
 
-void remap_pic()
-{
-    outb(0x20, 0x11);
-    outb(0xA0, 0x11);
-    outb(0x21, 0x20);
-    outb(0xA1, 0x28); // Slave start 40 (0x28)
-    outb(0x21, 0x04);
-    outb(0xA1, 0x02);
-    outb(0x21, 0x01);
-    outb(0xA1, 0x01);
-    outb(0x21, 0x00);
-    outb(0xA1, 0x00);
-}
-
 void init_idt()
 {
     idt_reg.base = (uint32_t)&idt;
@@ -118,18 +121,42 @@ void init_idt()
     // Existing IRQs
     set_idt_gate(32, (uint32_t)isr32);
     set_idt_gate(33, (uint32_t)isr33);
+    set_idt_gate(40, (uint32_t)isr40); // IRQ 8 (RTC)
     set_idt_gate(44, (uint32_t)isr44);
     set_idt_gate(128, (uint32_t)isr128);
     set_idt_gate(46, (uint32_t)isr46); // IRQ 14
     set_idt_gate(47, (uint32_t)isr47); // IRQ 15
+    set_idt_gate(LAPIC_TIMER_VECTOR, (uint32_t)isr48);
+    set_idt_gate(LAPIC_RESCHED_VECTOR, (uint32_t)isr49);
+    set_idt_gate(LAPIC_TLB_VECTOR, (uint32_t)isr50);
+    set_idt_gate(LAPIC_SPURIOUS_VECTOR, (uint32_t)isr255);
+    for (int i = 0; i < IRQ_APIC_VECTOR_COUNT; i++)
+        set_idt_gate(IRQ_APIC_VECTOR_FIRST + i, irq_stub_table[i]);
 
-    __asm__ volatile("lidt (%0)" : : "r"(&idt_reg));
+    idt_load();
     __asm__ volatile("sti");
 }
 
-void isr_handler(registers_t *regs)
+// All CPUs share the one IDT
+void idt_load()
+{
+    __asm__ volatile("lidt (%0)" : : "r"(&idt_reg));
+}
+
+static void isr_dispatch(registers_t *regs)
 {
     // 1. Handle CPU Exceptions (0-31)
+    // #NM is not an error: it is the lazy FPU switch trap
+    if (regs->int_no == 7)
+    {
+        fpu_handle_nm();
+        return;
+    }
+
+    // Writes to copy-on-write pages (restored snapshots) are resolved here
+    if (regs->int_no == 14 && vmm_handle_cow_fault(get_cr2(), regs->err_code))
+        return;
+
     if (regs->int_no < 32)
     {
         term_print("\n[CPU EXCEPTION] Code: ");
@@ -162,16 +189,48 @@ void isr_handler(registers_t *regs)
             __asm__("hlt");
     }
 
-    // 2. Handle IRQs (32+)
-    if (regs->int_no == 32)
+    // 2. Handle IRQs (32+), at the vectors the PIC or I/O APIC uses
+    int irq = irq_from_vector(regs->int_no);
+    if (irq == IRQ_TIMER || regs->int_no == LAPIC_TIMER_VECTOR)
     {
-        schedule();
+        // Acknowledge first: schedule() may switch to a process that never
+        // comes back through this frame
+        if (irq == IRQ_TIMER)
+            irq_eoi(irq);
+        else
+            lapic_eoi();
+
+        if (timer_interrupt())
+        {
+            // Polled submission rings are drained only when we interrupted user code
+            if ((regs->cs & 3) == 3 && current_process)
+                ring_poll(current_process);
+            if (sched_tick())
+                schedule();
+        }
+        return;
     }
-    else if (regs->int_no == 33)
+    else if (regs->int_no == LAPIC_RESCHED_VECTOR)
+    {
+        // Sent by another CPU that queued work for us (or for us to steal)
+        lapic_eoi();
+        if (sched_need_resched())
+            schedule();
+        return;
+    }
+    else if (regs->int_no == LAPIC_SPURIOUS_VECTOR)
+    {
+        return; // No EOI for spurious interrupts
+    }
+    else if (irq == IRQ_KEYBOARD)
     {
         keyboard_handler();
     }
-    else if (regs->int_no == 44)
+    else if (irq == IRQ_RTC)
+    {
+        clock_rtc_irq();
+    }
+    else if (irq == IRQ_MOUSE)
     {
         mouse_handler();
     }
@@ -180,17 +239,37 @@ void isr_handler(registers_t *regs)
         syscall_handler(regs);
     }
 
-    if (regs->int_no == 46 || regs->int_no == 47)
+    if (irq == IRQ_ATA)
     {
-        // We can leave this empty for now, or print "Disk IRQ"
-        // The important part is the ACK at the bottom of this function.
+        ata_irq();
     }
 
-    // ACK PIC
-    if (regs->int_no >= 32 && regs->int_no <= 47)
+    // ACK PIC / local APIC
+    if (irq >= 0)
     {
-        if (regs->int_no >= 40)
-            outb(0xA0, 0x20);
-        outb(0x20, 0x20);
+        irq_eoi(irq);
+
+        // The IRQ woke someone who outranks us (e.g. the shell on a key)
+        if (sched_need_resched())
+            schedule();
     }
-}
\ No newline at end of file
+}
+
+// Every way into the kernel from user mode or from halt comes through here
+// or sysenter_handler(), and takes the big kernel lock. A thread whose
+// process is exiting goes no further than the way back out.
+void isr_handler(registers_t *regs)
+{
+    // Except this one: the sender holds the lock while it waits for us
+    if (regs->int_no == LAPIC_TLB_VECTOR)
+    {
+        smp_tlb_flush_ack();
+        lapic_eoi();
+        return;
+    }
+
+    bkl_lock();
+    isr_dispatch(regs);
+    process_exit_if_killed(regs);
+    bkl_unlock();
+}
@@ -15,6 +15,7 @@ typedef struct {
 } registers_t;
 // Initialize IDT and PIC
 void init_idt();
+void idt_load();    // Each further CPU loads the same table
 
 // Struct for the IDT Register (similar to GDT ptr)
 typedef struct {
@@ -0,0 +1,55 @@
+/* src/cpu/ioapic.c */
+#include "ioapic.h"
+#include "../mm/vmm.h"
+
+// Registers are reached through an index/data window
+#define IOREGSEL 0x00
+#define IOWIN    0x10
+
+#define IOAPIC_VER   0x01
+#define IOAPIC_REDIR 0x10   // Two registers per line: low, high
+
+static volatile uint32_t* ioapic = 0;
+static uint32_t first_gsi = 0;
+static uint32_t line_count = 0;
+
+static uint32_t ioapic_read(uint8_t reg) {
+    ioapic[IOREGSEL / 4] = reg;
+    return ioapic[IOWIN / 4];
+}
+
+static void ioapic_write(uint8_t reg, uint32_t v) {
+    ioapic[IOREGSEL / 4] = reg;
+    ioapic[IOWIN / 4] = v;
+}
+
+int init_ioapic(uint32_t phys, uint32_t gsi_base) {
+    if (!phys) return 0;
+    vmm_map_page((void*)(phys & ~0xFFF), (void*)(phys & ~0xFFF),
+                 I86_PTE_PRESENT | I86_PTE_WRITABLE | I86_PTE_PCD);
+    ioapic = (volatile uint32_t*)phys;
+    first_gsi = gsi_base;
+    line_count = ((ioapic_read(IOAPIC_VER) >> 16) & 0xFF) + 1;
+
+    for (uint32_t i = 0; i < line_count; i++)
+        ioapic_write(IOAPIC_REDIR + 2 * i, IOAPIC_MASKED);
+    return 1;
+}
+
+int ioapic_handles(uint32_t gsi) {
+    return ioapic && gsi >= first_gsi && gsi - first_gsi < line_count;
+}
+
+// Fixed delivery, physical destination
+void ioapic_route(uint32_t gsi, uint8_t vector, uint32_t flags, uint8_t apic_id) {
+    uint8_t reg = IOAPIC_REDIR + 2 * (gsi - first_gsi);
+    ioapic_write(reg, IOAPIC_MASKED);   // Never half-programmed while live
+    ioapic_write(reg + 1, (uint32_t)apic_id << 24);
+    ioapic_write(reg, flags | vector);
+}
+
+void ioapic_set_masked(uint32_t gsi, int masked) {
+    uint8_t reg = IOAPIC_REDIR + 2 * (gsi - first_gsi);
+    uint32_t low = ioapic_read(reg);
+    ioapic_write(reg, masked ? (low | IOAPIC_MASKED) : (low & ~IOAPIC_MASKED));
+}
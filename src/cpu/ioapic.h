@@ -0,0 +1,23 @@
+/* src/cpu/ioapic.h */
+#ifndef IOAPIC_H
+#define IOAPIC_H
+
+#include <stdint.h>
+
+// I/O APIC: turns device interrupt lines (global system interrupts) into
+// messages to a local APIC. Each line has a redirection entry holding its
+// vector, polarity, trigger mode, mask and destination APIC ID.
+
+#define IOAPIC_ACTIVE_LOW (1 << 13)
+#define IOAPIC_LEVEL      (1 << 15)
+#define IOAPIC_MASKED     (1 << 16)
+
+// 1 if usable; every line starts masked. Maps the registers, so like
+// init_lapic() this must precede the first address space.
+int init_ioapic(uint32_t phys, uint32_t gsi_base);
+
+int ioapic_handles(uint32_t gsi);
+void ioapic_route(uint32_t gsi, uint8_t vector, uint32_t flags, uint8_t apic_id);
+void ioapic_set_masked(uint32_t gsi, int masked);
+
+#endif
@@ -0,0 +1,152 @@
+/* src/cpu/irq.c */
+#include "irq.h"
+#include "acpi.h"
+#include "ioapic.h"
+#include "lapic.h"
+#include "smp.h"
+#include "../drivers/serial.h"
+
+#define PIC1_CMD  0x20
+#define PIC1_DATA 0x21
+#define PIC2_CMD  0xA0
+#define PIC2_DATA 0xA1
+#define PIC_EOI   0x20
+
+// Under the I/O APIC, input first, then the disks, then the clock. IRQs
+// without a priority have no handler and stay masked.
+static const uint8_t irq_prio[IRQ_COUNT] = {
+    [IRQ_TIMER]    = IRQ_PRIO_NORMAL,   // Only if the tick comes from the PIT
+    [IRQ_KEYBOARD] = IRQ_PRIO_HIGH,
+    [IRQ_MOUSE]    = IRQ_PRIO_HIGH,
+    [IRQ_ATA]      = IRQ_PRIO_NORMAL,
+    [IRQ_ATA2]     = IRQ_PRIO_NORMAL,
+    [IRQ_RTC]      = IRQ_PRIO_LOW,
+};
+
+static int use_ioapic = 0;
+static uint16_t irq_masked = 0;         // Bit per IRQ, set by irq_mask()
+static int irq_cpu[IRQ_COUNT];          // cpus[] index each IRQ is sent to
+
+static int irq_apic_vector(int irq) {
+    return 0x30 + 0x10 * irq_prio[irq] + irq;
+}
+
+// --- 8259 PIC ---
+
+void remap_pic()
+{
+    outb(PIC1_CMD, 0x11);
+    outb(PIC2_CMD, 0x11);
+    outb(PIC1_DATA, IRQ_PIC_VECTOR);
+    outb(PIC2_DATA, IRQ_PIC_VECTOR + 8); // Slave start 40 (0x28)
+    outb(PIC1_DATA, 0x04);
+    outb(PIC2_DATA, 0x02);
+    outb(PIC1_DATA, 0x01);
+    outb(PIC2_DATA, 0x01);
+    outb(PIC1_DATA, 0x00);
+    outb(PIC2_DATA, 0x00);
+}
+
+static void pic_write_masks() {
+    outb(PIC1_DATA, irq_masked & 0xFF);
+    outb(PIC2_DATA, irq_masked >> 8);
+}
+
+// --- I/O APIC ---
+
+static void irq_route(int irq) {
+    uint32_t gsi = acpi_madt.isa_gsi[irq];
+    uint16_t inti = acpi_madt.isa_flags[irq];
+    if (!ioapic_handles(gsi)) return;
+
+    uint32_t flags = 0;
+    if ((inti & ACPI_IRQ_ACTIVE_LOW) == ACPI_IRQ_ACTIVE_LOW) flags |= IOAPIC_ACTIVE_LOW;
+    if ((inti & ACPI_IRQ_LEVEL) == ACPI_IRQ_LEVEL) flags |= IOAPIC_LEVEL;
+    if ((irq_masked & (1 << irq)) || irq_prio[irq] == IRQ_PRIO_NONE) flags |= IOAPIC_MASKED;
+
+    ioapic_route(gsi, irq_apic_vector(irq), flags, cpus[irq_cpu[irq]].apic_id);
+}
+
+// The local APIC's ID is needed for the destinations, so init_lapic() first
+void init_irq() {
+    if (!lapic_available() || !init_ioapic(acpi_madt.ioapic_base, acpi_madt.ioapic_gsi_base)) {
+        serial_log(" [IRQ] 8259 PIC.\n");
+        return;
+    }
+
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    outb(PIC1_DATA, 0xFF);  // The PIC stays programmed but silent
+    outb(PIC2_DATA, 0xFF);
+    cpus[0].apic_id = lapic_id();
+    use_ioapic = 1;
+    for (int irq = 0; irq < IRQ_COUNT; irq++) {
+        irq_cpu[irq] = 0;
+        irq_route(irq);
+    }
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    serial_log(" [IRQ] I/O APIC.\n");
+}
+
+// --- Interface ---
+
+int irq_from_vector(int vector) {
+    if (use_ioapic) {
+        if (vector < IRQ_APIC_VECTOR_FIRST || vector >= IRQ_APIC_VECTOR_FIRST + IRQ_APIC_VECTOR_COUNT)
+            return -1;
+        return vector & 0xF;
+    }
+    if (vector < IRQ_PIC_VECTOR || vector >= IRQ_PIC_VECTOR + IRQ_COUNT) return -1;
+    return vector - IRQ_PIC_VECTOR;
+}
+
+int irq_vector(int irq) {
+    if (irq < 0 || irq >= IRQ_COUNT || (irq_masked & (1 << irq))) return -1;
+    if (!use_ioapic) return IRQ_PIC_VECTOR + irq;
+    if (irq_prio[irq] == IRQ_PRIO_NONE || !ioapic_handles(acpi_madt.isa_gsi[irq])) return -1;
+    return irq_apic_vector(irq);
+}
+
+void irq_eoi(int irq) {
+    if (use_ioapic) {
+        lapic_eoi();
+        return;
+    }
+    if (irq >= 8) outb(PIC2_CMD, PIC_EOI);
+    outb(PIC1_CMD, PIC_EOI);
+}
+
+void irq_mask(int irq) {
+    if (irq < 0 || irq >= IRQ_COUNT) return;
+    irq_masked |= 1 << irq;
+    if (!use_ioapic) pic_write_masks();
+    else if (ioapic_handles(acpi_madt.isa_gsi[irq])) ioapic_set_masked(acpi_madt.isa_gsi[irq], 1);
+}
+
+void irq_unmask(int irq) {
+    if (irq < 0 || irq >= IRQ_COUNT) return;
+    irq_masked &= ~(1 << irq);
+    if (!use_ioapic) pic_write_masks();
+    else irq_route(irq);
+}
+
+int irq_set_affinity(int irq, int cpu) {
+    if (!use_ioapic || irq < 0 || irq >= IRQ_COUNT || irq_prio[irq] == IRQ_PRIO_NONE) return -1;
+    if (cpu < 0 || cpu >= cpu_count || !cpus[cpu].online) return -1;
+
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    irq_cpu[irq] = cpu;
+    irq_route(irq);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return 0;
+}
+
+int irq_get_affinity(int irq) {
+    if (irq < 0 || irq >= IRQ_COUNT) return -1;
+    return use_ioapic ? irq_cpu[irq] : 0;
+}
+
+const char* irq_controller_name() {
+    return use_ioapic ? "I/O APIC" : "8259 PIC";
+}
@@ -0,0 +1,44 @@
+/* src/cpu/irq.h */
+#ifndef IRQ_H
+#define IRQ_H
+
+#include <stdint.h>
+
+// Device interrupts, by ISA IRQ number. With an I/O APIC each IRQ gets a
+// vector in the priority class of its device (the local APIC delivers
+// higher classes first), can be sent to any CPU, and is acknowledged
+// with the local APIC's MMIO EOI. Without one the 8259 PIC delivers IRQ n
+// on vector IRQ_PIC_VECTOR + n, with its fixed priorities and port EOIs.
+
+#define IRQ_TIMER    0
+#define IRQ_KEYBOARD 1
+#define IRQ_RTC      8
+#define IRQ_MOUSE    12
+#define IRQ_ATA      14
+#define IRQ_ATA2     15
+#define IRQ_COUNT    16
+
+#define IRQ_PIC_VECTOR 32
+
+// Priorities under the I/O APIC: vector = 0x30 + 0x10 * priority + IRQ
+#define IRQ_PRIO_NONE   0       // Not routed
+#define IRQ_PRIO_LOW    1
+#define IRQ_PRIO_NORMAL 2
+#define IRQ_PRIO_HIGH   3
+#define IRQ_APIC_VECTOR_FIRST 0x40
+#define IRQ_APIC_VECTOR_COUNT 48
+
+void remap_pic();               // IRQs 0-15 to vectors 32-47, all unmasked
+void init_irq();                // Switch to the I/O APIC if there is one; after init_acpi() and init_timer()
+
+int irq_from_vector(int vector); // -1 if not a device interrupt
+int irq_vector(int irq);         // Where it arrives now, -1 if masked/unrouted
+void irq_eoi(int irq);
+void irq_mask(int irq);
+void irq_unmask(int irq);
+
+int irq_set_affinity(int irq, int cpu); // 0, or -1 (no I/O APIC, bad IRQ or CPU)
+int irq_get_affinity(int irq);
+const char* irq_controller_name();
+
+#endif
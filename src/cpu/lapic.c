@@ -0,0 +1,144 @@
+/* src/cpu/lapic.c */
+#include "lapic.h"
+#include "cpu.h"
+#include "../mm/vmm.h"
+#include "../drivers/pit.h"
+
+extern void serial_log(char* str);
+extern uint64_t div_u64(uint64_t n, uint32_t d, uint32_t* rem);
+
+#define IA32_APIC_BASE   0x1B
+#define APIC_BASE_ENABLE (1 << 11)
+
+// Register offsets
+#define LAPIC_ID         0x020
+#define LAPIC_EOI        0x0B0
+#define LAPIC_SVR        0x0F0
+#define LAPIC_ICR_LOW    0x300
+#define LAPIC_ICR_HIGH   0x310
+#define LAPIC_LVT_TIMER  0x320
+#define LAPIC_TIMER_INIT 0x380
+#define LAPIC_TIMER_CUR  0x390
+#define LAPIC_TIMER_DIV  0x3E0
+
+#define SVR_ENABLE    (1 << 8)
+#define LVT_MASKED    (1 << 16)
+#define LVT_PERIODIC  (1 << 17)
+#define TIMER_DIV_16  0x3
+
+// Interrupt command register
+#define ICR_FIXED     0x000
+#define ICR_INIT      0x500
+#define ICR_STARTUP   0x600
+#define ICR_PENDING   (1 << 12)
+#define ICR_ASSERT    (1 << 14)
+#define ICR_LEVEL     (1 << 15)
+
+static volatile uint32_t* lapic = 0;
+static uint32_t ticks_per_ms = 0; // Timer counts per millisecond at divide-by-16
+static uint32_t armed_count = 0;  // Initial count of the running timer
+
+static inline uint32_t lapic_read(uint32_t reg) { return lapic[reg / 4]; }
+static inline void lapic_write(uint32_t reg, uint32_t v) { lapic[reg / 4] = v; }
+
+// Timer counts <-> nanoseconds
+static uint64_t ns_to_count(uint64_t ns) { return div_u64(ns * ticks_per_ms, 1000000, 0); }
+static uint64_t count_to_ns(uint64_t count) { return div_u64(count * 1000000, ticks_per_ms, 0); }
+
+// Must run before the first user address space is created: the MMIO
+// page's table is then inherited by every process (supervisor only).
+int init_lapic() {
+    if (!cpu_has_edx1(CPUID_EDX_APIC) || !cpu_has_edx1(CPUID_EDX_MSR)) return 0;
+
+    uint64_t base_msr = rdmsr(IA32_APIC_BASE);
+    uint32_t base = (uint32_t)base_msr & 0xFFFFF000;
+    vmm_map_page((void*)base, (void*)base, I86_PTE_PRESENT | I86_PTE_WRITABLE | I86_PTE_PCD);
+    lapic = (volatile uint32_t*)base;
+    lapic_init_cpu();
+
+    // Count down from the top for 10ms of PIT channel 2
+    uint8_t gate = pit_gate_start(PIT_BASE_HZ / 100);
+    lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFF);
+    while (!pit_gate_expired());
+    uint32_t elapsed = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CUR);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+    pit_gate_stop(gate);
+
+    ticks_per_ms = elapsed / 10;
+    if (!ticks_per_ms) {
+        lapic = 0;
+        return 0;
+    }
+    serial_log(" [LAPIC] Timer calibrated.\n");
+    return 1;
+}
+
+// Every CPU's APIC sits at the same address; each one enables its own
+void lapic_init_cpu() {
+    wrmsr(IA32_APIC_BASE, rdmsr(IA32_APIC_BASE) | APIC_BASE_ENABLE);
+    lapic_write(LAPIC_SVR, SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+    lapic_write(LAPIC_LVT_TIMER, LVT_MASKED | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_DIV, TIMER_DIV_16);
+}
+
+int lapic_available() {
+    return lapic != 0;
+}
+
+void lapic_eoi() {
+    lapic_write(LAPIC_EOI, 0);
+}
+
+uint8_t lapic_id() {
+    return lapic_read(LAPIC_ID) >> 24;
+}
+
+// --- Inter-Processor Interrupts ---
+
+static void lapic_send(uint8_t apic_id, uint32_t icr) {
+    lapic_write(LAPIC_ICR_HIGH, (uint32_t)apic_id << 24);
+    lapic_write(LAPIC_ICR_LOW, icr);
+    while (lapic_read(LAPIC_ICR_LOW) & ICR_PENDING);
+}
+
+void lapic_send_ipi(uint8_t apic_id, uint8_t vector) {
+    lapic_send(apic_id, ICR_FIXED | ICR_ASSERT | vector);
+}
+
+void lapic_send_init(uint8_t apic_id) {
+    lapic_send(apic_id, ICR_INIT | ICR_LEVEL | ICR_ASSERT);
+    lapic_send(apic_id, ICR_INIT | ICR_LEVEL);  // De-assert
+}
+
+void lapic_send_startup(uint8_t apic_id, uint32_t entry) {
+    lapic_send(apic_id, ICR_STARTUP | (entry >> 12));
+}
+
+uint32_t lapic_timer_periodic(uint32_t hz) {
+    uint32_t count = ticks_per_ms * 1000 / hz;
+    if (!count) count = 1;
+    lapic_write(LAPIC_LVT_TIMER, LVT_PERIODIC | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_INIT, count);
+    armed_count = count;
+    return (uint32_t)count_to_ns(count);
+}
+
+uint64_t lapic_timer_oneshot(uint64_t ns) {
+    uint64_t count = ns_to_count(ns);
+    if (count < 1) count = 1;
+    if (count > 0xFFFFFFFF) count = 0xFFFFFFFF;
+    lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_INIT, (uint32_t)count);
+    armed_count = (uint32_t)count;
+    return count_to_ns(count);
+}
+
+uint64_t lapic_timer_elapsed_ns() {
+    return count_to_ns(armed_count - lapic_read(LAPIC_TIMER_CUR));
+}
+
+void lapic_timer_stop() {
+    lapic_write(LAPIC_LVT_TIMER, LVT_MASKED | LAPIC_TIMER_VECTOR);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+    armed_count = 0;
+}
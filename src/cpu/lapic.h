@@ -0,0 +1,31 @@
+/* src/cpu/lapic.h */
+#ifndef LAPIC_H
+#define LAPIC_H
+
+#include <stdint.h>
+
+// Local APIC: its timer, IPIs between CPUs, and the EOI for everything it
+// delivers. Device interrupts reach it from the I/O APIC (irq.c), or
+// without one from the 8259 PIC through the boot CPU's LINT0, which the
+// BIOS leaves in virtual-wire mode.
+#define LAPIC_TIMER_VECTOR    48
+#define LAPIC_RESCHED_VECTOR  49    // IPI: look at your run queue
+#define LAPIC_TLB_VECTOR      50    // IPI: flush your TLB (smp_tlb_shootdown)
+#define LAPIC_SPURIOUS_VECTOR 255
+
+int init_lapic();                          // 1 if present, enabled and calibrated
+void lapic_init_cpu();                     // Enable this CPU's APIC, timer masked
+int lapic_available();
+void lapic_eoi();
+uint8_t lapic_id();
+
+void lapic_send_ipi(uint8_t apic_id, uint8_t vector);
+void lapic_send_init(uint8_t apic_id);
+void lapic_send_startup(uint8_t apic_id, uint32_t entry); // entry: page-aligned, below 1MB
+
+uint32_t lapic_timer_periodic(uint32_t hz); // Returns the period in ns
+uint64_t lapic_timer_oneshot(uint64_t ns);  // Returns the length actually programmed
+uint64_t lapic_timer_elapsed_ns();          // Since the last arm
+void lapic_timer_stop();
+
+#endif
@@ -0,0 +1,179 @@
+/* src/cpu/smp.c */
+#include "smp.h"
+#include "acpi.h"
+#include "lapic.h"
+#include "fpu.h"
+#include "../kernel/process.h"
+#include "../kernel/memops.h"
+#include "../kernel/timer.h"
+#include "../drivers/pit.h"
+#include "../drivers/serial.h"
+
+extern void ap_trampoline();
+extern void ap_trampoline_end();
+extern uint32_t ap_boot_cr3, ap_boot_stack, ap_boot_entry;
+extern void switch_task(uint32_t *old_esp_ptr, uint32_t new_esp);
+extern void idt_load();
+extern void syscall_init_cpu();
+extern page_directory_t* kernel_directory;
+extern uint64_t div_u64(uint64_t n, uint32_t d, uint32_t* rem);
+
+cpu_t cpus[SMP_MAX_CPUS] = { [0] = { .online = 1 } };
+int cpu_count = 1;
+
+static volatile uint32_t kernel_lock = 0;
+static volatile int tlb_flush_pending[SMP_MAX_CPUS];
+
+// Only used until the AP switches into its idle task
+#define AP_BOOT_STACK_SIZE 2048
+static uint8_t ap_boot_stacks[SMP_MAX_CPUS][AP_BOOT_STACK_SIZE] __attribute__((aligned(16)));
+static volatile int ap_starting = 0; // cpus[] index of the AP being started
+
+// The trampoline's variables, in the copy at SMP_TRAMPOLINE
+#define TRAMPOLINE_VAR(sym) \
+    (*(volatile uint32_t*)(SMP_TRAMPOLINE + ((uint32_t)&(sym) - (uint32_t)ap_trampoline)))
+
+// --- Big Kernel Lock ---
+// Interrupts are off in all of these: an interrupt taking the lock in
+// between would see a half-updated depth.
+
+// A shootdown may be waiting on us while we spin, with interrupts off
+static void kernel_lock_acquire() {
+    while (__sync_lock_test_and_set(&kernel_lock, 1))
+        while (kernel_lock) {
+            smp_tlb_flush_ack();
+            __asm__ volatile("pause");
+        }
+}
+
+void bkl_lock() {
+    cpu_t* cpu = this_cpu();
+    if (cpu->bkl_depth++) return;
+    kernel_lock_acquire();
+}
+
+void bkl_unlock() {
+    cpu_t* cpu = this_cpu();
+    if (--cpu->bkl_depth) return;
+    __sync_lock_release(&kernel_lock);
+}
+
+// Other CPUs may use the kernel while we sleep; the interrupt that wakes
+// us takes the lock for itself. Only idle tasks halt, and they never
+// migrate, so this is still our CPU afterwards.
+void bkl_halt() {
+    cpu_t* cpu = this_cpu();
+    int depth = cpu->bkl_depth;
+    cpu->bkl_depth = 0;
+    if (depth) __sync_lock_release(&kernel_lock);
+    __asm__ volatile("sti; hlt; cli");
+    if (depth) kernel_lock_acquire();
+    cpu->bkl_depth = depth;
+}
+
+// --- Inter-Processor Interrupts ---
+
+void smp_send_resched(int cpu) {
+    if (cpu == this_cpu()->id || !cpus[cpu].online) return;
+    lapic_send_ipi(cpus[cpu].apic_id, LAPIC_RESCHED_VECTOR);
+}
+
+// --- TLB Shootdown ---
+// The other CPUs answer without the big kernel lock: from the IPI
+// (isr_handler) if they run user code or halt, from kernel_lock_acquire()
+// if they are spinning for the lock. Nothing else runs with it dropped
+// and interrupts off, so the wait below always ends.
+
+void smp_tlb_flush_ack() {
+    int id = this_cpu()->id;
+    if (!tlb_flush_pending[id]) return;
+    uint32_t cr3;
+    __asm__ volatile("mov %%cr3, %0; mov %0, %%cr3" : "=r"(cr3) : : "memory");
+    tlb_flush_pending[id] = 0;
+}
+
+void smp_tlb_shootdown(uint32_t cr3) {
+    int me = this_cpu()->id;
+    for (int i = 0; i < cpu_count; i++) {
+        if (i == me || !cpus[i].online || !cpus[i].current || cpus[i].current->cr3 != cr3) continue;
+        tlb_flush_pending[i] = 1;
+        lapic_send_ipi(cpus[i].apic_id, LAPIC_TLB_VECTOR);
+    }
+    for (int i = 0; i < cpu_count; i++)
+        while (tlb_flush_pending[i]) __asm__ volatile("pause");
+}
+
+// --- AP Startup ---
+
+// PIT channel 2 as a stopwatch: interrupts may be off. Up to 54ms.
+static void smp_delay_us(uint32_t us) {
+    uint8_t gate = pit_gate_start((uint16_t)div_u64((uint64_t)us * PIT_BASE_HZ, 1000000, 0));
+    while (!pit_gate_expired());
+    pit_gate_stop(gate);
+}
+
+// First C code on an AP: paging is on, the stack is ap_boot_stacks[n]
+static void ap_main() {
+    cpu_t* cpu = &cpus[ap_starting];
+
+    gdt_init_cpu(cpu->id); // this_cpu() works from here on
+    idt_load();
+    fpu_init_cpu();
+    syscall_init_cpu();
+    lapic_init_cpu();
+    lapic_timer_periodic(timer_get_hz()); // Drives only our scheduler
+    cpu->online = 1;                      // The boot CPU moves on to the next AP
+
+    // Into the idle task, which takes work once the lock is ours
+    bkl_lock();
+    process_t* idle = cpu->idle;
+    cpu->current = idle;
+    idle->last_cpu = cpu->id;
+    tss_set_stack(0x10, (uint32_t)idle->kernel_stack_ptr + KERNEL_STACK_SIZE);
+    uint32_t boot_esp;
+    switch_task(&boot_esp, idle->esp);
+}
+
+static int smp_start_ap(int id, uint8_t apic_id) {
+    cpu_t* cpu = &cpus[id];
+    cpu->id = id;
+    cpu->apic_id = apic_id;
+    if (!cpu->idle) cpu->idle = process_create_idle(id);
+
+    TRAMPOLINE_VAR(ap_boot_cr3) = (uint32_t)kernel_directory;
+    TRAMPOLINE_VAR(ap_boot_stack) = (uint32_t)ap_boot_stacks[id] + AP_BOOT_STACK_SIZE;
+    TRAMPOLINE_VAR(ap_boot_entry) = (uint32_t)ap_main;
+    ap_starting = id;
+
+    // INIT, then STARTUP twice: a CPU that took the first ignores the second
+    lapic_send_init(apic_id);
+    smp_delay_us(10000);
+    for (int i = 0; i < 2 && !cpu->online; i++) {
+        lapic_send_startup(apic_id, SMP_TRAMPOLINE);
+        smp_delay_us(200);
+    }
+    for (int ms = 0; ms < 100 && !cpu->online; ms++)
+        smp_delay_us(1000);
+    return cpu->online;
+}
+
+// The APs spin on the kernel lock until this CPU next leaves the kernel
+void init_smp() {
+    if (!lapic_available() || acpi_madt.cpu_count < 2) {
+        serial_log(" [SMP] Single processor.\n");
+        return;
+    }
+    cpus[0].apic_id = lapic_id();
+    memcpy((void*)SMP_TRAMPOLINE, (void*)ap_trampoline, (uint32_t)ap_trampoline_end - (uint32_t)ap_trampoline);
+
+    for (int i = 0; i < acpi_madt.cpu_count && cpu_count < SMP_MAX_CPUS; i++) {
+        uint8_t apic_id = acpi_madt.cpu_apic_id[i];
+        if (apic_id == cpus[0].apic_id) continue;
+        if (smp_start_ap(cpu_count, apic_id)) cpu_count++;
+        else serial_log(" [SMP] A processor did not start.\n");
+    }
+
+    serial_log(" [SMP] Processors online: ");
+    serial_write_char('0' + cpu_count); // SMP_MAX_CPUS < 10
+    serial_log("\n");
+}
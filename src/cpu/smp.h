@@ -0,0 +1,58 @@
+/* src/cpu/smp.h */
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdint.h>
+#include "gdt.h"
+
+// Symmetric multiprocessing. The boot CPU finds the others in the ACPI
+// MADT and starts each one with INIT/SIPI into a real-mode trampoline
+// copied to SMP_TRAMPOLINE. Every CPU has its own TSS (and so its own
+// kernel stack on entry), idle task and run queue (sched.c).
+//
+// The kernel itself is still written for one CPU, with interrupts off
+// around critical sections. The big kernel lock keeps that true: a CPU
+// takes it on every entry from user mode or from halt and drops it on
+// the way back out, so user code runs on all CPUs at once while kernel
+// code runs on one at a time. It nests per CPU, and the depth travels
+// with the process across context switches (schedule()).
+
+#define SMP_MAX_CPUS   8
+#define SMP_TRAMPOLINE 0x8000   // Below 1MB and inside the first 4MB the PMM never hands out
+
+struct process;
+
+typedef struct cpu {
+    int id;                     // Index into cpus[], 0 = boot CPU
+    uint8_t apic_id;
+    volatile int online;
+    struct process* current;    // Running here (current_process)
+    struct process* idle;       // Runs when nothing else can; never queued
+    int bkl_depth;              // Big kernel lock nesting, 0 while in user mode
+} cpu_t;
+
+extern cpu_t cpus[SMP_MAX_CPUS];
+extern int cpu_count;           // Online CPUs
+
+// TR holds this CPU's TSS selector (gdt_init_cpu), which gives its index
+static inline cpu_t* this_cpu() {
+    uint16_t tr;
+    __asm__ volatile("str %0" : "=r"(tr));
+    return &cpus[(tr >> 3) - GDT_TSS_FIRST];
+}
+
+#define current_process (this_cpu()->current)
+
+void init_smp();                // Start the other CPUs; after init_multitasking()
+void smp_send_resched(int cpu); // IPI: look at your run queue
+
+// After changing a live mapping of address space cr3 in place (big kernel
+// lock held): returns once every other CPU running it has flushed its TLB
+void smp_tlb_shootdown(uint32_t cr3);
+void smp_tlb_flush_ack();       // Interrupts off: flush if asked to
+
+void bkl_lock();
+void bkl_unlock();
+void bkl_halt();                // sti; hlt; cli without holding the lock; interrupts off
+
+#endif
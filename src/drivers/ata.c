@@ -1,9 +1,9 @@
 /* src/drivers/ata.c */
 #include "ata.h"
 #include "serial.h"
-
-// Extern scheduler
-extern void schedule();
+#include "../kernel/process.h"
+#include "../kernel/wait.h"
+#include "../kernel/sync.h"
 
 #define ATA_DATA        0x1F0
 #define ATA_ERROR       0x1F1
@@ -22,32 +22,43 @@ extern void schedule();
 #define STATUS_DRQ      0x08 
 #define STATUS_ERR      0x01
 
-// Simple spinlock for ATA driver to prevent race conditions
-static volatile int ata_lock = 0;
+// The drive raises IRQ 14 when a command step completes; waiters also
+// re-check the status this often in case an interrupt was missed
+#define ATA_IRQ_TIMEOUT_NS 10000000ULL
 
-void ata_acquire() {
-    while (__sync_lock_test_and_set(&ata_lock, 1)) {
-        schedule(); // Yield while waiting for lock
-    }
+// One request at a time; later callers sleep until it is released
+static mutex_t ata_mutex = MUTEX_INIT("ata");
+static wait_queue_t ata_irq_wait = WAIT_QUEUE_INIT;
+
+// IRQ 14. Reading the status also clears the drive's interrupt.
+void ata_irq() {
+    inb(ATA_STATUS);
+    wait_queue_wake_all(&ata_irq_wait);
 }
 
-void ata_release() {
-    __sync_lock_release(&ata_lock);
+// Sleep until the status matches: all of 'set' set and BSY clear (or ERR,
+// when asked to stop on it). Before multitasking nobody can sleep: poll.
+static void ata_wait_status(uint8_t set, int stop_on_err) {
+    while (1) {
+        uint32_t eflags;
+        __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+        uint8_t status = inb(ATA_STATUS);
+        int done = !(status & STATUS_BSY) && ((status & set) == set || (stop_on_err && (status & STATUS_ERR)));
+        if (!done && current_process)
+            wait_queue_wait(&ata_irq_wait, ATA_IRQ_TIMEOUT_NS);
+        __asm__ volatile("push %0; popf" : : "r"(eflags));
+        if (done) return;
+    }
 }
 
 void ata_wait_busy() {
     // Wait until BSY clears
-    while (inb(ATA_STATUS) & STATUS_BSY) {
-        schedule();
-    }
+    ata_wait_status(0, 0);
 }
 
 void ata_wait_drq() {
     // Wait until DRQ sets or ERR sets
-    while (!(inb(ATA_STATUS) & STATUS_DRQ)) {
-        if (inb(ATA_STATUS) & STATUS_ERR) return; // Bail on error
-        schedule();
-    }
+    ata_wait_status(STATUS_DRQ, 1);
 }
 
 uint16_t insw(uint16_t port) {
@@ -61,7 +72,7 @@ void outsw(uint16_t port, uint16_t val) {
 }
 
 void init_ata() {
-    ata_acquire();
+    mutex_lock(&ata_mutex);
     outb(ATA_DRIVE_HEAD, 0xA0);
     outb(ATA_SEC_COUNT, 0);
     outb(ATA_LBA_LO, 0);
@@ -71,7 +82,7 @@ void init_ata() {
     uint8_t status = inb(ATA_STATUS);
     if (status == 0) {
         serial_log(" [ATA] No drive found.\n");
-        ata_release();
+        mutex_unlock(&ata_mutex);
         return;
     }
     
@@ -80,11 +91,11 @@ void init_ata() {
         insw(ATA_DATA);
     }
     serial_log(" [ATA] Primary Master Drive initialized.\n");
-    ata_release();
+    mutex_unlock(&ata_mutex);
 }
 
 void ata_read_sectors(uint32_t lba, uint8_t count, uint32_t* target) {
-    ata_acquire();
+    mutex_lock(&ata_mutex);
     
     ata_wait_busy();
     outb(ATA_DRIVE_HEAD, 0xE0 | ((lba >> 24) & 0x0F));
@@ -104,11 +115,11 @@ void ata_read_sectors(uint32_t lba, uint8_t count, uint32_t* target) {
         t += 256;
     }
     
-    ata_release();
+    mutex_unlock(&ata_mutex);
 }
 
 void ata_write_sectors(uint32_t lba, uint8_t count, uint32_t* source) {
-    ata_acquire();
+    mutex_lock(&ata_mutex);
     
     ata_wait_busy();
     outb(ATA_DRIVE_HEAD, 0xE0 | ((lba >> 24) & 0x0F));
@@ -129,5 +140,5 @@ void ata_write_sectors(uint32_t lba, uint8_t count, uint32_t* source) {
         s += 256;
     }
     
-    ata_release();
+    mutex_unlock(&ata_mutex);
 }
\ No newline at end of file
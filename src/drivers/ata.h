@@ -15,4 +15,7 @@ void ata_read_sectors(uint32_t lba, uint8_t count, uint32_t* target);
 // Write sectors from a buffer to disk
 void ata_write_sectors(uint32_t lba, uint8_t count, uint32_t* source);
 
+// IRQ 14: wakes the request waiting for the drive
+void ata_irq();
+
 #endif
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <stdint.h>
 #include "../kernel/multiboot.h"
 #include "../mm/vmm.h" // Ensures vmm_map_page is available
+#include "../kernel/memops.h"
 
 uint32_t* framebuffer = 0;
 int screen_w = 0;
@@ -25,8 +26,7 @@ void put_pixel(int x, int y, uint32_t color) {
 
 // Function to clear screen fast
 void graphics_clear(uint32_t color) {
-    uint32_t size = screen_w * screen_h;
-    for(uint32_t i=0; i<size; i++) framebuffer[i] = color;
+    memset32(framebuffer, color, screen_w * screen_h);
 }
 
 void init_graphics(multiboot_info_t* mboot) {
@@ -1,6 +1,7 @@
 #include <stdint.h>
 #include "../drivers/vga.h"
 #include "../kernel/process.h"
+#include "tty.h"
 #include <stdbool.h>
 
 extern uint8_t inb(uint16_t port);
@@ -28,6 +29,22 @@ char kbd_buffer_read() {
     return c;
 }
 
+int kbd_buffer_count() {
+    return (write_ptr - read_ptr + KBD_BUFFER_SIZE) % KBD_BUFFER_SIZE;
+}
+
+int kbd_buffer_free() {
+    return KBD_BUFFER_SIZE - 1 - kbd_buffer_count();
+}
+
+// How many queued bytes equal c (the TTY recounts lines with this)
+int kbd_buffer_count_of(char c) {
+    int n = 0;
+    for (int i = read_ptr; i != write_ptr; i = (i + 1) % KBD_BUFFER_SIZE)
+        if (kbd_buffer[i] == c) n++;
+    return n;
+}
+
 // Lowercase / Default Map
 char kbd_US_low[128] = {
     0,  27, '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '-', '=', '\b',
@@ -89,8 +106,7 @@ void keyboard_handler() {
         }
 
         if (c != 0) {
-            kbd_buffer_write(c);
-            process_unblock(1);
+            tty_input(c);
         }
     }
 }
\ No newline at end of file
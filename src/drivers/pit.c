@@ -0,0 +1,61 @@
+/* src/drivers/pit.c */
+#include "pit.h"
+#include "serial.h" // for outb/inb
+
+#define PIT_CH0  0x40
+#define PIT_CH2  0x42
+#define PIT_CMD  0x43
+#define PIT_GATE 0x61 // Bit 0 gates channel 2, bit 1 drives the speaker, bit 5 is channel 2's output
+
+static void pit_load(uint8_t port, uint32_t count) {
+    // A count of 0 means 65536
+    outb(port, count & 0xFF);
+    outb(port, (count >> 8) & 0xFF);
+}
+
+uint32_t pit_set_periodic(uint32_t hz) {
+    uint32_t divisor = hz ? PIT_BASE_HZ / hz : PIT_MAX_COUNT;
+    if (divisor < 2) divisor = 2;
+    if (divisor > PIT_MAX_COUNT) divisor = PIT_MAX_COUNT;
+
+    outb(PIT_CMD, 0x34); // Channel 0, lo/hi, mode 2 (rate generator)
+    pit_load(PIT_CH0, divisor);
+    return divisor;
+}
+
+uint32_t pit_set_oneshot(uint32_t count) {
+    if (count < 1) count = 1;
+    if (count > PIT_MAX_COUNT - 1) count = PIT_MAX_COUNT - 1;
+
+    outb(PIT_CMD, 0x30); // Channel 0, lo/hi, mode 0 (interrupt on terminal count)
+    pit_load(PIT_CH0, count);
+    return count;
+}
+
+uint32_t pit_read_count() {
+    outb(PIT_CMD, 0x00); // Latch channel 0
+    uint32_t lo = inb(PIT_CH0);
+    uint32_t hi = inb(PIT_CH0);
+    return (hi << 8) | lo;
+}
+
+uint8_t pit_gate_start(uint16_t count) {
+    uint8_t saved = inb(PIT_GATE);
+    outb(PIT_GATE, (saved & ~0x02) | 0x01); // Speaker off, gate on
+    outb(PIT_CMD, 0xB0);                    // Channel 2, lo/hi, mode 0
+    pit_load(PIT_CH2, count);
+
+    // Restart the count by toggling the gate
+    uint8_t v = inb(PIT_GATE);
+    outb(PIT_GATE, v & ~0x01);
+    outb(PIT_GATE, v | 0x01);
+    return saved;
+}
+
+int pit_gate_expired() {
+    return (inb(PIT_GATE) & 0x20) != 0;
+}
+
+void pit_gate_stop(uint8_t saved) {
+    outb(PIT_GATE, saved);
+}
@@ -0,0 +1,21 @@
+/* src/drivers/pit.h */
+#ifndef PIT_H
+#define PIT_H
+
+#include <stdint.h>
+
+// 8253/8254 Programmable Interval Timer. Channel 0 drives IRQ 0; channel 2
+// (speaker gate, output not connected) is used as a calibration stopwatch.
+#define PIT_BASE_HZ 1193182
+#define PIT_MAX_COUNT 65536
+
+uint32_t pit_set_periodic(uint32_t hz);   // Returns the divisor actually used
+uint32_t pit_set_oneshot(uint32_t count); // IRQ 0 once after 'count' input ticks; returns the count used
+uint32_t pit_read_count();                // Channel 0 counts left
+
+// Channel 2 stopwatch: start, spin on expired(), then stop with start's result
+uint8_t pit_gate_start(uint16_t count);
+int pit_gate_expired();
+void pit_gate_stop(uint8_t saved);
+
+#endif
@@ -1,16 +1,8 @@
+/* src/drivers/rtc.c */
 #include <stdint.h>
+#include "rtc.h"
 #include "serial.h" // for outb/inb
 
-// Time Structure
-typedef struct {
-    uint8_t second;
-    uint8_t minute;
-    uint8_t hour;
-    uint8_t day;
-    uint8_t month;
-    uint16_t year;
-} rtc_time_t;
-
 int rtc_updating() {
     outb(0x70, 0x0A);
     return (inb(0x71) & 0x80);
@@ -55,4 +47,24 @@ void get_rtc_time(rtc_time_t* t) {
         t->month  = month;
         t->year   = year + 2000;
     }
-}
\ No newline at end of file
+}
+
+// Update-ended interrupt (IRQ 8): fires once a second right after the RTC
+// finishes ticking, so the registers are stable when we read them.
+void rtc_enable_update_irq() {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+
+    outb(0x70, 0x8B); // Register B, NMI disabled while we touch it
+    uint8_t prev = inb(0x71);
+    outb(0x70, 0x8B);
+    outb(0x71, prev | 0x10); // UIE
+    read_register(0x0C);     // Clear any pending flag so the line can fire
+
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+// Register C must be read after every RTC interrupt or no more will arrive
+void rtc_ack_irq() {
+    read_register(0x0C);
+}
@@ -0,0 +1,21 @@
+/* src/drivers/rtc.h */
+#ifndef RTC_H
+#define RTC_H
+
+#include <stdint.h>
+
+// Time Structure
+typedef struct {
+    uint8_t second;
+    uint8_t minute;
+    uint8_t hour;
+    uint8_t day;
+    uint8_t month;
+    uint16_t year;
+} rtc_time_t;
+
+void get_rtc_time(rtc_time_t* t);
+void rtc_enable_update_irq();
+void rtc_ack_irq();
+
+#endif
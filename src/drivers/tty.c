@@ -0,0 +1,212 @@
+/* src/drivers/tty.c */
+#include <stdint.h>
+#include "tty.h"
+#include "../kernel/process.h"
+#include "../kernel/wait.h"
+#include "../kernel/clock.h"
+#include "../kernel/epoll.h"
+
+extern void term_putc(char c);
+extern void kbd_buffer_write(char c);
+extern char kbd_buffer_read();
+extern int kbd_buffer_count();
+extern int kbd_buffer_free();
+extern int kbd_buffer_count_of(char c);
+
+static int tty_mode = TTY_DEFAULT_MODE;
+static int tty_mode_owner = -1; // pid that last changed the mode
+
+// Line being edited (canonical mode)
+static char line[TTY_LINE_MAX];
+static int line_len = 0;
+
+// Completed lines waiting in kbd_buffer
+static volatile int lines_ready = 0;
+
+static wait_queue_t tty_readers = WAIT_QUEUE_INIT;
+static poll_head_t tty_poll_head = POLL_HEAD_INIT;
+
+static char history[TTY_HISTORY_MAX][TTY_LINE_MAX];
+static int history_count = 0;
+static int history_view = 0;
+
+// --- Editing Helpers ---
+
+static void tty_echo(char c) {
+    if (tty_mode & TTY_ECHO) term_putc(c);
+}
+
+static void tty_erase_line() {
+    while (line_len > 0) {
+        line_len--;
+        tty_echo('\b'); tty_echo(' '); tty_echo('\b');
+    }
+}
+
+static void tty_load_line(const char* src) {
+    tty_erase_line();
+    while (src[line_len] && line_len < TTY_LINE_MAX - 1) {
+        line[line_len] = src[line_len];
+        tty_echo(line[line_len]);
+        line_len++;
+    }
+}
+
+static void tty_history_push() {
+    if (line_len == 0) return;
+    if (history_count == TTY_HISTORY_MAX) {
+        for (int i = 0; i < TTY_HISTORY_MAX - 1; i++)
+            for (int j = 0; j < TTY_LINE_MAX; j++) history[i][j] = history[i + 1][j];
+        history_count--;
+    }
+    for (int i = 0; i < line_len; i++) history[history_count][i] = line[i];
+    history[history_count][line_len] = 0;
+    history_count++;
+}
+
+// Move the finished line (plus '\n') into the read queue and wake a reader.
+// A line that does not fit is dropped whole so readers never see half of it.
+static void tty_commit_line() {
+    tty_echo('\n');
+    tty_history_push();
+    history_view = history_count;
+
+    if (kbd_buffer_free() >= line_len + 1) {
+        for (int i = 0; i < line_len; i++) kbd_buffer_write(line[i]);
+        kbd_buffer_write('\n');
+        lines_ready++;
+        wait_queue_wake_one(&tty_readers);
+        poll_wake(&tty_poll_head, EPOLLIN);
+    }
+    line_len = 0;
+}
+
+// --- Input (IRQ context) ---
+
+void tty_input(char c) {
+    if (!(tty_mode & TTY_ICANON)) {
+        tty_echo(c);
+        kbd_buffer_write(c);
+        wait_queue_wake_one(&tty_readers);
+        poll_wake(&tty_poll_head, EPOLLIN);
+        return;
+    }
+
+    if (c == '\n') {
+        tty_commit_line();
+    } else if (c == '\b') {
+        if (line_len > 0) {
+            line_len--;
+            tty_echo('\b'); tty_echo(' '); tty_echo('\b');
+        }
+    } else if (c == KEY_UP) {
+        if (history_view > 0) tty_load_line(history[--history_view]);
+    } else if (c == KEY_DOWN) {
+        if (history_view < history_count) {
+            history_view++;
+            if (history_view == history_count) tty_erase_line();
+            else tty_load_line(history[history_view]);
+        }
+    } else if (c >= ' ' && c <= '~') {
+        if (line_len < TTY_LINE_MAX - 1) {
+            line[line_len++] = c;
+            tty_echo(c);
+        }
+    }
+}
+
+// --- Reader Side ---
+
+int tty_read(char* buf, int size) {
+    return tty_read_timeout(buf, size, WAIT_FOREVER);
+}
+
+// A line (canonical) or what has been typed (raw), 0 if not there yet.
+// Interrupts are off.
+static int tty_take(char* buf, int size) {
+    int canon = tty_mode & TTY_ICANON;
+    int n = 0;
+    if (canon ? lines_ready > 0 : kbd_buffer_count() > 0) {
+        char c;
+        while (n < size && (c = kbd_buffer_read()) != 0) {
+            buf[n++] = c;
+            if (c == '\n' && canon) {
+                lines_ready--;
+                break;
+            }
+        }
+    }
+    return n;
+}
+
+int tty_read_timeout(char* buf, int size, uint64_t timeout_ns) {
+    if (size <= 0) return 0;
+    uint64_t deadline = timeout_ns == WAIT_FOREVER ? 0 : clock_now_ns() + timeout_ns;
+
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0" : "=r"(eflags));
+
+    while (1) {
+        __asm__ volatile("cli");
+        int n = tty_take(buf, size);
+        if (n > 0) {
+            __asm__ volatile("push %0; popf" : : "r"(eflags));
+            return n;
+        }
+        if (wait_queue_wait_killable(&tty_readers, deadline) != WAIT_WOKEN) {
+            __asm__ volatile("push %0; popf" : : "r"(eflags));
+            return -1;
+        }
+    }
+}
+
+int tty_read_nonblock(char* buf, int size) {
+    if (size <= 0) return 0;
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    int n = tty_take(buf, size);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return n > 0 ? n : FD_WOULD_BLOCK;
+}
+
+uint32_t tty_poll(poll_head_t** head) {
+    if (head) *head = &tty_poll_head;
+    int canon = tty_mode & TTY_ICANON;
+    return (canon ? lines_ready > 0 : kbd_buffer_count() > 0) ? EPOLLIN : 0;
+}
+
+// --- Mode ---
+
+int tty_get_mode() {
+    return tty_mode;
+}
+
+int tty_set_mode(int mode) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+
+    int old = tty_mode;
+    // Leaving canonical mode: hand over whatever was typed so far
+    if ((old & TTY_ICANON) && !(mode & TTY_ICANON)) {
+        for (int i = 0; i < line_len; i++) kbd_buffer_write(line[i]);
+        line_len = 0;
+    }
+    // Entering it: raw mode kept no line count, so take one from the queue.
+    // Bytes after the last '\n' become the start of the next line.
+    if (!(old & TTY_ICANON) && (mode & TTY_ICANON)) {
+        lines_ready = kbd_buffer_count_of('\n');
+        if (lines_ready > 0) wait_queue_wake_one(&tty_readers);
+    }
+    tty_mode = mode & (TTY_ICANON | TTY_ECHO);
+    if (kbd_buffer_count() > 0 && !(tty_mode & TTY_ICANON)) poll_wake(&tty_poll_head, EPOLLIN);
+    tty_mode_owner = current_process ? current_process->leader->pid : -1;
+
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return old;
+}
+
+void tty_release(int pid) {
+    if (tty_mode_owner == pid && tty_mode != TTY_DEFAULT_MODE)
+        tty_set_mode(TTY_DEFAULT_MODE);
+    if (tty_mode_owner == pid) tty_mode_owner = -1;
+}
@@ -0,0 +1,33 @@
+/* src/drivers/tty.h */
+#ifndef TTY_H
+#define TTY_H
+
+#include <stdint.h>
+
+struct poll_head;
+
+// Console line discipline on top of the keyboard buffer.
+// Canonical mode edits a line in the kernel (echo, backspace, history on
+// the arrow keys) and hands it to readers only when Enter is pressed.
+// Raw mode passes every key through as it arrives.
+#define TTY_ICANON 0x1
+#define TTY_ECHO   0x2
+#define TTY_DEFAULT_MODE (TTY_ICANON | TTY_ECHO)
+
+#define TTY_LINE_MAX    128
+#define TTY_HISTORY_MAX 10
+
+// Special keys from the keyboard map
+#define KEY_UP   0x11
+#define KEY_DOWN 0x12
+
+void tty_input(char c);            // Keyboard IRQ
+int tty_read(char* buf, int size); // Blocks until a line (canonical) or a key (raw)
+int tty_read_timeout(char* buf, int size, uint64_t timeout_ns); // -1 on timeout
+int tty_read_nonblock(char* buf, int size); // FD_WOULD_BLOCK if nothing is ready
+uint32_t tty_poll(struct poll_head** head); // EPOLLIN once tty_read() would not block
+int tty_set_mode(int mode);        // Returns the previous mode
+int tty_get_mode();
+void tty_release(int pid);         // Restore the default mode if pid changed it
+
+#endif
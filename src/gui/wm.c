@@ -2,6 +2,7 @@
 #include "window.h"
 #include "../mm/heap.h"
 #include "../drivers/font.h"
+#include "../kernel/memops.h"
 
 // Externs from graphics.c
 extern int screen_w;
@@ -23,9 +24,7 @@ void init_wm() {
     backbuffer = (uint32_t*)kmalloc(screen_w * screen_h * 4);
     
     // 2. Clear it to Blue
-    for (int i = 0; i < screen_w * screen_h; i++) {
-        backbuffer[i] = 0xFF0000AA; 
-    }
+    memset32(backbuffer, 0xFF0000AA, screen_w * screen_h);
 }
 
 // Create a new window
@@ -47,7 +46,7 @@ window_t* create_window(const char* title, int x, int y, int w, int h) {
     
     // Allocate Window Content Buffer
     win->buffer = (uint32_t*)kmalloc(w * h * 4);
-    for(int j=0; j<w*h; j++) win->buffer[j] = 0xFFCCCCCC; 
+    memset32(win->buffer, 0xFFCCCCCC, w * h);
 
     // Add to list
     win->next = 0;
@@ -63,14 +62,15 @@ window_t* create_window(const char* title, int x, int y, int w, int h) {
 
 // Helper: Copy a rectangle to the backbuffer
 void wm_draw_rect_to_backbuffer(int x, int y, int w, int h, uint32_t color) {
-    for (int j = 0; j < h; j++) {
-        for (int i = 0; i < w; i++) {
-            int bx = x + i;
-            int by = y + j;
-            if (bx >= 0 && bx < screen_w && by >= 0 && by < screen_h) {
-                backbuffer[by * screen_w + bx] = color;
-            }
-        }
+    // Clip once, then fill whole rows
+    int x0 = x < 0 ? 0 : x;
+    int y0 = y < 0 ? 0 : y;
+    int x1 = (x + w > screen_w) ? screen_w : x + w;
+    int y1 = (y + h > screen_h) ? screen_h : y + h;
+    if (x0 >= x1 || y0 >= y1) return;
+
+    for (int by = y0; by < y1; by++) {
+        memset32(&backbuffer[by * screen_w + x0], color, x1 - x0);
     }
 }
 
@@ -79,7 +79,7 @@ void wm_refresh() {
     if (!backbuffer) return;
 
     // 1. Draw Desktop Background
-    for (int i = 0; i < screen_w * screen_h; i++) backbuffer[i] = 0xFF0000AA;
+    memset32(backbuffer, 0xFF0000AA, screen_w * screen_h);
 
     // 2. Draw Windows
     window_t* curr = head;
@@ -87,16 +87,16 @@ void wm_refresh() {
         // A. Draw Title Bar
         wm_draw_rect_to_backbuffer(curr->x, curr->y - 20, curr->width, 20, 0xFF000088);
         
-        // B. Draw Content
-        for (int j = 0; j < curr->height; j++) {
-            for (int i = 0; i < curr->width; i++) {
-                int screen_x = curr->x + i;
+        // B. Draw Content (clipped, one row copy at a time)
+        int x0 = curr->x < 0 ? 0 : curr->x;
+        int x1 = (curr->x + curr->width > screen_w) ? screen_w : curr->x + curr->width;
+        if (x0 < x1) {
+            for (int j = 0; j < curr->height; j++) {
                 int screen_y = curr->y + j;
-                
-                if (screen_x >= 0 && screen_x < screen_w && screen_y >= 0 && screen_y < screen_h) {
-                    uint32_t color = curr->buffer[j * curr->width + i];
-                    backbuffer[screen_y * screen_w + screen_x] = color;
-                }
+                if (screen_y < 0 || screen_y >= screen_h) continue;
+                memcpy(&backbuffer[screen_y * screen_w + x0],
+                       &curr->buffer[j * curr->width + (x0 - curr->x)],
+                       (x1 - x0) * 4);
             }
         }
         curr = curr->next;
@@ -116,9 +116,7 @@ void wm_refresh() {
     }
 
     // 4. FLIP
-    for (int i = 0; i < screen_w * screen_h; i++) {
-        framebuffer[i] = backbuffer[i];
-    }
+    memcpy(framebuffer, backbuffer, screen_w * screen_h * 4);
 }
 
 // THIS WAS MISSING: The function main.c calls!
@@ -165,15 +163,12 @@ void wm_scroll_window(window_t* win) {
     int scroll_height = 8; 
 
     // 1. Move memory up
-    for (int i = 0; i < (total_rows - scroll_height) * win->width; i++) {
-        win->buffer[i] = win->buffer[i + (scroll_height * win->width)];
-    }
+    memmove(win->buffer, win->buffer + (scroll_height * win->width),
+            (total_rows - scroll_height) * win->width * 4);
 
     // 2. Clear bottom lines
     int start_index = (total_rows - scroll_height) * win->width;
-    for (int i = start_index; i < total_rows * win->width; i++) {
-        win->buffer[i] = win->bg_color;
-    }
+    memset32(win->buffer + start_index, win->bg_color, scroll_height * win->width);
 
     win->cursor_y -= 8;
     if (win->cursor_y < 0) win->cursor_y = 0;
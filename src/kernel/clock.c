@@ -0,0 +1,144 @@
+/* src/kernel/clock.c */
+#include "clock.h"
+#include "../cpu/cpu.h"
+#include "../drivers/rtc.h"
+#include "../drivers/pit.h"
+#include "../drivers/serial.h"
+#include "../mm/vmm.h"
+#include "memops.h"
+
+extern void* pmm_alloc_block();
+extern void serial_log(char* str);
+extern uint64_t div_u64(uint64_t n, uint32_t d, uint32_t* rem);
+
+#define CLOCK_SHIFT 24
+
+// Kernel-side alias of the page (identity mapped, writable)
+time_page_t* time_page = 0;
+
+// --- Seqlock Writer ---
+// Writers only run in IRQ context with interrupts off, so they never race
+// each other; readers retry if seq was odd or changed under them.
+static inline void time_write_begin() {
+    time_page->seq++;
+    __asm__ volatile("" : : : "memory");
+}
+
+static inline void time_write_end() {
+    __asm__ volatile("" : : : "memory");
+    time_page->seq++;
+}
+
+// --- TSC Calibration ---
+// Time 10ms on PIT channel 2.
+static uint32_t calibrate_tsc_khz() {
+    const uint32_t pit_count = PIT_BASE_HZ / 100;
+
+    uint8_t gate = pit_gate_start(pit_count);
+    uint64_t start = rdtsc();
+    while (!pit_gate_expired());
+    uint64_t end = rdtsc();
+    pit_gate_stop(gate);
+
+    return (uint32_t)div_u64((end - start) * PIT_BASE_HZ, pit_count * 1000, 0);
+}
+
+// --- Wall Clock ---
+
+// Days since 1970-01-01 for a proleptic Gregorian date
+static uint32_t days_from_civil(uint32_t y, uint32_t m, uint32_t d) {
+    y -= m <= 2;
+    uint32_t era = y / 400;
+    uint32_t yoe = y - era * 400;
+    uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static void clock_sync_rtc() {
+    rtc_time_t t;
+    get_rtc_time(&t);
+
+    uint64_t now = clock_now_ns();
+    time_write_begin();
+    time_page->second = t.second;
+    time_page->minute = t.minute;
+    time_page->hour   = t.hour;
+    time_page->day    = t.day;
+    time_page->month  = t.month;
+    time_page->year   = t.year;
+    time_page->wall_sec = days_from_civil(t.year, t.month, t.day) * 86400 +
+                          t.hour * 3600 + t.minute * 60 + t.second;
+    time_page->wall_base_ns = now;
+    time_write_end();
+}
+
+// --- Public API ---
+
+uint64_t clock_now_ns() {
+    if (!(time_page->flags & TIME_PAGE_TSC))
+        return time_page->base_ns;
+    uint64_t delta = rdtsc() - time_page->base_tsc;
+    return time_page->base_ns + ((delta * time_page->mult) >> time_page->shift);
+}
+
+// elapsed_ns is how long the timer ran since its last interrupt; it only
+// matters without a TSC (periodic ticks and idle one-shots differ).
+void clock_tick(uint32_t elapsed_ns) {
+    if (!time_page) return;
+
+    uint64_t tsc = 0;
+    uint64_t now = time_page->base_ns + elapsed_ns;
+    if (time_page->flags & TIME_PAGE_TSC) {
+        tsc = rdtsc();
+        now = time_page->base_ns + (((tsc - time_page->base_tsc) * time_page->mult) >> time_page->shift);
+    }
+
+    // Re-base every tick so the user-side multiply never overflows
+    time_write_begin();
+    time_page->ticks++;
+    time_page->base_tsc = tsc;
+    time_page->base_ns = now;
+    time_write_end();
+}
+
+void clock_set_tick_ns(uint32_t tick_ns) {
+    if (!time_page) return;
+    time_write_begin();
+    time_page->tick_ns = tick_ns;
+    time_write_end();
+}
+
+void clock_rtc_irq() {
+    rtc_ack_irq();
+    if (time_page) clock_sync_rtc();
+}
+
+void init_clock() {
+    time_page = (time_page_t*)pmm_alloc_block();
+    memset(time_page, 0, PAGE_SIZE);
+    // Until init_timer() reprograms it, the PIT runs at the BIOS default
+    time_page->tick_ns = (uint32_t)div_u64(1000000000ULL * PIT_MAX_COUNT, PIT_BASE_HZ, 0);
+
+    if (cpu_has_edx1(CPUID_EDX_TSC)) {
+        uint32_t khz = calibrate_tsc_khz();
+        if (khz) {
+            time_page->tsc_khz = khz;
+            time_page->shift = CLOCK_SHIFT;
+            time_page->mult = (uint32_t)div_u64(1000000ULL << CLOCK_SHIFT, khz, 0);
+            time_page->base_tsc = rdtsc();
+            time_page->flags |= TIME_PAGE_TSC;
+        }
+    }
+
+    // Present | User, no Writable: user code can only read it. Mapped in the
+    // kernel directory so every new address space inherits the table;
+    // Shared so that no process ever frees the frame as its own.
+    vmm_map_page(time_page, (void*)TIME_PAGE_ADDR, I86_PTE_PRESENT | I86_PTE_USER | I86_PTE_SHARED);
+
+    clock_sync_rtc();
+    rtc_enable_update_irq();
+
+    serial_log(time_page->flags & TIME_PAGE_TSC ? " [CLOCK] TSC calibrated.\n"
+                                                : " [CLOCK] No TSC, using PIT ticks.\n");
+}
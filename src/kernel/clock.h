@@ -0,0 +1,50 @@
+/* src/kernel/clock.h */
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <stdint.h>
+
+// Read-only page shared with every user address space. The kernel updates
+// it from the timer and RTC interrupts; user code reads it under the
+// seqlock without a syscall.
+// NOTE: Layout is mirrored in programs/stdlib.h - keep them in sync.
+#define TIME_PAGE_ADDR 0xC0000000
+
+#define TIME_PAGE_TSC 0x1 // mult/shift are valid; otherwise fall back to ticks
+
+typedef struct {
+    volatile uint32_t seq;  // Odd while the kernel is mid-update
+    uint32_t flags;         // TIME_PAGE_*
+    uint32_t tsc_khz;
+    uint32_t tick_ns;       // Length of one periodic timer tick (timer.c)
+
+    // Monotonic clock: ns = base_ns + ((rdtsc() - base_tsc) * mult >> shift)
+    // Without a TSC, base_ns alone is the time of the last timer interrupt.
+    uint64_t ticks;
+    uint64_t base_tsc;
+    uint64_t base_ns;
+    uint32_t mult;
+    uint32_t shift;
+
+    // Wall clock: Unix time wall_sec was current at monotonic wall_base_ns
+    uint32_t wall_sec;
+    uint64_t wall_base_ns;
+
+    // Broken-down wall time, refreshed every second from the RTC
+    uint8_t second;
+    uint8_t minute;
+    uint8_t hour;
+    uint8_t day;
+    uint8_t month;
+    uint16_t year;
+} time_page_t;
+
+extern time_page_t* time_page;
+
+void init_clock();
+void clock_tick(uint32_t elapsed_ns); // Every timer interrupt (timer.c)
+void clock_set_tick_ns(uint32_t tick_ns);
+void clock_rtc_irq();  // IRQ 8
+uint64_t clock_now_ns();
+
+#endif
@@ -3,95 +3,519 @@
 #include "../mm/heap.h"
 #include "../mm/vmm.h"
 #include "process.h"
+#include "memops.h"
+#include "fs.h"
+#include "snapshot.h"
 
 extern void term_print(const char* str);
 extern void* pmm_alloc_block();
-extern void set_cr3(uint32_t pd);
-extern uint32_t get_cr3();
-
-typedef struct file_node {
-    char name[32];
-    char* data;         
-    uint32_t size;
-    struct file_node* next; 
-} file_t;
-extern file_t* fs_resolve_path(const char* path);
-
-extern page_directory_t* vmm_create_address_space();
+extern void pmm_free_block(void* p);
+extern void strcpy_safe(char* dest, const char* src);
+extern int strcmp(const char* s1, const char* s2);
+
 extern void vmm_map_page_in_dir(page_directory_t* pd, void* phys, void* virt, int flags);
 
-void* memcpy(void* dest, const void* src, uint32_t n) {
-    char* d = (char*)dest;
-    const char* s = (const char*)src;
-    while(n--) *d++ = *s++;
-    return dest;
+static elf_image_t* image_cache = 0;
+
+// --- Page Filling ---
+// Frames are written through the kernel's identity map, so loading never
+// has to switch CR3.
+
+// Copy the part of segment 'ph' that falls in the page at page_va
+static void elf_copy_into(uint8_t* frame, uint32_t page_va, elf_program_header_t* ph, uint8_t* file_data) {
+    uint32_t lo = ph->vaddr > page_va ? ph->vaddr : page_va;
+    uint32_t file_end = ph->vaddr + ph->filesz;
+    uint32_t hi = file_end < page_va + PAGE_SIZE ? file_end : page_va + PAGE_SIZE;
+    if (lo < hi)
+        memcpy(frame + (lo - page_va), file_data + ph->offset + (lo - ph->vaddr), hi - lo);
 }
 
-void* memset(void* ptr, int value, uint32_t num) {
-    unsigned char* p = (unsigned char*)ptr;
-    while(num--) *p++ = (unsigned char)value;
-    return ptr;
+static uint32_t seg_base(elf_program_header_t* ph) { return ph->vaddr & 0xFFFFF000; }
+static uint32_t seg_pages(elf_program_header_t* ph) {
+    return (ph->vaddr + ph->memsz - seg_base(ph) + PAGE_SIZE - 1) / PAGE_SIZE;
 }
 
-int elf_load_file(const char* filename, char* args) {
-    file_t* f = fs_resolve_path(filename);
-    if (!f) {
-        term_print("ELF: File not found.\n");
-        return -1;
+// A read-only segment can be shared only if no writable segment touches
+// any of its pages
+static int elf_seg_shareable(elf_header_t* hdr, elf_program_header_t* ph) {
+    if (ph->type != PT_LOAD || (ph->flags & PF_W) || ph->memsz == 0) return 0;
+    elf_program_header_t* all = (elf_program_header_t*)((uint8_t*)hdr + hdr->phoff);
+    uint32_t start = seg_base(ph), end = start + seg_pages(ph) * PAGE_SIZE;
+    for (int i = 0; i < hdr->phnum; i++) {
+        if (all[i].type != PT_LOAD || !(all[i].flags & PF_W)) continue;
+        uint32_t ws = seg_base(&all[i]), we = ws + seg_pages(&all[i]) * PAGE_SIZE;
+        if (ws < end && start < we) return 0;
+    }
+    return 1;
+}
+
+// --- Image Cache ---
+
+static void elf_image_free(elf_image_t* img) {
+    elf_image_t** link = &image_cache;
+    while (*link && *link != img) link = &(*link)->next;
+    if (*link) *link = img->next;
+
+    for (int s = 0; s < img->nsegs; s++) {
+        for (uint32_t p = 0; p < img->segs[s].pages; p++)
+            if (img->segs[s].frames[p]) pmm_free_block((void*)img->segs[s].frames[p]);
+        kfree(img->segs[s].frames);
+    }
+    kfree(img);
+}
+
+static elf_image_t* elf_image_build(file_t* f, elf_header_t* hdr, uint32_t bias) {
+    elf_image_t* img = (elf_image_t*)kmalloc(sizeof(elf_image_t));
+    memset(img, 0, sizeof(elf_image_t));
+    img->file = f;
+    img->data = f->data;
+    img->size = f->size;
+    img->bias = bias;
+
+    elf_program_header_t* ph = (elf_program_header_t*)(f->data + hdr->phoff);
+    for (int i = 0; i < hdr->phnum && img->nsegs < ELF_MAX_SHARED_SEGS; i++) {
+        if (!elf_seg_shareable(hdr, &ph[i])) continue;
+
+        elf_shared_seg_t* seg = &img->segs[img->nsegs++];
+        seg->base = seg_base(&ph[i]) + bias;
+        seg->pages = seg_pages(&ph[i]);
+        seg->frames = (uint32_t*)kmalloc(seg->pages * sizeof(uint32_t));
+        memset(seg->frames, 0, seg->pages * sizeof(uint32_t));
+
+        for (uint32_t p = 0; p < seg->pages; p++) {
+            uint8_t* frame = (uint8_t*)pmm_alloc_block();
+            if (!frame) { elf_image_free(img); return 0; }
+            memset(frame, 0, PAGE_SIZE);
+            elf_copy_into(frame, seg_base(&ph[i]) + p * PAGE_SIZE, &ph[i], (uint8_t*)f->data);
+            seg->frames[p] = (uint32_t)frame;
+        }
+    }
+
+    img->next = image_cache;
+    image_cache = img;
+    return img;
+}
+
+// Returns a referenced image for f loaded at bias, building it on first use
+static elf_image_t* elf_image_get(file_t* f, elf_header_t* hdr, uint32_t bias) {
+    for (elf_image_t* img = image_cache; img; img = img->next) {
+        if (img->file != f || img->stale || img->bias != bias) continue;
+        if (img->data == f->data && img->size == f->size) {
+            img->refs++;
+            return img;
+        }
+        // File was replaced behind our back
+        img->stale = 1;
+        if (img->refs == 0) elf_image_free(img);
+        break;
+    }
+
+    elf_image_t* img = elf_image_build(f, hdr, bias);
+    if (img) img->refs++;
+    return img;
+}
+
+void elf_image_put(elf_image_t* img) {
+    if (!img) return;
+    img->refs--;
+    if (img->stale && img->refs <= 0) elf_image_free(img);
+}
+
+// Called whenever a file's contents change or it is deleted. Idle images
+// are freed now, busy ones once their last process exits.
+void elf_image_invalidate(file_t* file) {
+    elf_image_t* img = image_cache;
+    while (img) {
+        elf_image_t* next = img->next;
+        if (img->file == file) {
+            img->stale = 1;
+            if (img->refs == 0) elf_image_free(img);
+        }
+        img = next;
     }
+}
+
+// --- Dynamic Linking ---
+// There is no user-space interpreter: the kernel plays ld.so. An
+// executable with PT_DYNAMIC may name one library (DT_NEEDED), which is
+// loaded from ELF_LIB_DIR at ELF_LIB_BASE. PT_INTERP is accepted but its
+// path is ignored. All symbols are bound at load time, so lazy PLT
+// resolution is never used.
 
+// What the linker needs from one file. Tables point into the file itself,
+// only relocation targets are touched in the new address space.
+typedef struct {
+    elf_header_t* hdr;
+    uint32_t bias;
+    elf_sym_t* symtab;
+    uint32_t nsyms;      // nchain from DT_HASH
+    const char* strtab;
+    uint32_t strsz;      // strtab[strsz - 1] is a NUL
+    uint32_t* hash;      // nbucket, nchain, bucket[nbucket], chain[nchain]
+    elf_rel_t* rel;
+    uint32_t relsz;
+    elf_rel_t* jmprel;
+    uint32_t pltrelsz;
+    const char* needed;  // 0 if no library is required
+} elf_object_t;
+
+// Headers and every PT_LOAD must lie inside the file, and every PT_LOAD
+// (moved by bias) inside [ELF_USER_BASE, limit)
+static int elf_check(file_t* f, uint32_t bias, uint32_t limit) {
+    if (!f || !f->data || f->size < sizeof(elf_header_t)) return 0;
     elf_header_t* hdr = (elf_header_t*)f->data;
-    if (hdr->magic != ELF_MAGIC) {
-        term_print("ELF: Not a valid ELF file.\n");
-        return -1;
+    if (hdr->magic != ELF_MAGIC) return 0;
+    if (hdr->phoff > f->size || hdr->phnum * sizeof(elf_program_header_t) > f->size - hdr->phoff) return 0;
+    elf_program_header_t* ph = (elf_program_header_t*)(f->data + hdr->phoff);
+    for (int i = 0; i < hdr->phnum; i++) {
+        if (ph[i].type != PT_LOAD) continue;
+        if (ph[i].filesz > ph[i].memsz) return 0;
+        if (ph[i].filesz > f->size || ph[i].offset > f->size - ph[i].filesz) return 0;
+        uint32_t start = ph[i].vaddr + bias;
+        if (start < ph[i].vaddr || start < ELF_USER_BASE) return 0;
+        if (start > limit || ph[i].memsz > limit - start) return 0;
     }
+    return 1;
+}
 
-    term_print("ELF: Loading "); term_print(filename); term_print("\n");
+// Link-time range [vaddr, vaddr + size) -> pointer into the file, 0 if
+// not wholly file-backed by one segment
+static void* elf_file_ptr(elf_header_t* hdr, uint32_t vaddr, uint32_t size) {
+    if (!vaddr) return 0;
+    elf_program_header_t* ph = (elf_program_header_t*)((uint8_t*)hdr + hdr->phoff);
+    for (int i = 0; i < hdr->phnum; i++) {
+        if (ph[i].type != PT_LOAD || vaddr < ph[i].vaddr) continue;
+        uint32_t off = vaddr - ph[i].vaddr;
+        if (off < ph[i].filesz && size <= ph[i].filesz - off)
+            return (uint8_t*)hdr + ph[i].offset + off;
+    }
+    return 0;
+}
 
-    page_directory_t* new_pd = vmm_create_address_space();
-    if (!new_pd) return -1;
+// Is [va, va + len) inside one of obj's loaded segments?
+static int elf_in_object(elf_object_t* obj, uint32_t va, uint32_t len) {
+    elf_program_header_t* ph = (elf_program_header_t*)((uint8_t*)obj->hdr + obj->hdr->phoff);
+    for (int i = 0; i < obj->hdr->phnum; i++) {
+        if (ph[i].type != PT_LOAD) continue;
+        uint32_t start = ph[i].vaddr + obj->bias;
+        if (va >= start && va - start < ph[i].memsz && len <= ph[i].memsz - (va - start)) return 1;
+    }
+    return 0;
+}
+
+// String at offset off in obj's string table, 0 if out of range
+static const char* elf_str(elf_object_t* obj, uint32_t off) {
+    return obj->strtab && off < obj->strsz ? obj->strtab + off : 0;
+}
+
+static int elf_object_init(elf_object_t* obj, file_t* f, uint32_t bias) {
+    memset(obj, 0, sizeof(elf_object_t));
+    obj->hdr = (elf_header_t*)f->data;
+    obj->bias = bias;
+
+    elf_program_header_t* ph = (elf_program_header_t*)(f->data + obj->hdr->phoff);
+    elf_dyn_t* dyn = 0;
+    uint32_t count = 0;
+    for (int i = 0; i < obj->hdr->phnum; i++) {
+        if (ph[i].type != PT_DYNAMIC) continue;
+        dyn = (elf_dyn_t*)elf_file_ptr(obj->hdr, ph[i].vaddr, ph[i].filesz);
+        count = ph[i].filesz / sizeof(elf_dyn_t);
+    }
+    if (!dyn) return 0; // Statically linked
+
+    // Addresses first: a table's size may come after it
+    int needed = -1;
+    uint32_t hash = 0, strtab = 0, symtab = 0, rel = 0, jmprel = 0;
+    for (uint32_t i = 0; i < count && dyn[i].tag != DT_NULL; i++) {
+        uint32_t val = dyn[i].val;
+        switch (dyn[i].tag) {
+            case DT_NEEDED:
+                if (needed >= 0) return -1; // Only one library is supported
+                needed = (int)val;
+                break;
+            case DT_HASH:     hash = val; break;
+            case DT_STRTAB:   strtab = val; break;
+            case DT_STRSZ:    obj->strsz = val; break;
+            case DT_SYMTAB:   symtab = val; break;
+            case DT_REL:      rel = val; break;
+            case DT_RELSZ:    obj->relsz = val; break;
+            case DT_JMPREL:   jmprel = val; break;
+            case DT_PLTRELSZ: obj->pltrelsz = val; break;
+        }
+    }
+
+    // Every table must lie wholly inside the file. DT_HASH's nchain is the
+    // symbol count, so it bounds every symbol index.
+    if (hash && (obj->hash = (uint32_t*)elf_file_ptr(obj->hdr, hash, 8))) {
+        uint32_t nbucket = obj->hash[0], nchain = obj->hash[1];
+        if (nbucket >= 0x10000000 || nchain >= 0x10000000) return -1;
+        if (!elf_file_ptr(obj->hdr, hash, (2 + nbucket + nchain) * sizeof(uint32_t))) return -1;
+        obj->nsyms = nchain;
+    }
+    if (symtab && obj->nsyms)
+        obj->symtab = (elf_sym_t*)elf_file_ptr(obj->hdr, symtab, obj->nsyms * sizeof(elf_sym_t));
+    if (strtab && obj->strsz) {
+        obj->strtab = (const char*)elf_file_ptr(obj->hdr, strtab, obj->strsz);
+        if (obj->strtab && obj->strtab[obj->strsz - 1]) return -1;
+    }
+    if (obj->relsz) obj->rel = (elf_rel_t*)elf_file_ptr(obj->hdr, rel, obj->relsz);
+    if (obj->pltrelsz) obj->jmprel = (elf_rel_t*)elf_file_ptr(obj->hdr, jmprel, obj->pltrelsz);
+
+    if ((obj->relsz || obj->pltrelsz || needed >= 0) && (!obj->symtab || !obj->strtab)) return -1;
+    if (obj->relsz && !obj->rel) return -1;
+    if (obj->pltrelsz && !obj->jmprel) return -1;
+    if (needed >= 0 && !(obj->needed = elf_str(obj, (uint32_t)needed))) return -1;
+    return 0;
+}
 
+// SysV ELF hash, as used by DT_HASH
+static uint32_t elf_hash(const char* name) {
+    uint32_t h = 0;
+    while (*name) {
+        h = (h << 4) + (uint8_t)*name++;
+        uint32_t g = h & 0xF0000000;
+        if (g) h ^= g >> 24;
+        h &= ~g;
+    }
+    return h;
+}
+
+// The symbol 'obj' defines under 'name', 0 if none
+static elf_sym_t* elf_lookup(elf_object_t* obj, const char* name, uint32_t hash) {
+    if (!obj->hash || !obj->symtab || obj->hash[0] == 0) return 0;
+    uint32_t nbucket = obj->hash[0];
+    uint32_t* bucket = obj->hash + 2;
+    uint32_t* chain = bucket + nbucket;
+    // nsyms steps at most, so a looping chain ends too
+    uint32_t i = bucket[hash % nbucket];
+    for (uint32_t steps = 0; i && i < obj->nsyms && steps < obj->nsyms; i = chain[i], steps++) {
+        elf_sym_t* sym = &obj->symtab[i];
+        const char* sym_name = elf_str(obj, sym->name);
+        if (sym->shndx != SHN_UNDEF && sym_name && strcmp(sym_name, name) == 0) return sym;
+    }
+    return 0;
+}
+
+// Kernel pointer to user address va in pd. Shared pages are read-only to
+// everyone, so a write there (a text relocation) is refused.
+static uint8_t* elf_user_ptr(page_directory_t* pd, uint32_t va, int write) {
+    uint32_t pte = vmm_get_pte_in_dir(pd, (void*)va);
+    if ((pte & (I86_PTE_PRESENT | I86_PTE_USER)) != (I86_PTE_PRESENT | I86_PTE_USER)) return 0;
+    if (write && (pte & I86_PTE_SHARED)) return 0;
+    return (uint8_t*)((pte & 0xFFFFF000) | (va & 0xFFF));
+}
+
+// Apply one relocation table of 'obj'. Symbols are searched in scope
+// order (executable first), like a conventional global scope. Every slot
+// patched must lie in obj's own segments, and a copy's source in the
+// defining object's.
+static int elf_relocate(page_directory_t* pd, elf_object_t* obj, elf_rel_t* rel, uint32_t size,
+                        elf_object_t** scope, int nscope) {
+    for (uint32_t i = 0; i < size / sizeof(elf_rel_t); i++) {
+        uint32_t type = rel[i].info & 0xFF;
+        uint32_t where = rel[i].offset + obj->bias;
+        elf_sym_t* def = 0;
+        elf_object_t* def_obj = 0;
+        uint32_t value = 0;
+
+        if (rel[i].info >> 8) {
+            if ((rel[i].info >> 8) >= obj->nsyms) return -1;
+            elf_sym_t* sym = &obj->symtab[rel[i].info >> 8];
+            const char* name = elf_str(obj, sym->name);
+            if (!name) return -1;
+            uint32_t hash = elf_hash(name);
+            // A copy relocation wants the definition the executable shadows
+            for (int s = (type == R_386_COPY) ? 1 : 0; s < nscope && !def; s++) {
+                def = elf_lookup(scope[s], name, hash);
+                if (def) { value = def->value + scope[s]->bias; def_obj = scope[s]; }
+            }
+            if (!def && (sym->info >> 4) != STB_WEAK) {
+                term_print("ELF: Undefined symbol "); term_print(name); term_print("\n");
+                return -1;
+            }
+        }
+
+        if (type == R_386_COPY) {
+            if (def && (!elf_in_object(obj, where, def->size) || !elf_in_object(def_obj, value, def->size)))
+                return -1;
+            for (uint32_t b = 0; def && b < def->size; b++) {
+                uint8_t* dst = elf_user_ptr(pd, where + b, 1);
+                uint8_t* src = elf_user_ptr(pd, value + b, 0);
+                if (!dst || !src) return -1;
+                *dst = *src;
+            }
+            continue;
+        }
+
+        if (!elf_in_object(obj, where, 4) || (where & 0xFFF) > PAGE_SIZE - 4) return -1;
+        uint32_t* slot = (uint32_t*)elf_user_ptr(pd, where, 1);
+        if (!slot) return -1;
+        switch (type) {
+            case R_386_32:       *slot += value; break;
+            case R_386_PC32:     *slot += value - where; break;
+            case R_386_GLOB_DAT:
+            case R_386_JMP_SLOT: *slot = value; break;
+            case R_386_RELATIVE: *slot += obj->bias; break;
+            default: return -1;
+        }
+    }
+    return 0;
+}
+
+static int elf_link(page_directory_t* pd, elf_object_t** scope, int nscope) {
+    // The library first, so copy relocations see its relocated data
+    for (int s = nscope - 1; s >= 0; s--) {
+        if (elf_relocate(pd, scope[s], scope[s]->rel, scope[s]->relsz, scope, nscope) < 0) return -1;
+        if (elf_relocate(pd, scope[s], scope[s]->jmprel, scope[s]->pltrelsz, scope, nscope) < 0) return -1;
+    }
+    return 0;
+}
+
+// --- Loader ---
+
+// Map every PT_LOAD of f into pd at bias. Read-only segments come from
+// img's shared frames. Returns the end of the highest segment.
+static uint32_t elf_map_object(page_directory_t* pd, file_t* f, elf_image_t* img, uint32_t bias) {
+    elf_header_t* hdr = (elf_header_t*)f->data;
     uint32_t highest_addr = 0;
-    uint32_t old_cr3 = get_cr3();
-    
-    __asm__ volatile("cli");
-    set_cr3((uint32_t)new_pd); 
 
+    // 1. Shared read-only segments: just page-table entries
+    if (img) {
+        for (int s = 0; s < img->nsegs; s++) {
+            elf_shared_seg_t* seg = &img->segs[s];
+            for (uint32_t p = 0; p < seg->pages; p++)
+                vmm_map_page_in_dir(pd, (void*)seg->frames[p], (void*)(seg->base + p * PAGE_SIZE),
+                                    I86_PTE_PRESENT | I86_PTE_USER | I86_PTE_SHARED);
+        }
+    }
+
+    // 2. Everything else gets private frames
     elf_program_header_t* ph = (elf_program_header_t*)(f->data + hdr->phoff);
     for (int i = 0; i < hdr->phnum; i++) {
-        if (ph[i].type == PT_LOAD) {
-            uint32_t memsz = ph[i].memsz;
-            uint32_t filesz = ph[i].filesz;
-            uint32_t vaddr = ph[i].vaddr;
-            uint32_t offset = ph[i].offset;
-
-            uint32_t base_addr = vaddr & 0xFFFFF000;
-            uint32_t end_addr = vaddr + memsz;
-            uint32_t page_count = (end_addr - base_addr + 4095) / 4096;
-
-            for (uint32_t z = 0; z < page_count; z++) {
-                void* frame = pmm_alloc_block();
-                vmm_map_page_in_dir(new_pd, frame, (void*)(base_addr + (z * 4096)), 0x7);
-            }
-            
-            if (memsz > filesz) {
-                memset((void*)(vaddr + filesz), 0, memsz - filesz);
+        if (ph[i].type != PT_LOAD) continue;
+
+        uint32_t end_addr = ph[i].vaddr + ph[i].memsz + bias;
+        if (end_addr > highest_addr) highest_addr = end_addr;
+        if (img && elf_seg_shareable(hdr, &ph[i])) {
+            int cached = 0;
+            for (int s = 0; s < img->nsegs; s++)
+                if (img->segs[s].base == seg_base(&ph[i]) + bias) cached = 1;
+            if (cached) continue;
+        }
+
+        uint32_t base_addr = seg_base(&ph[i]);
+        uint32_t page_count = seg_pages(&ph[i]);
+        for (uint32_t z = 0; z < page_count; z++) {
+            uint32_t va = base_addr + z * PAGE_SIZE;
+            uint32_t pte = vmm_get_pte_in_dir(pd, (void*)(va + bias));
+            uint8_t* frame;
+            if (pte & I86_PTE_SHARED) continue; // Already filled from the same file
+            if (pte & I86_PTE_PRESENT) {
+                // Page shared with a previous segment
+                frame = (uint8_t*)(pte & 0xFFFFF000);
+            } else {
+                frame = (uint8_t*)pmm_alloc_block();
+                memset(frame, 0, PAGE_SIZE);
+                vmm_map_page_in_dir(pd, frame, (void*)(va + bias), 0x7);
             }
-            memcpy((void*)vaddr, (void*)(f->data + offset), filesz);
+            elf_copy_into(frame, va, &ph[i], (uint8_t*)f->data);
+        }
+    }
+    return highest_addr;
+}
 
-            if (end_addr > highest_addr) highest_addr = end_addr;
+// Load 'path' into a fresh address space and start it with argv (or
+// resume it, for a snapshot file).
+// Quiet fast path shared by the shell and SYS_SPAWN.
+int elf_spawn(const char* path, const char* const* argv) {
+    file_t* f = fs_resolve_path(path);
+    // A saved process resumes where it was; argv does not apply
+    if (snapshot_is_image(f)) return snapshot_restore(f);
+    if (!elf_check(f, 0, ELF_LIB_BASE)) return -1;
+
+    elf_header_t* hdr = (elf_header_t*)f->data;
+    elf_object_t exe, lib;
+    elf_object_t* scope[2] = { &exe, &lib };
+    int nscope = 1;
+    file_t* lib_file = 0;
+
+    if (hdr->type != ET_EXEC || elf_object_init(&exe, f, 0) < 0) return -1;
+    if (exe.needed) {
+        char lib_path[64];
+        if (strlen(exe.needed) + sizeof(ELF_LIB_DIR) > sizeof(lib_path)) return -1;
+        strcpy_safe(lib_path, ELF_LIB_DIR);
+        strcpy_safe(lib_path + sizeof(ELF_LIB_DIR) - 1, exe.needed);
+        lib_file = fs_resolve_path(lib_path);
+        if (!elf_check(lib_file, ELF_LIB_BASE, THREAD_STACK_TOP(THREAD_MAX)) || ((elf_header_t*)lib_file->data)->type != ET_DYN) {
+            term_print("ELF: Missing library "); term_print(exe.needed); term_print("\n");
+            return -1;
         }
+        if (elf_object_init(&lib, lib_file, ELF_LIB_BASE) < 0 || lib.needed) return -1;
+        nscope = 2;
     }
 
-    set_cr3(old_cr3);
-    __asm__ volatile("sti");
+    page_directory_t* new_pd = process_alloc_address_space();
+    if (!new_pd) return -1;
+
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+
+    elf_image_t* img = elf_image_get(f, hdr, 0);
+    elf_image_t* lib_img = 0;
+    uint32_t highest_addr = elf_map_object(new_pd, f, img, 0);
+
+    if (lib_file) {
+        lib_img = elf_image_get(lib_file, lib.hdr, ELF_LIB_BASE);
+        elf_map_object(new_pd, lib_file, lib_img, ELF_LIB_BASE);
+    }
+
+    if (highest_addr > ELF_LIB_BASE || elf_link(new_pd, scope, nscope) < 0) {
+        elf_image_put(img);
+        elf_image_put(lib_img);
+        __asm__ volatile("push %0; popf" : : "r"(eflags));
+        process_free_address_space(new_pd);
+        return -1;
+    }
 
     if (highest_addr % 4096 != 0) {
         highest_addr = (highest_addr & 0xFFFFF000) + 4096;
     }
 
+    // The new process is not runnable until we restore interrupts, so the
+    // image references are in place before it can exit
+    process_t* proc = create_process_in(new_pd, (void (*)())hdr->entry, argv, highest_addr);
+    proc->image = img;
+    proc->lib_image = lib_img;
+
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return proc->pid;
+}
+
+// Shell entry point: argv is the file name followed by the space-separated args
+int elf_load_file(const char* filename, char* args) {
+    char buf[MAX_ARG_BYTES];
+    const char* argv[MAX_ARGS + 1];
+    int argc = 0;
+
+    argv[argc++] = filename;
+    if (args) {
+        strcpy_safe(buf, args);
+        char* p = buf;
+        while (*p && argc < MAX_ARGS) {
+            while (*p == ' ') *p++ = 0;
+            if (!*p) break;
+            argv[argc++] = p;
+            while (*p && *p != ' ') p++;
+        }
+    }
+    argv[argc] = 0;
+
+    term_print("ELF: Loading "); term_print(filename); term_print("\n");
+    int pid = elf_spawn(filename, argv);
+    if (pid < 0) {
+        term_print("ELF: Not found or not a valid ELF file.\n");
+        return -1;
+    }
     term_print("ELF: Executing...\n");
-    
-    // PASS 0 for is_kernel (User Mode)
-    return create_process((void (*)())hdr->entry, args, highest_addr, 0);
-}
\ No newline at end of file
+    return pid;
+}
@@ -6,8 +6,19 @@
 // ELF Magic Numbers
 #define ELF_MAGIC 0x464C457F  // "\x7FELF" in little endian
 
+// File Types
+#define ET_EXEC 2
+#define ET_DYN  3
+
 // Program Header Type
-#define PT_LOAD 1
+#define PT_LOAD    1
+#define PT_DYNAMIC 2
+#define PT_INTERP  3
+
+// Program Header Flags
+#define PF_X 0x1
+#define PF_W 0x2
+#define PF_R 0x4
 
 typedef struct {
     uint32_t magic;      // 0x7F 'E' 'L' 'F'
@@ -43,7 +54,89 @@ typedef struct {
     uint32_t align;
 } elf_program_header_t;
 
+// --- Dynamic Linking ---
+// Dynamic Section Tags
+#define DT_NULL     0
+#define DT_NEEDED   1
+#define DT_PLTRELSZ 2
+#define DT_HASH     4
+#define DT_STRTAB   5
+#define DT_SYMTAB   6
+#define DT_STRSZ    10
+#define DT_REL      17
+#define DT_RELSZ    18
+#define DT_JMPREL   23
+
+// i386 Relocation Types
+#define R_386_32       1
+#define R_386_PC32     2
+#define R_386_COPY     5
+#define R_386_GLOB_DAT 6
+#define R_386_JMP_SLOT 7
+#define R_386_RELATIVE 8
+
+#define SHN_UNDEF 0
+#define STB_WEAK  2
+
+// Shared libraries (DT_NEEDED) are looked up in this directory and always
+// loaded at this address, so their read-only pages are identical in every
+// process and come from the image cache. User heaps stop below it.
+#define ELF_LIB_DIR  "/"
+#define ELF_LIB_BASE 0x40000000
+
+// Below this is the kernel's identity map: no PT_LOAD may land there
+#define ELF_USER_BASE 0x08000000
+
+typedef struct {
+    int32_t  tag;
+    uint32_t val;        // Value or address, depending on tag
+} elf_dyn_t;
+
+typedef struct {
+    uint32_t name;       // Offset into the string table
+    uint32_t value;
+    uint32_t size;
+    uint8_t  info;       // Binding << 4 | type
+    uint8_t  other;
+    uint16_t shndx;      // SHN_UNDEF for imports
+} elf_sym_t;
+
+typedef struct {
+    uint32_t offset;     // Address to patch
+    uint32_t info;       // Symbol index << 8 | type
+} elf_rel_t;
+
+// --- Executable Image Cache ---
+// Read-only PT_LOAD segments are loaded once per file into frames shared
+// by every instance (mapped read-only, I86_PTE_SHARED). Writable segments
+// are still copied per process.
+#define ELF_MAX_SHARED_SEGS 4
+
+typedef struct {
+    uint32_t base;      // Page-aligned start
+    uint32_t pages;
+    uint32_t* frames;   // Physical frame per page
+} elf_shared_seg_t;
+
+struct file_node;
+
+typedef struct elf_image {
+    struct file_node* file;
+    char* data;         // file->data / size when loaded, to catch rewrites
+    uint32_t size;
+    uint32_t bias;      // Load address added to every vaddr (ET_DYN)
+    int refs;           // Running processes mapping us
+    int stale;          // File changed: drop when refs reaches 0
+    int nsegs;
+    elf_shared_seg_t segs[ELF_MAX_SHARED_SEGS];
+    struct elf_image* next;
+} elf_image_t;
+
+void elf_image_put(elf_image_t* img);
+void elf_image_invalidate(struct file_node* file);
+
 // Function prototype
 int elf_load_file(const char* filename, char* args);
+int elf_spawn(const char* path, const char* const* argv);
 
 #endif
\ No newline at end of file
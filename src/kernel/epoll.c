@@ -0,0 +1,222 @@
+/* src/kernel/epoll.c */
+#include "epoll.h"
+#include "process.h"
+#include "pipe.h"
+#include "timerfd.h"
+#include "clock.h"
+#include "memops.h"
+#include "../mm/heap.h"
+#include "../drivers/tty.h"
+
+// --- Descriptor Readiness ---
+
+// What desc could do without sleeping right now, and where to hear about
+// changes (0: never changes)
+static uint32_t fd_poll(file_descriptor_t* desc, poll_head_t** head) {
+    if (head) *head = 0;
+    switch (desc->type) {
+        case FD_FILE:       return EPOLLIN | EPOLLOUT;
+        case FD_CONSOLE:    return tty_poll(head) | EPOLLOUT;
+        case FD_PIPE_READ:  return pipe_poll((pipe_t*)desc->object, 0, head);
+        case FD_PIPE_WRITE: return pipe_poll((pipe_t*)desc->object, 1, head);
+        case FD_TIMER:      return timerfd_poll((timerfd_t*)desc->object, head);
+        default:            return 0;
+    }
+}
+
+// --- Ready List ---
+// Interrupts are off in all of these
+
+static void ready_push(epoll_t* ep, epoll_item_t* item) {
+    item->ready_next = 0;
+    if (ep->ready_tail) ep->ready_tail->ready_next = item;
+    else ep->ready_head = item;
+    ep->ready_tail = item;
+    item->ready = 1;
+}
+
+static epoll_item_t* ready_pop(epoll_t* ep) {
+    epoll_item_t* item = ep->ready_head;
+    ep->ready_head = item->ready_next;
+    if (!ep->ready_head) ep->ready_tail = 0;
+    item->ready = 0;
+    return item;
+}
+
+static void ready_remove(epoll_t* ep, epoll_item_t* item) {
+    epoll_item_t** link = &ep->ready_head;
+    epoll_item_t* prev = 0;
+    while (*link && *link != item) {
+        prev = *link;
+        link = &prev->ready_next;
+    }
+    if (!*link) return;
+    *link = item->ready_next;
+    if (ep->ready_tail == item) ep->ready_tail = prev;
+    item->ready = 0;
+}
+
+static void item_mark_ready(epoll_item_t* item) {
+    if (item->ready) return;
+    ready_push(item->ep, item);
+    wait_queue_wake_one(&item->ep->waiters);
+}
+
+// --- Poll Heads ---
+
+void poll_wake(poll_head_t* head, uint32_t events) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    for (epoll_item_t* item = head->watchers; item; item = item->head_next)
+        if (item->events & events) item_mark_ready(item);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+static void head_unlink(epoll_item_t* item) {
+    if (!item->head) return;
+    epoll_item_t** link = &item->head->watchers;
+    while (*link && *link != item) link = &(*link)->head_next;
+    if (*link) *link = item->head_next;
+    item->head = 0;
+}
+
+// The items stay in their epoll, as if the source were a regular file
+void poll_head_detach(poll_head_t* head) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    while (head->watchers) {
+        epoll_item_t* item = head->watchers;
+        head->watchers = item->head_next;
+        item->head = 0;
+    }
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+// --- Epoll Instances ---
+
+epoll_t* epoll_create() {
+    epoll_t* ep = (epoll_t*)kmalloc(sizeof(epoll_t));
+    if (!ep) return 0;
+    memset(ep, 0, sizeof(epoll_t));
+    for (int i = 0; i < EPOLL_MAX_ITEMS; i++) ep->items[i].fd = -1;
+    wait_queue_init(&ep->waiters);
+    return ep;
+}
+
+static void item_remove(epoll_t* ep, epoll_item_t* item) {
+    head_unlink(item);
+    if (item->ready) ready_remove(ep, item);
+    item->fd = -1;
+}
+
+// Another thread may still be asleep in epoll_wait(): it gets -1 and
+// frees the instance on its way out
+void epoll_close(epoll_t* ep) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    for (int i = 0; i < EPOLL_MAX_ITEMS; i++)
+        if (ep->items[i].fd >= 0) item_remove(ep, &ep->items[i]);
+    ep->closed = 1;
+    wait_queue_wake_all(&ep->waiters);
+    if (ep->busy == 0) kfree(ep);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+static epoll_item_t* item_find(epoll_t* ep, int fd) {
+    for (int i = 0; i < EPOLL_MAX_ITEMS; i++)
+        if (ep->items[i].fd == fd) return &ep->items[i];
+    return 0;
+}
+
+int epoll_ctl(epoll_t* ep, int op, int fd, const epoll_event_t* ev) {
+    if (fd < 0 || fd >= MAX_OPEN_FILES) return -1;
+    file_descriptor_t* desc = &current_process->leader->fd_table[fd];
+    if (desc->type == FD_NONE || desc->type == FD_EPOLL) return -1;
+    if (op != EPOLL_CTL_DEL && !ev) return -1;
+
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    int ret = 0;
+    epoll_item_t* item = item_find(ep, fd);
+
+    if (op == EPOLL_CTL_ADD && !item) {
+        item = item_find(ep, -1);
+        if (item) {
+            item->fd = fd;
+            item->ep = ep;
+            item->ready = 0;
+            poll_head_t* head;
+            fd_poll(desc, &head);
+            item->head = head;
+            if (head) {
+                item->head_next = head->watchers;
+                head->watchers = item;
+            }
+        } else {
+            ret = -1;
+        }
+    } else if (op == EPOLL_CTL_DEL && item) {
+        item_remove(ep, item);
+        item = 0;
+    } else if (op != EPOLL_CTL_MOD || !item) {
+        ret = -1;
+        item = 0;
+    }
+
+    // ADD and MOD: report what is already true
+    if (item) {
+        item->events = ev->events | EPOLLERR | EPOLLHUP;
+        item->data = ev->data;
+        if (fd_poll(desc, 0) & item->events) item_mark_ready(item);
+    }
+
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return ret;
+}
+
+int epoll_wait(epoll_t* ep, epoll_event_t* out, int max, int timeout_ms) {
+    uint64_t deadline = timeout_ms > 0 ? clock_now_ns() + (uint64_t)timeout_ms * 1000000 : 0;
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    ep->busy++;
+
+    int n = 0;
+    while (!ep->closed) {
+        // Each item on the list at most once; those still ready go to the back
+        epoll_item_t* last = ep->ready_tail;
+        while (ep->ready_head && n < max) {
+            epoll_item_t* item = ready_pop(ep);
+            file_descriptor_t* desc = &current_process->leader->fd_table[item->fd];
+            uint32_t events = fd_poll(desc, 0) & item->events;
+            if (events) {
+                out[n].events = events;
+                out[n].data = item->data;
+                n++;
+                ready_push(ep, item);
+            }
+            if (item == last) break;
+        }
+        if (n > 0 || timeout_ms == 0) break;
+
+        int woken = wait_queue_wait_killable(&ep->waiters, deadline);
+        if (woken == WAIT_KILLED) n = -1;
+        if (woken != WAIT_WOKEN) break;
+    }
+    if (ep->closed && n == 0) n = -1;
+
+    if (--ep->busy == 0 && ep->closed) kfree(ep);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return n;
+}
+
+void epoll_fd_closed(int fd) {
+    file_descriptor_t* table = current_process->leader->fd_table;
+    for (int i = 0; i < MAX_OPEN_FILES; i++) {
+        if (table[i].type != FD_EPOLL) continue;
+        uint32_t eflags;
+        __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+        epoll_item_t* item = item_find((epoll_t*)table[i].object, fd);
+        if (item) item_remove((epoll_t*)table[i].object, item);
+        __asm__ volatile("push %0; popf" : : "r"(eflags));
+    }
+}
@@ -0,0 +1,77 @@
+/* src/kernel/epoll.h */
+#ifndef EPOLL_H
+#define EPOLL_H
+
+#include <stdint.h>
+#include "wait.h"
+
+// Readiness notification. Every kernel object a descriptor can sleep on
+// (the TTY, a pipe, a timerfd) has a poll_head_t, and an epoll instance
+// hangs one item on it per descriptor it watches. When the object
+// changes it calls poll_wake(), which moves the matching items to their
+// epoll's ready list and wakes a waiter. epoll_wait() re-checks only the
+// items on that list, so a wakeup costs O(ready), not O(watched).
+//
+// Level-triggered: an item that is still ready when reported goes back
+// on the end of the list. Regular files are always ready and have no
+// poll head. Items are keyed by descriptor and dropped when it closes.
+
+#define EPOLLIN  0x001
+#define EPOLLOUT 0x004
+#define EPOLLERR 0x008  // Always reported: the other end of a pipe is gone
+#define EPOLLHUP 0x010  // Always reported
+
+#define EPOLL_CTL_ADD 1
+#define EPOLL_CTL_DEL 2
+#define EPOLL_CTL_MOD 3
+
+#define EPOLL_MAX_ITEMS 32
+
+// NOTE: Mirrored in programs/stdlib.h
+typedef struct {
+    uint32_t events;
+    uint32_t data;      // The caller's, returned with each event
+} epoll_event_t;
+
+struct epoll;
+
+typedef struct epoll_item {
+    int fd;                     // -1: free
+    uint32_t events;            // Interest, EPOLLERR | EPOLLHUP included
+    uint32_t data;
+    struct epoll* ep;
+    struct poll_head* head;     // Source we hang on, 0 if always ready
+    struct epoll_item* head_next;
+    struct epoll_item* ready_next;
+    int ready;                  // On ep's ready list
+} epoll_item_t;
+
+typedef struct epoll {
+    epoll_item_t items[EPOLL_MAX_ITEMS];
+    epoll_item_t* ready_head;
+    epoll_item_t* ready_tail;
+    wait_queue_t waiters;
+    int closed;                 // Freed once the last waiter has left
+    int busy;                   // Callers inside epoll_wait()
+} epoll_t;
+
+typedef struct poll_head {
+    epoll_item_t* watchers;     // Linked through ->head_next
+} poll_head_t;
+
+#define POLL_HEAD_INIT { 0 }
+
+void poll_wake(poll_head_t* head, uint32_t events); // Any context
+void poll_head_detach(poll_head_t* head);           // Before the object is freed
+
+epoll_t* epoll_create();
+void epoll_close(epoll_t* ep);
+int epoll_ctl(epoll_t* ep, int op, int fd, const epoll_event_t* ev);     // 0 or -1
+
+// Up to max ready descriptors of the calling process. timeout_ms < 0
+// waits forever, 0 not at all. Returns how many, or -1 if killed.
+int epoll_wait(epoll_t* ep, epoll_event_t* out, int max, int timeout_ms);
+
+void epoll_fd_closed(int fd);   // Drop fd from the caller's epoll instances
+
+#endif
@@ -4,35 +4,29 @@
 #include "../mm/heap.h"
 #include "../drivers/ata.h"
 #include "../kernel/process.h"
+#include "memops.h"
+#include "fs.h"
+#include "elf.h"
+#include "snapshot.h"
+#include "sync.h"
+#include "pipe.h"
+#include "timerfd.h"
+#include "epoll.h"
+#include "../drivers/tty.h"
 
 // --- Externs ---
 extern void term_print(const char* str);
 extern int strcmp(const char* s1, const char* s2);
-extern int strlen(const char* str);
 extern void strcpy_safe(char* dest, const char* src);
-extern process_t* current_process; // Needed for CWD (Current Working Directory)
+extern process_t* ready_queue;
 extern void serial_log(char *str);
+extern void term_putc(char c);
 
 // --- 1. File System Structures ---
-#define FS_FILE 0
-#define FS_DIRECTORY 1
 #define FS_MAGIC 0xDEADC0DE
 #define MAX_FILES 64          // Increased limit for tree
 #define DATA_START_SECTOR 10
 
-// The In-Memory Node (Tree)
-typedef struct file_node {
-    char name[32];
-    char* data;             // File content (NULL if directory)
-    uint32_t size;          // File size
-    uint8_t flags;          // FS_FILE or FS_DIRECTORY
-    
-    // Tree Pointers
-    struct file_node* parent;   // Parent directory ("..")
-    struct file_node* children; // First child (if this is a directory)
-    struct file_node* next;     // Next sibling in the same directory
-} file_t;
-
 // The On-Disk Entry (Flat Format)
 typedef struct {
     char name[64];          // Long name to store full path (e.g. "usr/bin/hello")
@@ -42,6 +36,11 @@ typedef struct {
 
 file_t* fs_root = 0; 
 
+// Guards the tree's shape and file contents. Holders may sleep (saving to
+// disk), but console descriptors never take it: a reader blocked on the
+// keyboard would hold off every writer. Static helpers expect it held.
+static rwlock_t fs_tree_lock = RWLOCK_INIT("fs_tree");
+
 // --- 2. Tree Helper Functions ---
 
 // Create a new independent node
@@ -91,14 +90,14 @@ file_t* fs_find_child(file_t* parent, const char* name) {
 // --- 3. Path Resolution (The Logic Core) ---
 
 // Navigates paths like "usr/bin", "../test", "/", etc.
-file_t* fs_resolve_path(const char* path) {
-    if (!path || !path[0]) return current_process ? current_process->cwd : fs_root;
+static file_t* fs_lookup(const char* path) {
+    if (!path || !path[0]) return current_process ? current_process->leader->cwd : fs_root;
     
     file_t* current;
     if (path[0] == '/') {
         current = fs_root;
     } else {
-        current = current_process ? current_process->cwd : fs_root;
+        current = current_process ? current_process->leader->cwd : fs_root;
     }
 
     char buffer[32];
@@ -135,35 +134,118 @@ file_t* fs_resolve_path(const char* path) {
     return current;
 }
 
+file_t* fs_resolve_path(const char* path) {
+    read_lock(&fs_tree_lock);
+    file_t* f = fs_lookup(path);
+    read_unlock(&fs_tree_lock);
+    return f;
+}
+
+// Absolute path of node into buf. Returns the length, -1 if it does not fit.
+static int fs_build_path(file_t* node, char* buf, int size) {
+    if (size < 2) return -1;
+    if (node == fs_root) { buf[0] = '/'; buf[1] = 0; return 1; }
+
+    // Fill from the end, one component at a time
+    int pos = size - 1;
+    buf[pos] = 0;
+    for (file_t* n = node; n && n != fs_root; n = n->parent) {
+        int len = strlen(n->name);
+        if (pos < len + 1) return -1;
+        pos -= len;
+        memcpy(buf + pos, n->name, len);
+        buf[--pos] = '/';
+    }
+    int len = size - 1 - pos;
+    memmove(buf, buf + pos, len + 1);
+    return len;
+}
+
+int fs_get_path(file_t* node, char* buf, int size) {
+    read_lock(&fs_tree_lock);
+    int len = fs_build_path(node, buf, size);
+    read_unlock(&fs_tree_lock);
+    return len;
+}
+
+static file_t* fs_lookup_or_create(const char* path) {
+    file_t* f = fs_lookup(path);
+    if (f) return f->flags == FS_FILE ? f : 0;
+
+    const char* slash = 0;
+    for (const char* p = path; *p; p++) if (*p == '/') slash = p;
+
+    file_t* parent;
+    const char* name = path;
+    if (slash) {
+        char dir[64];
+        int len = slash - path;
+        if (len >= (int)sizeof(dir)) return 0;
+        memcpy(dir, path, len);
+        dir[len] = 0;
+        parent = len ? fs_lookup(dir) : fs_root;
+        name = slash + 1;
+    } else {
+        parent = current_process ? current_process->leader->cwd : fs_root;
+    }
+    if (!parent || parent->flags != FS_DIRECTORY || !name[0] || strlen(name) >= 32) return 0;
+
+    f = fs_create_node(name, FS_FILE);
+    fs_insert_child(parent, f);
+    return f;
+}
+
+// Open-or-create a regular file by path. The parent directory must exist.
+file_t* fs_create_file(const char* path) {
+    write_lock(&fs_tree_lock);
+    file_t* f = fs_lookup_or_create(path);
+    write_unlock(&fs_tree_lock);
+    return f;
+}
+
+// Drop everything cached from a file's old contents
+void fs_file_changed(file_t* file) {
+    elf_image_invalidate(file);
+    snapshot_invalidate(file);
+}
+
 // --- 4. High-Level FS Operations ---
 
 void fs_mkdir(const char* name) {
     // Basic mkdir only works in current directory for now
-    if (fs_find_child(current_process->cwd, name)) {
+    write_lock(&fs_tree_lock);
+    if (fs_find_child(current_process->leader->cwd, name)) {
+        write_unlock(&fs_tree_lock);
         term_print("Error: Directory already exists.\n");
         return;
     }
     file_t* dir = fs_create_node(name, FS_DIRECTORY);
-    fs_insert_child(current_process->cwd, dir);
+    fs_insert_child(current_process->leader->cwd, dir);
+    write_unlock(&fs_tree_lock);
     term_print("Directory created.\n");
 }
 
 void fs_touch(const char* name) {
-    if (fs_find_child(current_process->cwd, name)) {
+    write_lock(&fs_tree_lock);
+    if (fs_find_child(current_process->leader->cwd, name)) {
+        write_unlock(&fs_tree_lock);
         term_print("Error: File already exists.\n");
         return;
     }
     file_t* f = fs_create_node(name, FS_FILE);
-    fs_insert_child(current_process->cwd, f);
+    fs_insert_child(current_process->leader->cwd, f);
+    write_unlock(&fs_tree_lock);
     term_print("File created.\n");
 }
 
 void fs_list(const char* path) {
+    read_lock(&fs_tree_lock);
     file_t* dir;
-    if (path) dir = fs_resolve_path(path);
-    else dir = current_process->cwd;
+    if (path) dir = fs_lookup(path);
+    else dir = current_process->leader->cwd;
 
     if (!dir || dir->flags != FS_DIRECTORY) {
+        read_unlock(&fs_tree_lock);
         term_print("Invalid directory.\n");
         return;
     }
@@ -176,16 +258,20 @@ void fs_list(const char* path) {
         term_print("\n");
         curr = curr->next;
     }
+    read_unlock(&fs_tree_lock);
     term_print("---------------\n");
 }
 
 void fs_cat(const char* path) {
-    file_t* f = fs_resolve_path(path);
+    read_lock(&fs_tree_lock);
+    file_t* f = fs_lookup(path);
     if (!f || f->flags == FS_DIRECTORY) {
+        read_unlock(&fs_tree_lock);
         term_print("File not found or is a directory.\n");
         return;
     }
     if (!f->data) {
+        read_unlock(&fs_tree_lock);
         term_print("(Empty)\n");
         return;
     }
@@ -194,32 +280,62 @@ void fs_cat(const char* path) {
         char t[2] = {f->data[i], 0};
         term_print(t);
     }
+    read_unlock(&fs_tree_lock);
     term_print("\n");
 }
 
 void fs_write(const char* path, const char* content) {
-    file_t* f = fs_resolve_path(path);
-    if (!f) { term_print("File not found.\n"); return; }
+    write_lock(&fs_tree_lock);
+    file_t* f = fs_lookup(path);
+    if (!f) {
+        write_unlock(&fs_tree_lock);
+        term_print("File not found.\n");
+        return;
+    }
+    fs_file_changed(f);
     
     if (f->data) kfree(f->data);
     
     int len = strlen(content);
     f->data = (char*)kmalloc(len + 1);
-    for(int i=0; i<len; i++) f->data[i] = content[i];
+    memcpy(f->data, content, len);
     f->size = len;
+    write_unlock(&fs_tree_lock);
     
     term_print("Written.\n");
 }
 
+// Drop every descriptor reference to a node that is about to be freed:
+// open handles are closed, directory cursors step past it.
+static void fs_forget_node(file_t* node) {
+    fs_file_changed(node);
+
+    process_t* proc = ready_queue;
+    if (!proc) return;
+    do {
+        for (int i = 0; i < MAX_OPEN_FILES; i++) {
+            file_descriptor_t* desc = &proc->fd_table[i];
+            if (desc->file_node == node) {
+                desc->file_node = 0;
+                desc->type = FD_NONE;
+            }
+            if (desc->dir_next == node) desc->dir_next = node->next;
+        }
+        proc = proc->next;
+    } while (proc != ready_queue);
+}
+
 void fs_delete(const char* name) {
     // Only deletes from CWD for simplicity
-    file_t* parent = current_process->cwd;
+    write_lock(&fs_tree_lock);
+    file_t* parent = current_process->leader->cwd;
     file_t* curr = parent->children;
     file_t* prev = 0;
     
     while(curr) {
         if (strcmp(curr->name, name) == 0) {
             if (curr->flags == FS_DIRECTORY && curr->children) {
+                write_unlock(&fs_tree_lock);
                 term_print("Error: Directory not empty.\n");
                 return;
             }
@@ -228,13 +344,16 @@ void fs_delete(const char* name) {
             if (prev) prev->next = curr->next;
             else parent->children = curr->next;
             
+            fs_forget_node(curr);
             kfree(curr);
+            write_unlock(&fs_tree_lock);
             term_print("Deleted.\n");
             return;
         }
         prev = curr;
         curr = curr->next;
     }
+    write_unlock(&fs_tree_lock);
     term_print("Not found.\n");
 }
 
@@ -243,75 +362,309 @@ void fs_delete(const char* name) {
 // Helper: Find free file descriptor slot
 int get_free_fd() {
     for(int i=0; i<MAX_OPEN_FILES; i++) {
-        if (current_process->fd_table[i].file_node == 0) return i;
+        if (current_process->leader->fd_table[i].type == FD_NONE) return i;
     }
     return -1;
 }
 
 int sys_open(const char* path) {
-    file_t* f = fs_resolve_path(path);
-    if (!f) return -1;
-    
     int fd = get_free_fd();
     if (fd == -1) return -1;
+
+    read_lock(&fs_tree_lock);
+    file_t* f = fs_lookup(path);
+    if (!f) {
+        read_unlock(&fs_tree_lock);
+        return -1;
+    }
     
-    current_process->fd_table[fd].file_node = f;
-    current_process->fd_table[fd].offset = 0;
+    current_process->leader->fd_table[fd].file_node = f;
+    current_process->leader->fd_table[fd].offset = 0;
+    current_process->leader->fd_table[fd].type = FD_FILE;
+    current_process->leader->fd_table[fd].dir_next = f->children;
+    current_process->leader->fd_table[fd].dir_index = 0;
+    read_unlock(&fs_tree_lock);
     // Flags could be added here
     return fd;
 }
 
 void sys_close(int fd) {
-    if (fd >= 0 && fd < MAX_OPEN_FILES) {
-        current_process->fd_table[fd].file_node = 0;
+    if (fd < 0 || fd >= MAX_OPEN_FILES) return;
+    file_descriptor_t* desc = &current_process->leader->fd_table[fd];
+    if (desc->type == FD_NONE) return;
+
+    // Unwatched first, so nothing refers to the object when it goes
+    epoll_fd_closed(fd);
+    if (desc->type == FD_PIPE_READ || desc->type == FD_PIPE_WRITE)
+        pipe_close((pipe_t*)desc->object, desc->type == FD_PIPE_WRITE);
+    else if (desc->type == FD_TIMER)
+        timerfd_close((timerfd_t*)desc->object);
+    else if (desc->type == FD_EPOLL)
+        epoll_close((epoll_t*)desc->object);
+
+    desc->file_node = 0;
+    desc->object = 0;
+    desc->flags = 0;
+    desc->type = FD_NONE;
+}
+
+// Process exit: pipes, timers and epoll instances are not freed otherwise
+void sys_close_all() {
+    for (int fd = 0; fd < MAX_OPEN_FILES; fd++) sys_close(fd);
+}
+
+// F_GETFL / F_SETFL on the descriptor flags (FD_NONBLOCK)
+int sys_fcntl(int fd, int cmd, int arg) {
+    if (fd < 0 || fd >= MAX_OPEN_FILES) return -1;
+    file_descriptor_t* desc = &current_process->leader->fd_table[fd];
+    if (desc->type == FD_NONE) return -1;
+    if (cmd == F_GETFL) return desc->flags;
+    if (cmd != F_SETFL) return -1;
+    desc->flags = arg & FD_NONBLOCK;
+    return 0;
+}
+
+// --- Event Descriptors ---
+
+static int fd_install(int type, void* object) {
+    int fd = get_free_fd();
+    if (fd == -1) return -1;
+    file_descriptor_t* desc = &current_process->leader->fd_table[fd];
+    memset(desc, 0, sizeof(file_descriptor_t));
+    desc->type = type;
+    desc->object = object;
+    return fd;
+}
+
+// fds[0] reads what fds[1] writes
+int sys_pipe(int* fds) {
+    pipe_t* p = pipe_create();
+    if (!p) return -1;
+    fds[0] = fd_install(FD_PIPE_READ, p);
+    if (fds[0] < 0) {
+        kfree(p);
+        return -1;
+    }
+    fds[1] = fd_install(FD_PIPE_WRITE, p);
+    if (fds[1] < 0) {
+        p->writers = 0;
+        sys_close(fds[0]);
+        return -1;
     }
+    return 0;
+}
+
+int sys_timerfd_create() {
+    timerfd_t* t = timerfd_create();
+    if (!t) return -1;
+    int fd = fd_install(FD_TIMER, t);
+    if (fd < 0) timerfd_close(t);
+    return fd;
+}
+
+int sys_timerfd_set(int fd, uint64_t first_ns, uint64_t interval_ns) {
+    if (fd < 0 || fd >= MAX_OPEN_FILES) return -1;
+    file_descriptor_t* desc = &current_process->leader->fd_table[fd];
+    if (desc->type != FD_TIMER) return -1;
+    timerfd_set((timerfd_t*)desc->object, first_ns, interval_ns);
+    return 0;
+}
+
+int sys_epoll_create() {
+    epoll_t* ep = epoll_create();
+    if (!ep) return -1;
+    int fd = fd_install(FD_EPOLL, ep);
+    if (fd < 0) epoll_close(ep);
+    return fd;
+}
+
+static epoll_t* fd_epoll(int epfd) {
+    if (epfd < 0 || epfd >= MAX_OPEN_FILES) return 0;
+    file_descriptor_t* desc = &current_process->leader->fd_table[epfd];
+    return desc->type == FD_EPOLL ? (epoll_t*)desc->object : 0;
+}
+
+int sys_epoll_ctl(int epfd, int op, int fd, const epoll_event_t* ev) {
+    epoll_t* ep = fd_epoll(epfd);
+    return ep ? epoll_ctl(ep, op, fd, ev) : -1;
+}
+
+int sys_epoll_wait(int epfd, epoll_event_t* events, int max, int timeout_ms) {
+    epoll_t* ep = fd_epoll(epfd);
+    if (!ep || max <= 0) return -1;
+    return epoll_wait(ep, events, max, timeout_ms);
+}
+
+// --- Console Descriptors ---
+
+// Line-at-a-time in canonical mode, see tty.c
+static int console_read(file_descriptor_t* desc, char* buffer, int size) {
+    if (desc->flags & FD_NONBLOCK) return tty_read_nonblock(buffer, size);
+    return tty_read(buffer, size);
+}
+
+static int console_write(const char* buffer, int size) {
+    for (int i = 0; i < size; i++) term_putc(buffer[i]);
+    return size;
+}
+
+// Grow a file so it holds at least 'end' bytes. One copy per call, so
+// callers with several buffers reserve for all of them up front.
+static void file_reserve(file_t* file, uint32_t end) {
+    if (end <= file->size) return;
+    char* new_data = (char*)kmalloc(end);
+    if (file->data) {
+        memcpy(new_data, file->data, file->size);
+        kfree(file->data);
+    }
+    file->data = new_data;
+    file->size = end;
 }
 
 int sys_read_file(int fd, char* buffer, int size) {
     if (fd < 0 || fd >= MAX_OPEN_FILES) return -1;
-    file_descriptor_t* desc = &current_process->fd_table[fd];
+    file_descriptor_t* desc = &current_process->leader->fd_table[fd];
+    int nonblock = desc->flags & FD_NONBLOCK;
+    if (desc->type == FD_CONSOLE) return console_read(desc, buffer, size);
+    if (desc->type == FD_PIPE_READ) return pipe_read((pipe_t*)desc->object, buffer, size, nonblock);
+    if (desc->type == FD_TIMER) return timerfd_read((timerfd_t*)desc->object, buffer, size, nonblock);
+    if (desc->type != FD_FILE) return -1;
+
+    read_lock(&fs_tree_lock);
     file_t* file = (file_t*)desc->file_node;
-    if (!file) return -1;
-
-    int left = file->size - desc->offset;
-    if (left <= 0) return 0;
-    
-    int to_read = (size < left) ? size : left;
-    for(int i=0; i<to_read; i++) {
-        buffer[i] = file->data[desc->offset + i];
+    int to_read = -1;
+    if (file) {
+        int left = file->size - desc->offset;
+        to_read = (left <= 0) ? 0 : (size < left) ? size : left;
+        memcpy(buffer, file->data + desc->offset, to_read);
+        desc->offset += to_read;
     }
-    desc->offset += to_read;
+    read_unlock(&fs_tree_lock);
     return to_read;
 }
 
 int sys_write_file(int fd, char* buffer, int size) {
     if (fd < 0 || fd >= MAX_OPEN_FILES) return -1;
-    file_descriptor_t* desc = &current_process->fd_table[fd];
+    file_descriptor_t* desc = &current_process->leader->fd_table[fd];
+    if (desc->type == FD_CONSOLE) return console_write(buffer, size);
+    if (desc->type == FD_PIPE_WRITE)
+        return pipe_write((pipe_t*)desc->object, buffer, size, desc->flags & FD_NONBLOCK);
+    if (desc->type != FD_FILE) return -1;
+
+    write_lock(&fs_tree_lock);
     file_t* file = (file_t*)desc->file_node;
-    if (!file) return -1;
+    if (!file) {
+        write_unlock(&fs_tree_lock);
+        return -1;
+    }
+    fs_file_changed(file);
 
     // Expand file if writing past end
-    int end_pos = desc->offset + size;
-    if (end_pos > (int)file->size) {
-        char* new_data = (char*)kmalloc(end_pos);
-        // Copy old data
-        for(uint32_t i=0; i<file->size; i++) new_data[i] = file->data[i];
-        if (file->data) kfree(file->data);
-        file->data = new_data;
-        file->size = end_pos;
-    }
+    file_reserve(file, desc->offset + size);
 
     // Write new data
-    for(int i=0; i<size; i++) {
-        file->data[desc->offset + i] = buffer[i];
-    }
+    memcpy(file->data + desc->offset, buffer, size);
     desc->offset += size;
+    write_unlock(&fs_tree_lock);
     return size;
 }
 
+// Vectored variants. The caller passes a kernel copy of the vector with every
+// segment validated. Writes grow the file once for the whole vector; reads
+// stop at the first short one.
+int sys_readv(int fd, const struct iovec* iov, int iovcnt) {
+    if (fd < 0 || fd >= MAX_OPEN_FILES) return -1;
+    file_descriptor_t* desc = &current_process->leader->fd_table[fd];
+    if (desc->type == FD_NONE) return -1;
+
+    int total = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        if (iov[i].len == 0) continue;
+        int n = sys_read_file(fd, (char*)iov[i].base, iov[i].len);
+        if (n < 0) return total ? total : n;
+        total += n;
+        // Short read: EOF, or the console or pipe has nothing more buffered.
+        // Those would block on the next segment, so one is enough.
+        if ((uint32_t)n < iov[i].len) break;
+        if (desc->type != FD_FILE) break;
+    }
+    return total;
+}
+
+int sys_writev(int fd, const struct iovec* iov, int iovcnt) {
+    if (fd < 0 || fd >= MAX_OPEN_FILES) return -1;
+    file_descriptor_t* desc = &current_process->leader->fd_table[fd];
+
+    uint32_t total = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        if (total + iov[i].len < total) return -1; // Overflow
+        total += iov[i].len;
+    }
+
+    if (desc->type == FD_CONSOLE) {
+        for (int i = 0; i < iovcnt; i++) console_write((const char*)iov[i].base, iov[i].len);
+        return total;
+    }
+
+    // Pipes take one segment at a time and may stop short (non-blocking)
+    if (desc->type == FD_PIPE_WRITE) {
+        int written = 0;
+        for (int i = 0; i < iovcnt; i++) {
+            if (iov[i].len == 0) continue;
+            int n = sys_write_file(fd, (char*)iov[i].base, iov[i].len);
+            if (n < 0) return written ? written : n;
+            written += n;
+            if ((uint32_t)n < iov[i].len) break;
+        }
+        return written;
+    }
+
+    write_lock(&fs_tree_lock);
+    file_t* file = (file_t*)desc->file_node;
+    if (desc->type != FD_FILE || !file) {
+        write_unlock(&fs_tree_lock);
+        return -1;
+    }
+
+    fs_file_changed(file);
+    file_reserve(file, desc->offset + total);
+    for (int i = 0; i < iovcnt; i++) {
+        memcpy(file->data + desc->offset, iov[i].base, iov[i].len);
+        desc->offset += iov[i].len;
+    }
+    write_unlock(&fs_tree_lock);
+    return total;
+}
+
+// Positional variants for the submission ring. offset < 0 means "use and
+// advance the descriptor's offset", otherwise the offset is left untouched.
+int sys_pread(int fd, char* buffer, int size, int offset) {
+    if (offset < 0) return sys_read_file(fd, buffer, size);
+    if (fd < 0 || fd >= MAX_OPEN_FILES) return -1;
+    file_descriptor_t* desc = &current_process->leader->fd_table[fd];
+
+    int saved = desc->offset;
+    desc->offset = offset;
+    int ret = sys_read_file(fd, buffer, size);
+    desc->offset = saved;
+    return ret;
+}
+
+int sys_pwrite(int fd, char* buffer, int size, int offset) {
+    if (offset < 0) return sys_write_file(fd, buffer, size);
+    if (fd < 0 || fd >= MAX_OPEN_FILES) return -1;
+    file_descriptor_t* desc = &current_process->leader->fd_table[fd];
+
+    int saved = desc->offset;
+    desc->offset = offset;
+    int ret = sys_write_file(fd, buffer, size);
+    desc->offset = saved;
+    return ret;
+}
+
 int sys_seek(int fd, int offset, int whence) {
     if (fd < 0 || fd >= MAX_OPEN_FILES) return -1;
-    file_descriptor_t* desc = &current_process->fd_table[fd];
+    file_descriptor_t* desc = &current_process->leader->fd_table[fd];
     file_t* file = (file_t*)desc->file_node;
     if (!file) return -1;
 
@@ -330,36 +683,91 @@ int sys_seek(int fd, int offset, int whence) {
 int sys_chdir(const char* path) {
     file_t* dir = fs_resolve_path(path);
     if (!dir || dir->flags != FS_DIRECTORY) return -1;
-    current_process->cwd = dir;
+    current_process->leader->cwd = dir;
     return 0;
 }
 
 void sys_getcwd(char* buf, int size) {
     (void)size;
     // Simple version: return just the name of the current folder
-    if (current_process->cwd == fs_root) {
+    if (current_process->leader->cwd == fs_root) {
         strcpy_safe(buf, "/");
     } else {
         buf[0] = '/';
-        strcpy_safe(buf + 1, current_process->cwd->name);
+        strcpy_safe(buf + 1, current_process->leader->cwd->name);
     }
 }
 
 int sys_readdir(int index, char* buf) {
     // List files in CWD
-    file_t* curr = current_process->cwd->children;
+    read_lock(&fs_tree_lock);
+    file_t* curr = current_process->leader->cwd->children;
     int i = 0;
     while (curr) {
         if (i == index) {
             strcpy_safe(buf, curr->name);
+            read_unlock(&fs_tree_lock);
             return 1;
         }
         curr = curr->next;
         i++;
     }
+    read_unlock(&fs_tree_lock);
     return 0;
 }
 
+// Fill 'buf' with as many dirent_t records as fit, resuming where the last
+// call on this fd stopped. Returns bytes written, 0 at the end, -1 if the
+// fd is not a directory or buf cannot hold the next record.
+int sys_getdents(int fd, char* buf, int size) {
+    if (fd < 0 || fd >= MAX_OPEN_FILES) return -1;
+    file_descriptor_t* desc = &current_process->leader->fd_table[fd];
+    read_lock(&fs_tree_lock);
+    file_t* dir = (file_t*)desc->file_node;
+    if (desc->type != FD_FILE || !dir || dir->flags != FS_DIRECTORY) {
+        read_unlock(&fs_tree_lock);
+        return -1;
+    }
+
+    // The cursor is only trusted if nobody seeked the fd since we left it
+    if (desc->offset != desc->dir_index) {
+        file_t* curr = dir->children;
+        for (int i = 0; curr && i < desc->offset; i++) curr = curr->next;
+        desc->dir_next = curr;
+        desc->dir_index = desc->offset;
+    }
+
+    int used = 0;
+    file_t* curr = desc->dir_next;
+    while (curr) {
+        int namelen = strlen(curr->name);
+        int reclen = (sizeof(dirent_t) + namelen + 1 + 3) & ~3;
+        if (used + reclen > size) {
+            if (used == 0) {
+                read_unlock(&fs_tree_lock);
+                return -1;
+            }
+            break;
+        }
+
+        dirent_t* d = (dirent_t*)(buf + used);
+        d->reclen = reclen;
+        d->type = (curr->flags == FS_DIRECTORY) ? DT_DIR : DT_FILE;
+        d->namelen = namelen;
+        d->size = curr->size;
+        memcpy(d->name, curr->name, namelen + 1);
+
+        used += reclen;
+        desc->dir_index++;
+        curr = curr->next;
+    }
+
+    desc->dir_next = curr;
+    desc->offset = desc->dir_index;
+    read_unlock(&fs_tree_lock);
+    return used;
+}
+
 // --- 6. Persistence (Save/Load) ---
 
 void path_join(char* dest, const char* parent, const char* child) {
@@ -389,10 +797,9 @@ void fs_flatten_tree(file_t* node, char* current_path, disk_file_entry_t* table,
         int sectors = (node->size + 511) / 512;
         if (node->data) {
             uint32_t* buf = (uint32_t*)kmalloc(sectors * 512);
-            // Zero out buffer
-            for(int k=0; k<sectors*512; k++) ((char*)buf)[k] = 0;
-            // Copy data
-            for(uint32_t k=0; k<node->size; k++) ((char*)buf)[k] = node->data[k];
+            // Zero the padding, then copy data
+            memset((char*)buf + node->size, 0, sectors * 512 - node->size);
+            memcpy(buf, node->data, node->size);
             
             ata_write_sectors(DATA_START_SECTOR + *sector_offset, sectors, buf);
             kfree(buf);
@@ -417,11 +824,13 @@ void fs_save_to_disk() {
     
     // 2. Table
     disk_file_entry_t* table = (disk_file_entry_t*)kmalloc(MAX_FILES * sizeof(disk_file_entry_t));
-    for(uint32_t i=0; i < MAX_FILES * sizeof(disk_file_entry_t); i++) ((char*)table)[i] = 0;    
+    memset(table, 0, MAX_FILES * sizeof(disk_file_entry_t));
     int count = 0;
     int offset = 0;
     
-    // Start recursion from root's children
+    // Start recursion from root's children. Writers wait until the data
+    // is on disk, so the table and the sectors agree.
+    read_lock(&fs_tree_lock);
     if (fs_root->children) {
         fs_flatten_tree(fs_root->children, "", table, &count, &offset);
     }
@@ -432,6 +841,7 @@ void fs_save_to_disk() {
     // Assuming table fits in 4 sectors (64 files * ~72 bytes = 4600 bytes) -> 9 sectors.
     // Let's write 8 sectors for the table to be safe.
     ata_write_sectors(1, 8, (uint32_t*)table);
+    read_unlock(&fs_tree_lock);
     
     kfree(header);
     kfree(table);
@@ -469,11 +879,13 @@ void fs_load_from_disk() {
         
         ata_read_sectors(DATA_START_SECTOR + table[i].data_sector_offset, sectors, buf);
         
-        for(uint32_t k=0; k<f->size; k++) f->data[k] = ((char*)buf)[k];
+        memcpy(f->data, buf, f->size);
         f->data[f->size] = 0;
         kfree(buf);
         
+        write_lock(&fs_tree_lock);
         fs_insert_child(fs_root, f);
+        write_unlock(&fs_tree_lock);
     }
     
     kfree(table);
@@ -481,7 +893,8 @@ void fs_load_from_disk() {
 
 // --- 7. Initialization ---
 
-void init_fs(multiboot_info_t* mboot_ptr) {
+void init_fs(void* mboot) {
+    multiboot_info_t* mboot_ptr = (multiboot_info_t*)mboot;
     fs_root = fs_create_node("/", FS_DIRECTORY);
     
     // Load Modules (RamFS)
@@ -493,8 +906,7 @@ void init_fs(multiboot_info_t* mboot_ptr) {
             
             uint32_t len = mod[i].mod_end - mod[i].mod_start;
             f->data = (char*)kmalloc(len + 1);
-            char* src = (char*)mod[i].mod_start;
-            for(uint32_t k=0; k<len; k++) f->data[k] = src[k];
+            memcpy(f->data, (char*)mod[i].mod_start, len);
             f->data[len] = 0;
             f->size = len;
             
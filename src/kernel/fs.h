@@ -3,23 +3,47 @@
 
 #include <stdint.h>
 
+// Node Types
+#define FS_FILE 0
+#define FS_DIRECTORY 1
+
 // Struct Definitions
+
+// The In-Memory Node (Tree)
 typedef struct file_node {
     char name[32];
-    char* data;
-    uint32_t size;
-    uint8_t flags;
-    struct file_node* parent;
-    struct file_node* children;
-    struct file_node* next;
+    char* data;             // File content (NULL if directory)
+    uint32_t size;          // File size
+    uint8_t flags;          // FS_FILE or FS_DIRECTORY
+    
+    // Tree Pointers
+    struct file_node* parent;   // Parent directory ("..")
+    struct file_node* children; // First child (if this is a directory)
+    struct file_node* next;     // Next sibling in the same directory
 } file_t;
 
 extern file_t* fs_root; // Extern declaration
 
+// getdents record. Records are packed back to back, each padded to 4 bytes;
+// name is NUL-terminated. NOTE: Mirrored in programs/stdlib.h
+#define DT_FILE 0
+#define DT_DIR  1
+
+typedef struct {
+    uint16_t reclen;  // Bytes to the next record
+    uint8_t type;     // DT_*
+    uint8_t namelen;  // Excluding the NUL
+    uint32_t size;
+    char name[];
+} dirent_t;
+
 // Function Prototypes
 void init_fs(void* mboot_ptr); // Use void* to avoid circular include dep
 file_t* fs_resolve_path(const char* path);
 void fs_delete(const char* name);
+int fs_get_path(file_t* node, char* buf, int size);
+file_t* fs_create_file(const char* path);
+void fs_file_changed(file_t* file); // Call before a file's data changes or it is deleted
 // ... Add prototypes for fs_read, fs_write, etc.
 
 #endif
\ No newline at end of file
@@ -0,0 +1,58 @@
+/* src/kernel/futex.c */
+#include "futex.h"
+#include "process.h"
+#include "wait.h"
+#include "clock.h"
+#include "../mm/vmm.h"
+
+extern int is_valid_user_ptr(void* ptr, int size);
+
+static wait_queue_t futex_buckets[FUTEX_BUCKETS];
+
+// Physical address of a user word, 0 if it is not one. A copy-on-write
+// page is copied now: the first write would otherwise move the word to a
+// new frame, away from anyone sleeping on the old one.
+static uint32_t futex_key(uint32_t* uaddr) {
+    uint32_t addr = (uint32_t)uaddr;
+    if ((addr & 3) || !is_valid_user_ptr(uaddr, sizeof(uint32_t))) return 0;
+
+    page_directory_t* pd = (page_directory_t*)current_process->cr3;
+    uint32_t pte = vmm_get_pte_in_dir(pd, uaddr);
+    if ((pte & (I86_PTE_PRESENT | I86_PTE_USER)) != (I86_PTE_PRESENT | I86_PTE_USER)) return 0;
+    if (pte & I86_PTE_COW) {
+        if (!vmm_handle_cow_fault(addr, 0x7)) return 0; // As a user write would
+        pte = vmm_get_pte_in_dir(pd, uaddr);
+    }
+    return (pte & 0xFFFFF000) | (addr & 0xFFF);
+}
+
+static wait_queue_t* futex_bucket(uint32_t key) {
+    return &futex_buckets[((key >> 2) * 2654435761u) >> (32 - FUTEX_HASH_BITS)];
+}
+
+int futex_wait(uint32_t* uaddr, uint32_t val, uint64_t timeout_ns) {
+    uint64_t deadline = timeout_ns == WAIT_FOREVER ? 0 : clock_now_ns() + timeout_ns;
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+
+    // Checked and queued in one go: a waker changes the word, then needs
+    // the big kernel lock to get to futex_wake(), and we hold it until we sleep
+    uint32_t key = futex_key(uaddr);
+    int result = -1;
+    if (key) {
+        result = 0;
+        if (*(volatile uint32_t*)uaddr == val) {
+            current_process->wait_key = key;
+            if (wait_queue_wait_killable(futex_bucket(key), deadline) != WAIT_WOKEN) result = -1;
+        }
+    }
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return result;
+}
+
+int futex_wake(uint32_t* uaddr, int n) {
+    uint32_t key = futex_key(uaddr);
+    if (!key) return -1;
+    if (n <= 0) return 0;
+    return wait_queue_wake_key(futex_bucket(key), key, n);
+}
@@ -0,0 +1,27 @@
+/* src/kernel/futex.h */
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <stdint.h>
+
+// Fast user-space locking. User code keeps its lock state in an aligned
+// 32-bit word and only calls in to sleep when the word says it must, or
+// to wake sleepers after changing it. Waiters are keyed by the word's
+// physical address, so threads and processes sharing the page meet on
+// the same key whatever their virtual addresses.
+//
+// Waiters hang on FUTEX_BUCKETS wait queues, hashed by key; a wake scans
+// only its bucket and picks out waiters with the same key.
+
+#define FUTEX_HASH_BITS 6
+#define FUTEX_BUCKETS   (1 << FUTEX_HASH_BITS)
+
+// Sleep while *uaddr == val. 0 once woken (or if *uaddr already differed:
+// the caller rechecks either way); -1 on timeout, a bad address, or when
+// the process is exiting. timeout_ns: WAIT_FOREVER or relative.
+int futex_wait(uint32_t* uaddr, uint32_t val, uint64_t timeout_ns);
+
+// Wake up to n waiters on uaddr; returns how many, or -1 on a bad address
+int futex_wake(uint32_t* uaddr, int n);
+
+#endif
@@ -7,6 +7,16 @@
 #include "../mm/heap.h"
 #include "syscall.h"
 #include "../gui/window.h"
+#include "../cpu/cpu.h"
+#include "../cpu/fpu.h"
+#include "../cpu/acpi.h"
+#include "../cpu/irq.h"
+#include "../cpu/smp.h"
+#include "memops.h"
+#include "clock.h"
+#include "timer.h"
+#include "sched.h"
+#include "../drivers/tty.h"
 
 // --- Externs ---
 extern void init_serial();
@@ -30,7 +40,6 @@ extern int mouse_left_button;
 
 extern void wm_putc(window_t* win, char c);
 extern void wm_print(window_t* win, const char* str);
-extern int strlen(const char* str);
 extern void strcpy_safe(char* dest, const char* src);
 
 window_t* console_win = 0;
@@ -42,11 +51,6 @@ void sys_print(const char* msg) {
 void sys_yield() {
     __asm__ volatile ("int $0x80" : : "a" (SYS_YIELD));
 }
-char sys_read() {
-    char c;
-    __asm__ volatile ("int $0x80" : "=a" (c) : "a" (SYS_READ));
-    return c;
-}
 
 // --- Terminal Abstraction ---
 
@@ -66,13 +70,22 @@ void term_print(const char* str) {
     }
 }
 
+void term_print_dec(uint32_t n) {
+    char buffer[11];
+    int i = 10;
+    buffer[10] = 0;
+    do {
+        buffer[--i] = '0' + (n % 10);
+        n /= 10;
+    } while (n > 0);
+    term_print(&buffer[i]);
+}
+
 void term_clear() {
     if (console_win) {
         // Clear window buffer to bg_color
         int total = console_win->width * console_win->height;
-        for(int i = 0; i < total; i++) {
-            console_win->buffer[i] = console_win->bg_color;
-        }
+        memset32(console_win->buffer, console_win->bg_color, total);
         console_win->cursor_x = 0;
         console_win->cursor_y = 0;
     }
@@ -80,107 +93,49 @@ void term_clear() {
 
 // --- Shell & Tasks ---
 
-#define HISTORY_MAX 10
-#define CMD_LEN 256
-char history[HISTORY_MAX][CMD_LEN];
-int history_count = 0;
+#define CMD_LEN TTY_LINE_MAX
 
+// Line editing, echo and history live in the TTY (src/drivers/tty.c);
+// we sleep until a whole command has been typed.
 void shell_task() {
     char cmd_buffer[CMD_LEN];
-    int idx = 0;
-    int history_view_idx = 0; 
 
     // MODIFIED: Message indicates Kernel Mode
     sys_print("\n[SHELL] Process Started (Kernel Mode).\n");
     sys_print("MyOS Shell > ");
 
     while(1) {
-        char c = sys_read();
-        
-        if (c == 0) {
-            sys_yield();
-            continue;
-        }
-
-        // UP ARROW (0x11)
-        if (c == 0x11) {
-            if (history_count > 0 && history_view_idx > 0) {
-                while(idx > 0) { sys_print("\b \b"); idx--; }
-                history_view_idx--;
-                strcpy_safe(cmd_buffer, history[history_view_idx]);
-                idx = strlen(cmd_buffer);
-                sys_print(cmd_buffer);
-            }
-        }
-        // DOWN ARROW (0x12)
-        else if (c == 0x12) {
-            if (history_count > 0 && history_view_idx < history_count) {
-                while(idx > 0) { sys_print("\b \b"); idx--; }
-                history_view_idx++;
-                if (history_view_idx == history_count) {
-                    cmd_buffer[0] = 0; idx = 0;
-                } else {
-                    strcpy_safe(cmd_buffer, history[history_view_idx]);
-                    idx = strlen(cmd_buffer);
-                    sys_print(cmd_buffer);
-                }
-            }
-        }
-        // ENTER
-        else if (c == '\n') {
-            sys_print("\n");
-            cmd_buffer[idx] = '\0';
-            
-            if (idx > 0) {
-                if (history_count < HISTORY_MAX) {
-                    strcpy_safe(history[history_count], cmd_buffer);
-                    history_count++;
-                } else {
-                    for(int i=0; i<HISTORY_MAX-1; i++) strcpy_safe(history[i], history[i+1]);
-                    strcpy_safe(history[HISTORY_MAX-1], cmd_buffer);
-                }
-                history_view_idx = history_count; 
-                execute_command(cmd_buffer);
-            } else {
-                execute_command(""); 
-            }
-            idx = 0;
-        }
-        // BACKSPACE
-        else if (c == '\b') {
-            if (idx > 0) { idx--; sys_print("\b \b"); }
-        }
-        // NORMAL CHAR
-        else if (c >= ' ' && c <= '~') {
-            if (idx < CMD_LEN - 1) {
-                cmd_buffer[idx++] = c;
-                char temp[2] = {c, '\0'};
-                sys_print(temp);
-            }
-        }
+        int n = tty_read(cmd_buffer, CMD_LEN - 1);
+        if (n > 0 && cmd_buffer[n - 1] == '\n') n--;
+        cmd_buffer[n] = '\0';
+        execute_command(cmd_buffer);
     }
 }
 
 void system_monitor_task() {
-    int counter = 0;
     while(1) {
-        counter++;
-        if (counter % 100000000 == 0) {
-            serial_log(" [BG-TASK] System Alive. Tick...\n");
-            counter = 0;
-        }
+        timer_sleep_ns(10000000000ULL);
+        serial_log(" [BG-TASK] System Alive. Tick...\n");
     }
 }
 
 void kmain(multiboot_info_t* mboot_ptr) {
     init_serial();
+    init_cpu();
+    init_fpu();
+    init_memops();
     
     // 1. Initialize Core
     init_gdt();
     init_idt();
+    init_syscalls();
     init_pmm(mboot_ptr->mem_upper); 
     init_vmm();
     init_heap();
+    init_clock();
+    init_acpi();  // May map tables: must precede any address space too
+    init_timer(); // Maps the local APIC: must precede any address space
+    init_irq();   // Likewise the I/O APIC
     init_ata();
     init_fs(mboot_ptr);
 
@@ -194,24 +149,40 @@ void kmain(multiboot_info_t* mboot_ptr) {
     console_win->text_color = 0xFFFFFFFF;
     console_win->bg_color   = 0xFF000000;
     // Clear buffer to black
-    for(int i=0; i < 600*400; i++) console_win->buffer[i] = 0xFF000000;
+    memset32(console_win->buffer, 0xFF000000, 600*400);
 
     term_print(" [SYSTEM] Graphics Terminal Initialized.\n");
 
     // 3. Start Multitasking
     init_multitasking();
+    init_smp();
     
     // FIX: Pass '1' as the last argument to create Kernel Threads (Ring 0).
     // This allows them to access the kernel heap (console_win) and I/O ports without crashing.
     create_process(system_monitor_task, 0, 0, 1);
-    create_process(shell_task, 0, 0, 1);
+    int shell_pid = create_process(shell_task, 0, 0, 1);
+
+    // Input and frames must not wait behind batch jobs: the shell wakes
+    // ahead of every normal process, and the compositor (us) reserves
+    // half of each 60 Hz frame
+    sched_attr_t shell_attr = { 0, 0, 0 };
+    sched_set_class(shell_pid, SCHED_FIFO, &shell_attr);
+    sched_attr_t frame_attr = { 0, 16667, 8000 };
+    sched_set_class(0, SCHED_DEADLINE, &frame_attr);
 
     // 4. Main Loop (The Compositor)
+    uint64_t next_frame = clock_now_ns();
     while(1) {
         // We handle mouse state updates here before refreshing
         wm_mouse_event(mouse_x, mouse_y, mouse_left_button);
         
         // Draw the desktop
         wm_refresh();
+
+        // ~60 frames a second; the CPU idles in between
+        next_frame += 16666667;
+        uint64_t now = clock_now_ns();
+        if (next_frame < now) next_frame = now; // Fell behind: don't burst
+        timer_sleep_until(next_frame);
     }
 }
\ No newline at end of file
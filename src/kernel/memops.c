@@ -0,0 +1,155 @@
+/* src/kernel/memops.c */
+#include "memops.h"
+#include "../cpu/cpu.h"
+#include "../cpu/fpu.h"
+
+extern void serial_log(char *str);
+
+// NOTE: Every variant is written with string instructions in inline asm.
+// A plain C byte loop here could be pattern-matched by GCC back into a
+// call to memcpy/memset, i.e. into ourselves.
+
+// --- Variant 1: REP MOVSD + byte tail (any i386+) ---
+
+static void* memcpy_movsd(void* dest, const void* src, uint32_t n) {
+    void* d = dest;
+    uint32_t dwords = n >> 2;
+    uint32_t tail = n & 3;
+    __asm__ volatile("rep movsl" : "+D"(d), "+S"(src), "+c"(dwords) : : "memory");
+    __asm__ volatile("rep movsb" : "+D"(d), "+S"(src), "+c"(tail) : : "memory");
+    return dest;
+}
+
+static void* memset_stosd(void* ptr, int value, uint32_t num) {
+    void* p = ptr;
+    uint32_t v = (uint8_t)value * 0x01010101;
+    uint32_t dwords = num >> 2;
+    uint32_t tail = num & 3;
+    __asm__ volatile("rep stosl" : "+D"(p), "+c"(dwords) : "a"(v) : "memory");
+    __asm__ volatile("rep stosb" : "+D"(p), "+c"(tail) : "a"(v) : "memory");
+    return ptr;
+}
+
+// --- Variant 2: ERMS (Enhanced REP MOVSB/STOSB) ---
+// On these CPUs microcode moves whole cache lines for a plain REP MOVSB,
+// which beats the dword loop and needs no tail handling.
+
+static void* memcpy_erms(void* dest, const void* src, uint32_t n) {
+    void* d = dest;
+    __asm__ volatile("rep movsb" : "+D"(d), "+S"(src), "+c"(n) : : "memory");
+    return dest;
+}
+
+static void* memset_erms(void* ptr, int value, uint32_t num) {
+    void* p = ptr;
+    __asm__ volatile("rep stosb" : "+D"(p), "+c"(num) : "a"(value) : "memory");
+    return ptr;
+}
+
+// --- Variant 3: SSE2, 64 bytes per iteration ---
+// Only worth the FXSAVE in kernel_fpu_begin() for big copies (framebuffer
+// flips, ELF segments). Small or nested copies take the dword path.
+// Interrupts are off inside kernel_fpu_begin(), so the copy drops out every
+// SSE2_COPY_CHUNK bytes to let pending IRQs in; only the first chunk pays for
+// the FXSAVE, later ones just toggle CR0.TS.
+
+#define SSE2_COPY_MIN   4096
+#define SSE2_COPY_CHUNK 4096
+
+static void* memcpy_sse2(void* dest, const void* src, uint32_t n) {
+    if (n < SSE2_COPY_MIN || kernel_fpu_in_use()) return memcpy_movsd(dest, src, n);
+
+    char* d = (char*)dest;
+    const char* s = (const char*)src;
+
+    for (uint32_t left = n & ~63u; left; ) {
+        uint32_t chunk = left < SSE2_COPY_CHUNK ? left : SSE2_COPY_CHUNK;
+        left -= chunk;
+
+        kernel_fpu_begin();
+        for (uint32_t blocks = chunk >> 6; blocks; blocks--) {
+            // xmm0-3 are not clobber-listed: -mgeneral-regs-only keeps GCC off them
+            __asm__ volatile("movdqu   (%1), %%xmm0\n"
+                             "movdqu 16(%1), %%xmm1\n"
+                             "movdqu 32(%1), %%xmm2\n"
+                             "movdqu 48(%1), %%xmm3\n"
+                             "movdqu %%xmm0,   (%0)\n"
+                             "movdqu %%xmm1, 16(%0)\n"
+                             "movdqu %%xmm2, 32(%0)\n"
+                             "movdqu %%xmm3, 48(%0)\n"
+                             : : "r"(d), "r"(s) : "memory");
+            d += 64;
+            s += 64;
+        }
+        kernel_fpu_end();
+    }
+
+    memcpy_movsd(d, s, n & 63);
+    return dest;
+}
+
+// --- Dispatch ---
+
+static void* (*memcpy_impl)(void*, const void*, uint32_t) = memcpy_movsd;
+static void* (*memset_impl)(void*, int, uint32_t) = memset_stosd;
+
+// Needs init_fpu() to have run so the SSE2 path can be considered
+void init_memops() {
+    if (cpu_has_erms()) {
+        memcpy_impl = memcpy_erms;
+        memset_impl = memset_erms;
+        serial_log(" [MEM] Using ERMS rep movsb/stosb.\n");
+    } else if (fpu_sse_enabled() && cpu_has_edx1(CPUID_EDX_SSE2)) {
+        memcpy_impl = memcpy_sse2;
+        memset_impl = memset_stosd;
+        serial_log(" [MEM] Using SSE2 copies, rep stosd fills.\n");
+    } else {
+        memcpy_impl = memcpy_movsd;
+        memset_impl = memset_stosd;
+        serial_log(" [MEM] Using rep movsd/stosd.\n");
+    }
+}
+
+void* memcpy(void* dest, const void* src, uint32_t n) {
+    return memcpy_impl(dest, src, n);
+}
+
+void* memset(void* ptr, int value, uint32_t num) {
+    return memset_impl(ptr, value, num);
+}
+
+void* memmove(void* dest, const void* src, uint32_t n) {
+    // Forward copy is safe unless dest overlaps the tail of src
+    if ((uint32_t)dest <= (uint32_t)src || (uint32_t)dest >= (uint32_t)src + n) {
+        return memcpy_impl(dest, src, n);
+    }
+
+    // Overlapping, dest above src: copy backwards
+    void* d = (char*)dest + n - 1;
+    const void* s = (const char*)src + n - 1;
+    __asm__ volatile("std; rep movsb; cld" : "+D"(d), "+S"(s), "+c"(n) : : "memory");
+    return dest;
+}
+
+void* memset32(uint32_t* ptr, uint32_t value, uint32_t count) {
+    void* p = ptr;
+    __asm__ volatile("rep stosl" : "+D"(p), "+c"(count) : "a"(value) : "memory");
+    return ptr;
+}
+
+// Word-at-a-time: aligned 4-byte loads never cross into an unmapped page
+int strlen(const char* str) {
+    const char* p = str;
+    while ((uint32_t)p & 3) {
+        if (!*p) return p - str;
+        p++;
+    }
+
+    typedef uint32_t __attribute__((may_alias)) word_t;
+    const word_t* w = (const word_t*)p;
+    while (!((*w - 0x01010101) & ~*w & 0x80808080)) w++;
+
+    p = (const char*)w;
+    while (*p) p++;
+    return p - str;
+}
@@ -0,0 +1,21 @@
+/* src/kernel/memops.h */
+#ifndef MEMOPS_H
+#define MEMOPS_H
+
+#include <stdint.h>
+
+// Picks the fastest copy/fill variant for this CPU. Call after init_cpu()
+// and init_fpu().
+// Until then the REP MOVSD/STOSD variants are used, which work everywhere.
+void init_memops();
+
+void* memcpy(void* dest, const void* src, uint32_t n);
+void* memmove(void* dest, const void* src, uint32_t n);
+void* memset(void* ptr, int value, uint32_t num);
+
+// Fill 'count' 32-bit words (pixels) with 'value'
+void* memset32(uint32_t* ptr, uint32_t value, uint32_t count);
+
+int strlen(const char* str);
+
+#endif
@@ -0,0 +1,132 @@
+/* src/kernel/pipe.c */
+#include "pipe.h"
+#include "process.h"
+#include "../mm/heap.h"
+
+pipe_t* pipe_create() {
+    pipe_t* p = (pipe_t*)kmalloc(sizeof(pipe_t));
+    if (!p) return 0;
+    p->start = 0;
+    p->count = 0;
+    p->readers = 1;
+    p->writers = 1;
+    p->busy = 0;
+    wait_queue_init(&p->read_wait);
+    wait_queue_init(&p->write_wait);
+    p->poll.watchers = 0;
+    return p;
+}
+
+// Gone once neither end has a descriptor and no call is still inside.
+// Interrupts are off.
+static void pipe_put(pipe_t* p) {
+    if (p->readers == 0 && p->writers == 0 && p->busy == 0) {
+        poll_head_detach(&p->poll);
+        kfree(p);
+    }
+}
+
+int pipe_read(pipe_t* p, char* buf, int size, int nonblock) {
+    if (size <= 0) return 0;
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    p->busy++;
+
+    int n = 0;
+    while (p->count == 0 && p->writers > 0) {
+        if (nonblock || wait_queue_wait_killable(&p->read_wait, 0) != WAIT_WOKEN) {
+            n = nonblock ? FD_WOULD_BLOCK : -1;
+            break;
+        }
+    }
+    if (n == 0) {
+        while (n < size && p->count > 0) {
+            buf[n++] = p->buf[p->start];
+            p->start = (p->start + 1) % PIPE_SIZE;
+            p->count--;
+        }
+        if (n > 0) {
+            wait_queue_wake_all(&p->write_wait);
+            poll_wake(&p->poll, EPOLLOUT);
+        }
+    }
+
+    p->busy--;
+    pipe_put(p);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return n;
+}
+
+int pipe_write(pipe_t* p, const char* buf, int size, int nonblock) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    p->busy++;
+
+    int n = 0;
+    while (n < size) {
+        if (p->readers == 0) {
+            if (n == 0) n = -1;
+            break;
+        }
+        if (p->count == PIPE_SIZE) {
+            if (nonblock) {
+                if (n == 0) n = FD_WOULD_BLOCK;
+                break;
+            }
+            if (wait_queue_wait_killable(&p->write_wait, 0) != WAIT_WOKEN) {
+                if (n == 0) n = -1;
+                break;
+            }
+            continue;
+        }
+
+        uint32_t room = PIPE_SIZE - p->count;
+        while (room > 0 && n < size) {
+            p->buf[(p->start + p->count) % PIPE_SIZE] = buf[n++];
+            p->count++;
+            room--;
+        }
+        wait_queue_wake_all(&p->read_wait);
+        poll_wake(&p->poll, EPOLLIN);
+    }
+
+    p->busy--;
+    pipe_put(p);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return n;
+}
+
+// The other end sees EOF (readers) or an error (writers) once one side
+// has no descriptors left
+void pipe_close(pipe_t* p, int write_end) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+
+    if (write_end) {
+        if (--p->writers == 0) {
+            wait_queue_wake_all(&p->read_wait);
+            poll_wake(&p->poll, EPOLLIN | EPOLLHUP);
+        }
+    } else {
+        if (--p->readers == 0) {
+            wait_queue_wake_all(&p->write_wait);
+            poll_wake(&p->poll, EPOLLOUT | EPOLLERR);
+        }
+    }
+    pipe_put(p);
+
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+uint32_t pipe_poll(pipe_t* p, int write_end, poll_head_t** head) {
+    if (head) *head = &p->poll;
+    uint32_t events = 0;
+    if (write_end) {
+        if (p->readers == 0) events |= EPOLLERR;
+        else if (p->count < PIPE_SIZE) events |= EPOLLOUT;
+    } else {
+        if (p->count > 0) events |= EPOLLIN;
+        if (p->writers == 0) events |= EPOLLHUP;
+    }
+    return events;
+}
@@ -0,0 +1,33 @@
+/* src/kernel/pipe.h */
+#ifndef PIPE_H
+#define PIPE_H
+
+#include <stdint.h>
+#include "wait.h"
+#include "epoll.h"
+
+// Byte stream between a read and a write descriptor. Reads return what is
+// buffered (0 once every writer has closed); blocking writes return only
+// when all of it is in, non-blocking ones take what fits.
+
+#define PIPE_SIZE 4096
+
+typedef struct pipe {
+    char buf[PIPE_SIZE];
+    uint32_t start;             // Oldest unread byte
+    uint32_t count;
+    int readers;                // Open descriptors on each end
+    int writers;
+    int busy;                   // Reads and writes under way; they may outlive the descriptors
+    wait_queue_t read_wait;
+    wait_queue_t write_wait;
+    poll_head_t poll;
+} pipe_t;
+
+pipe_t* pipe_create();          // One reader, one writer
+int pipe_read(pipe_t* p, char* buf, int size, int nonblock);
+int pipe_write(pipe_t* p, const char* buf, int size, int nonblock); // -1 with no readers
+void pipe_close(pipe_t* p, int write_end);
+uint32_t pipe_poll(pipe_t* p, int write_end, poll_head_t** head);
+
+#endif
@@ -4,6 +4,14 @@
 #include "../cpu/gdt.h"
 #include "fs.h"
 #include "../mm/vmm.h"
+#include "../cpu/fpu.h"
+#include "memops.h"
+#include "../drivers/tty.h"
+#include "elf.h"
+#include "snapshot.h"
+#include "timer.h"
+#include "sched.h"
+#include "clock.h"
 
 extern struct file_node* fs_root;
 extern void switch_task(uint32_t *old_esp_ptr, uint32_t new_esp);
@@ -17,10 +25,11 @@ extern void set_cr3(uint32_t pd);
 extern uint32_t get_cr3();
 
 extern page_directory_t* vmm_create_address_space();
+extern page_directory_t* kernel_directory;
 extern void vmm_map_page_in_dir(page_directory_t* pd, void* phys, void* virt, int flags);
+extern void sys_close_all();
 
-process_t* current_process = 0;
-process_t* ready_queue = 0;
+process_t* ready_queue = 0;  // Circular list of all processes; runnable ones are also on sched.c's queues
 int next_pid = 1;
 
 typedef struct page_node {
@@ -29,6 +38,20 @@ typedef struct page_node {
     struct page_node* next;
 } page_node_t;
 
+// A main thread, leading a group of just itself
+static void thread_init_group(process_t* p) {
+    p->leader = p;
+    p->thread_count = 1;
+    p->thread_slots = 0;
+    p->thread_stacks = 0;
+    p->thread_slot = -1;
+    wait_queue_init(&p->group_wait);
+    p->group_exiting = 0;
+    p->group_exit_code = 0;
+    p->killed = 0;
+    p->wait_killable = 0;
+}
+
 void init_multitasking() {
     current_process = (process_t*)kmalloc(sizeof(process_t));
     current_process->pid = 0;
@@ -36,15 +59,44 @@ void init_multitasking() {
     current_process->cwd = fs_root;
     current_process->cr3 = get_cr3(); 
     current_process->allocated_pages = 0;
+    current_process->fpu_state = 0;
+    current_process->fpu_alloc = 0;
+    current_process->ring = 0;
+    current_process->image = 0;
+    current_process->lib_image = 0;
+    current_process->snapshot = 0;
+    current_process->parent = 0;
+    current_process->wait_queue = 0;
+    current_process->wait_next = current_process->wait_prev = 0;
+    current_process->wait_timer.pprev = 0;
+    wait_queue_init(&current_process->exit_wait);
+    wait_queue_init(&current_process->child_wait);
+    current_process->detached = 0;
+    thread_init_group(current_process);
+    sched_init_process(current_process, 0);
+    process_init_fds(current_process);
     
-    current_process->kernel_stack_ptr = kmalloc(4096);
+    current_process->kernel_stack_ptr = kmalloc(KERNEL_STACK_SIZE);
+    current_process->last_cpu = 0;
     
     ready_queue = current_process;
     current_process->next = current_process; 
+    this_cpu()->idle = process_create_idle(0);
+
+    // From here on we are a kernel thread like any other, and kernel
+    // threads hold the big kernel lock while they run
+    bkl_lock();
 
     term_print(" [SCHED] Multitasking Initialized.\n");
 }
 
+// Fresh descriptor table with 0/1/2 bound to the console
+void process_init_fds(process_t* proc) {
+    memset(proc->fd_table, 0, sizeof(proc->fd_table));
+    for (int i = 0; i < 3; i++)
+        proc->fd_table[i].type = FD_CONSOLE;
+}
+
 void process_track_page(process_t* proc, void* phys, void* virt) {
     if (!proc) return;
     page_node_t* node = (page_node_t*)kmalloc(sizeof(page_node_t));
@@ -54,40 +106,261 @@ void process_track_page(process_t* proc, void* phys, void* virt) {
     proc->allocated_pages = node;
 }
 
+// --- Object Pools ---
+// Short-lived processes would otherwise pay for a fresh page directory,
+// kernel stack and process_t on every spawn. Exited processes hand them
+// back here (see process_reap) and the next spawn takes them first.
+#define POOL_MAX 8
+
+static process_t* proc_pool = 0;          // Linked through ->next
+static int proc_pool_count = 0;
+static void* kstack_pool[POOL_MAX];
+static int kstack_pool_count = 0;
+static page_directory_t* pd_pool[POOL_MAX]; // User half already cleared
+static int pd_pool_count = 0;
+
+// Exited processes whose stack is still live, at most one per CPU: each
+// is freed by a later schedule() or process_exit() once its CPU has
+// switched away from it
+static process_t* pending_reap[SMP_MAX_CPUS];
+
+static process_t* proc_alloc() {
+    if (proc_pool) {
+        process_t* p = proc_pool;
+        proc_pool = p->next;
+        proc_pool_count--;
+        return p;
+    }
+    return (process_t*)kmalloc(sizeof(process_t));
+}
+
+static void proc_free(process_t* p) {
+    if (proc_pool_count < POOL_MAX) {
+        p->next = proc_pool;
+        proc_pool = p;
+        proc_pool_count++;
+    } else {
+        kfree(p);
+    }
+}
+
+static void* kstack_alloc() {
+    if (kstack_pool_count) return kstack_pool[--kstack_pool_count];
+    return kmalloc(KERNEL_STACK_SIZE);
+}
+
+static void kstack_free(void* stack) {
+    if (kstack_pool_count < POOL_MAX) kstack_pool[kstack_pool_count++] = stack;
+    else kfree(stack);
+}
+
+page_directory_t* process_alloc_address_space() {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    page_directory_t* pd = pd_pool_count ? pd_pool[--pd_pool_count] : 0;
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return pd ? pd : vmm_create_address_space();
+}
+
+static void pd_free(page_directory_t* pd) {
+    vmm_clear_user_space(pd);
+    if (pd_pool_count < POOL_MAX) pd_pool[pd_pool_count++] = pd;
+    else vmm_free_address_space(pd);
+}
+
+// For a loader that gave up before the directory was ever run
+void process_free_address_space(page_directory_t* pd) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    pd_free(pd);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+static void ready_queue_remove(process_t* p) {
+    process_t* prev = ready_queue;
+    while (prev->next != p) prev = prev->next;
+    prev->next = p->next;
+    if (ready_queue == p) ready_queue = p->next;
+}
+
+// Release what an exited process still holds. Must not run on its stack
+// or with its directory loaded. Interrupts are off.
+static void process_reap(process_t* p) {
+    page_node_t* node = p->allocated_pages;
+    while (node) {
+        page_node_t* next = node->next;
+        kfree(node);
+        node = next;
+    }
+    p->allocated_pages = 0;
+
+    // Threads borrow the leader's directory, which outlives them
+    if (p->cr3 != (uint32_t)kernel_directory && p->leader == p) pd_free((page_directory_t*)p->cr3);
+    p->cr3 = 0;
+    kstack_free(p->kernel_stack_ptr);
+    p->kernel_stack_ptr = 0;
+
+    // Nobody will wait for it: recycle the whole thing now
+    if (p->detached) {
+        ready_queue_remove(p);
+        proc_free(p);
+    }
+}
+
+// schedule() never leaves a dead directory loaded, so once its CPU has
+// switched away, nothing of it is in use
+static void process_reap_pending() {
+    for (int i = 0; i < SMP_MAX_CPUS; i++) {
+        process_t* p = pending_reap[i];
+        if (!p || p == cpus[i].current) continue;
+        process_reap(p);
+        pending_reap[i] = 0;
+    }
+}
+
+static int process_reap_is_pending(process_t* p) {
+    for (int i = 0; i < SMP_MAX_CPUS; i++)
+        if (pending_reap[i] == p) return 1;
+    return 0;
+}
+
 // UPDATED: Handles is_kernel flag
 int create_process(void (*entry_point)(), char* args, uint32_t initial_break, int is_kernel) {
-    process_t* new_proc = (process_t*)kmalloc(sizeof(process_t));
+    (void)args;
+    page_directory_t* pd = is_kernel ? 0 : process_alloc_address_space();
+    return create_process_in(pd, entry_point, 0, initial_break)->pid;
+}
+
+// Copy argv (NUL-terminated list in kernel memory; SYS_SPAWN copies it in
+// first) onto the new user stack page and return the initial user ESP:
+//   [esp] argc, [esp+4] argv, then the pointer array and the strings.
+static uint32_t setup_user_stack(uint8_t* stack_page, const char* const* argv) {
+    uint32_t page_va = USER_STACK_TOP - PAGE_SIZE;
+    uint32_t top = PAGE_SIZE;
+    uint32_t ptrs[MAX_ARGS];
+    int argc = 0;
+
+    for (; argv && argv[argc] && argc < MAX_ARGS; argc++) {
+        uint32_t len = strlen(argv[argc]) + 1;
+        if (len > MAX_ARG_BYTES || top < len + MAX_ARG_BYTES) break;
+        top -= len;
+        memcpy(stack_page + top, argv[argc], len);
+        ptrs[argc] = page_va + top;
+    }
+
+    top &= ~3;
+    uint32_t* sp = (uint32_t*)(stack_page + top);
+    *(--sp) = 0;                            // argv[argc] = NULL
+    for (int i = argc - 1; i >= 0; i--) *(--sp) = ptrs[i];
+    uint32_t argv_va = page_va + ((uint8_t*)sp - stack_page);
+    *(--sp) = argv_va;
+    *(--sp) = argc;
+    return page_va + ((uint8_t*)sp - stack_page);
+}
+
+// Allocate and initialise a process around pd (0: kernel thread). The
+// caller builds the IRET frame on its kernel stack, then process_start().
+static process_t* process_new(page_directory_t* pd, uint32_t initial_break) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    process_reap_pending();
+    process_t* new_proc = proc_alloc();
+    void* kstack = kstack_alloc();
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
     
-    new_proc->pid = next_pid++;
-    new_proc->parent_pid = current_process ? current_process->pid : 0;
+    // Whichever thread spawns it, the child belongs to the process
+    process_t* parent = current_process ? current_process->leader : 0;
+    new_proc->parent_pid = parent ? parent->pid : 0;
+    new_proc->parent = parent;
     new_proc->state = PROCESS_READY;
-    new_proc->cwd = current_process ? current_process->cwd : fs_root;
+    new_proc->wait_queue = 0;
+    new_proc->wait_next = new_proc->wait_prev = 0;
+    new_proc->wait_timer.pprev = 0;
+    wait_queue_init(&new_proc->exit_wait);
+    wait_queue_init(&new_proc->child_wait);
+    new_proc->exit_code = 0;
+    // Kernel threads (the shell) never wait, so their children clean up after themselves
+    new_proc->detached = parent && parent->cr3 == (uint32_t)kernel_directory;
+    new_proc->cwd = parent ? parent->cwd : fs_root;
     new_proc->program_break = initial_break;
     new_proc->allocated_pages = 0;
+    new_proc->fpu_state = 0;
+    new_proc->fpu_alloc = 0;
+    new_proc->ring = 0;
+    new_proc->image = 0;
+    new_proc->lib_image = 0;
+    new_proc->snapshot = 0;
+    thread_init_group(new_proc);
+    sched_init_process(new_proc, current_process);
+    process_init_fds(new_proc);
 
-    // 1. Setup Address Space
-    // Kernel threads share the kernel directory. User processes get a new one.
-    if (is_kernel) {
-        new_proc->cr3 = get_cr3(); // Reuse current kernel directory
-    } else {
-        page_directory_t* new_pd = vmm_create_address_space();
-        new_proc->cr3 = (uint32_t)new_pd;
-    }
+    // Kernel threads share the kernel directory. User processes get their own.
+    new_proc->cr3 = pd ? (uint32_t)pd : get_cr3();
+    new_proc->kernel_stack_ptr = kstack;
+    new_proc->bkl_depth = 1; // Held through the switch; jump_to_user drops it for user mode
+    return new_proc;
+}
+
+// Push the switch_task frame below the IRET frame at sp (popa order, gpr
+// may be 0 for all-zero registers).
+static void process_push_switch_frame(process_t* new_proc, uint32_t* sp, const registers_t* gpr) {
+    // B. The switch_task Frame
+    *(--sp) = (uint32_t)jump_to_user; // Return Address (trampoline)
+
+    *(--sp) = 0x202;    // EFLAGS
+    *(--sp) = 0x08;     // CS
+    *(--sp) = 0;        // Error Code
+
+    // Registers
+    *(--sp) = gpr ? gpr->eax : 0;
+    *(--sp) = gpr ? gpr->ecx : 0;
+    *(--sp) = gpr ? gpr->edx : 0;
+    *(--sp) = gpr ? gpr->ebx : 0;
+    *(--sp) = 0; // ESP (ignored by popa)
+    *(--sp) = gpr ? gpr->ebp : 0;
+    *(--sp) = gpr ? gpr->esi : 0;
+    *(--sp) = gpr ? gpr->edi : 0;
+
+    // Segments
+    *(--sp) = 0x10; // DS (Kernel Data)
+    *(--sp) = 0x10; // ES
+    *(--sp) = 0x10; // FS
+    *(--sp) = 0x10; // GS
 
-    // 2. Allocate Kernel Stack
-    new_proc->kernel_stack_ptr = kmalloc(4096);
-    uint32_t ks_top = (uint32_t)new_proc->kernel_stack_ptr + 4096;
-    uint32_t* sp = (uint32_t*)ks_top;
+    new_proc->esp = (uint32_t)sp;
+}
 
-    // 3. User Stack (Only for User Processes)
-    if (!is_kernel) {
+// Give the process a pid and make it runnable
+static void process_start(process_t* new_proc, uint32_t* sp, const registers_t* gpr) {
+    process_push_switch_frame(new_proc, sp, gpr);
+    
+    // Add to Ready Queue (right behind us, so no walk is needed)
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    new_proc->pid = next_pid++;
+    process_t* last = current_process ? current_process : ready_queue;
+    new_proc->next = last->next;
+    last->next = new_proc;
+    sched_enqueue(new_proc);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+// Build a process around an existing address space (pd = 0: kernel thread).
+// Used by the ELF loader, which fills the directory before we get here.
+process_t* create_process_in(page_directory_t* pd, void (*entry_point)(), const char* const* argv, uint32_t initial_break) {
+    process_t* new_proc = process_new(pd, initial_break);
+    uint32_t* sp = (uint32_t*)((uint32_t)new_proc->kernel_stack_ptr + KERNEL_STACK_SIZE);
+
+    // User Stack (Only for User Processes)
+    if (pd) {
         void* stack_phys = pmm_alloc_block();
         // Map User Stack (0x7 = User | RW)
-        vmm_map_page_in_dir((page_directory_t*)new_proc->cr3, stack_phys, (void*)(USER_STACK_TOP - 4096), 0x7);
+        vmm_map_page_in_dir(pd, stack_phys, (void*)(USER_STACK_TOP - 4096), 0x7);
+        uint32_t user_esp = setup_user_stack((uint8_t*)stack_phys, argv);
         
         // --- RING 3 IRET FRAME (5 Values) ---
         *(--sp) = 0x23;             // SS (User Data)
-        *(--sp) = USER_STACK_TOP;   // ESP (User Stack)
+        *(--sp) = user_esp;         // ESP (User Stack, argc/argv on top)
         *(--sp) = 0x202;            // EFLAGS (Interrupts Enabled)
         *(--sp) = 0x1B;             // CS (User Code)
         *(--sp) = (uint32_t)entry_point; // EIP
@@ -99,150 +372,323 @@ int create_process(void (*entry_point)(), char* args, uint32_t initial_break, in
         *(--sp) = (uint32_t)entry_point; // EIP
     }
 
-    // B. The switch_task Frame
-    *(--sp) = (uint32_t)jump_to_user; // Return Address (trampoline)
+    process_start(new_proc, sp, 0);
+    return new_proc;
+}
 
-    *(--sp) = 0x202;    // EFLAGS
-    *(--sp) = 0x08;     // CS
-    *(--sp) = 0;        // Error Code
+// Build a user process that resumes exactly at a saved trap frame, in an
+// address space the caller has already filled (snapshot restore).
+process_t* create_process_from_regs(page_directory_t* pd, const registers_t* regs, uint32_t initial_break) {
+    process_t* new_proc = process_new(pd, initial_break);
+    uint32_t* sp = (uint32_t*)((uint32_t)new_proc->kernel_stack_ptr + KERNEL_STACK_SIZE);
 
-    // Registers
-    *(--sp) = 0; // EDI
-    *(--sp) = 0; // ESI
-    *(--sp) = 0; // EBP
-    *(--sp) = 0; // ESP
-    *(--sp) = 0; // EBX
-    *(--sp) = 0; // EDX
-    *(--sp) = 0; // ECX
-    *(--sp) = 0; // EAX
+    // Selectors are forced: only the arithmetic flags and DF are kept
+    *(--sp) = 0x23;                                 // SS (User Data)
+    *(--sp) = regs->useresp;                        // ESP
+    *(--sp) = (regs->eflags & 0xCD5) | 0x202;       // EFLAGS (Interrupts Enabled)
+    *(--sp) = 0x1B;                                 // CS (User Code)
+    *(--sp) = regs->eip;                            // EIP
 
-    // Segments
-    *(--sp) = 0x10; // DS (Kernel Data)
-    *(--sp) = 0x10; // ES
-    *(--sp) = 0x10; // FS
-    *(--sp) = 0x10; // GS
+    process_start(new_proc, sp, regs);
+    return new_proc;
+}
 
-    new_proc->esp = (uint32_t)sp;
-    
-    // Add to Ready Queue
-    process_t* last = ready_queue;
-    while (last->next != ready_queue) last = last->next;
-    last->next = new_proc;
-    new_proc->next = ready_queue;
-    
-    return new_proc->pid;
+// Each CPU's idle task: halt until an interrupt, then look for work
+static void cpu_idle_loop() {
+    for (;;) {
+        __asm__ volatile("cli");
+        timer_idle(); // Returns with interrupts on
+        schedule();
+    }
+}
+
+// A kernel thread that is never queued: schedule() switches to it when
+// nothing on any run queue can run here
+process_t* process_create_idle(int cpu) {
+    process_t* idle = process_new(0, 0);
+    idle->pid = -1;
+    idle->detached = 1;
+    idle->cr3 = (uint32_t)kernel_directory;
+    idle->cpu = cpu;
+
+    uint32_t* sp = (uint32_t*)((uint32_t)idle->kernel_stack_ptr + KERNEL_STACK_SIZE);
+    *(--sp) = 0x202;                    // EFLAGS
+    *(--sp) = 0x08;                     // CS (Kernel Code)
+    *(--sp) = (uint32_t)cpu_idle_loop;  // EIP
+    process_push_switch_frame(idle, sp, 0);
+    return idle;
 }
 
 void schedule() {
     __asm__ volatile("cli");
     
-    if (!current_process) { __asm__ volatile("sti"); return; }
+    cpu_t* cpu = this_cpu();
+    process_t* prev_proc = cpu->current;
+    if (!prev_proc) { __asm__ volatile("sti"); return; }
+    process_reap_pending();
 
-    process_t* next_proc = current_process->next;
-    
-    while ((next_proc->state != PROCESS_READY) && next_proc != current_process) {
-        next_proc = next_proc->next;
-    }
+    // Preempted or yielding: back on our run queue
+    if (prev_proc != cpu->idle) sched_put_prev(prev_proc);
 
-    if (next_proc == current_process && next_proc->state != PROCESS_READY) {
+    process_t* next_proc = sched_pick();
+    if (!next_proc) next_proc = cpu->idle;
+    if (next_proc == prev_proc) {
         __asm__ volatile("sti");
-        __asm__ volatile("hlt"); 
         return;
     }
 
-    process_t* prev_proc = current_process;
-    current_process = next_proc;
+    cpu->current = next_proc;
     
-    if (current_process->cr3 != prev_proc->cr3) {
-        set_cr3(current_process->cr3);
+    // Also reload after a migration (our TLB may hold stale entries for
+    // it) and after an exit (the reaper may free the directory next)
+    if (next_proc->cr3 != get_cr3() || next_proc->last_cpu != cpu->id || prev_proc->state == PROCESS_ZOMBIE) {
+        set_cr3(next_proc->cr3);
     }
+    next_proc->last_cpu = cpu->id;
     
-    tss_set_stack(0x10, (uint32_t)current_process->kernel_stack_ptr + 4096);
-    switch_task(&(prev_proc->esp), current_process->esp);
+    tss_set_stack(0x10, (uint32_t)next_proc->kernel_stack_ptr + KERNEL_STACK_SIZE);
+    fpu_switch_to(prev_proc, next_proc);
+    prev_proc->bkl_depth = cpu->bkl_depth;
+    cpu->bkl_depth = next_proc->bkl_depth;
+    switch_task(&(prev_proc->esp), next_proc->esp);
     __asm__ volatile("sti");
 }
 
+// --- Threads ---
+
+// Free a zombie nobody else will look at again. Interrupts are off.
+static void process_free_zombie(process_t* p) {
+    for (int i = 0; i < SMP_MAX_CPUS; i++) {
+        if (pending_reap[i] != p) continue;
+        process_reap(p);
+        pending_reap[i] = 0;
+    }
+    ready_queue_remove(p);
+    proc_free(p);
+}
+
+// Every other live thread of leader's process exits at its next return to
+// user mode. Killable waits end now; a thread running user code on
+// another CPU is interrupted so that it notices.
+static void process_kill_group(process_t* leader, int code) {
+    if (!leader->group_exiting) {
+        leader->group_exiting = 1;
+        leader->group_exit_code = code;
+    }
+    process_t* it = ready_queue;
+    do {
+        if (it->leader == leader && it != current_process && it->state != PROCESS_ZOMBIE && !it->killed) {
+            it->killed = 1;
+            wait_kill(it);
+            for (int i = 0; i < cpu_count; i++)
+                if (cpus[i].current == it) smp_send_resched(i);
+        }
+        it = it->next;
+    } while (it != ready_queue);
+}
+
+// A new thread of the caller's process, entering user mode at 'entry' with
+// a fresh stack holding (return address 0, arg0, arg1)
+int thread_create(uint32_t entry, uint32_t arg0, uint32_t arg1) {
+    process_t* leader = current_process->leader;
+    if (leader->cr3 == (uint32_t)kernel_directory || leader->group_exiting) return -1;
+
+    int slot = 0;
+    while (slot < THREAD_MAX && (leader->thread_slots & (1u << slot))) slot++;
+    if (slot == THREAD_MAX) return -1;
+
+    // We run in the process's address space, so the stack can be filled in place
+    uint32_t top = THREAD_STACK_TOP(slot);
+    if (!(leader->thread_stacks & (1u << slot))) {
+        for (uint32_t va = top - THREAD_STACK_SIZE; va < top; va += PAGE_SIZE) {
+            void* phys = pmm_alloc_block();
+            if (!phys) return -1; // Pages mapped so far stay tracked by the leader
+            memset(phys, 0, PAGE_SIZE);
+            vmm_map_page_in_dir((page_directory_t*)leader->cr3, phys, (void*)va, 0x7);
+            process_track_page(leader, phys, (void*)va);
+        }
+        leader->thread_stacks |= 1u << slot;
+    }
+    uint32_t* user_sp = (uint32_t*)top;
+    *(--user_sp) = arg1;
+    *(--user_sp) = arg0;
+    *(--user_sp) = 0;                   // Returning from entry faults: use thread_exit()
+
+    process_t* t = process_new((page_directory_t*)leader->cr3, 0);
+    t->leader = leader;
+    t->thread_slot = slot;
+    t->detached = 0;                    // Until joined, or the process exits
+    leader->thread_slots |= 1u << slot;
+    leader->thread_count++;
+
+    uint32_t* sp = (uint32_t*)((uint32_t)t->kernel_stack_ptr + KERNEL_STACK_SIZE);
+    *(--sp) = 0x23;                     // SS (User Data)
+    *(--sp) = (uint32_t)user_sp;        // ESP
+    *(--sp) = 0x202;                    // EFLAGS (Interrupts Enabled)
+    *(--sp) = 0x1B;                     // CS (User Code)
+    *(--sp) = entry;                    // EIP
+    process_start(t, sp, 0);
+    return t->pid;
+}
+
+// The calling thread (not the leader) ends. Its slot is free at once; the
+// process_t waits as a zombie for thread_join() or the process's exit.
+static void thread_exit_self(int code) {
+    process_t* me = current_process;
+    process_t* leader = me->leader;
+
+    fpu_release(me);
+    sched_exit(me);
+    process_reap_pending();
+    pending_reap[this_cpu()->id] = me;
+
+    leader->thread_slots &= ~(1u << me->thread_slot);
+    leader->thread_count--;
+    me->state = PROCESS_ZOMBIE;
+    me->exit_code = code;
+    wait_queue_wake_all(&me->exit_wait);
+    wait_queue_wake_all(&leader->group_wait);
+
+    schedule();
+}
+
+void thread_exit(int code) {
+    __asm__ volatile("cli");
+    if (current_process->leader == current_process) process_exit(code);
+    else thread_exit_self(code);
+}
+
+int thread_join(int tid, int* status) {
+    __asm__ volatile("cli");
+    while (1) {
+        // Looked up again after every wait: another joiner may have freed it
+        process_t* t = 0;
+        process_t* it = ready_queue;
+        do {
+            if (it->pid == tid) t = it;
+            it = it->next;
+        } while (!t && it != ready_queue);
+
+        if (!t || t == current_process || t->leader == t || t->leader != current_process->leader || t->detached) {
+            __asm__ volatile("sti");
+            return -1;
+        }
+        if (t->state == PROCESS_ZOMBIE) {
+            if (status) *status = t->exit_code;
+            process_free_zombie(t);
+            __asm__ volatile("sti");
+            return 0;
+        }
+        if (wait_queue_wait_killable(&t->exit_wait, 0) == WAIT_KILLED) {
+            __asm__ volatile("sti");
+            return -1;
+        }
+    }
+}
+
+void process_exit_if_killed(const registers_t* regs) {
+    process_t* p = current_process;
+    if (p && p->killed && (regs->cs & 3) == 3) thread_exit(p->leader->group_exit_code);
+}
+
+// --- Exit and Wait ---
+
 void process_exit(int code) {
     __asm__ volatile("cli");
     
     // Prevent killing init (pid 0) or shell (pid 1) carelessly for now
-    if (current_process->pid <= 1) { 
+    if (current_process->leader->pid <= 1) { 
         __asm__ volatile("sti"); 
         return;
     } 
 
-    kfree(current_process->kernel_stack_ptr);
-    
-    // FIX: Free the address space!
-    // We can't free the CURRENT directory while we are using it.
-    // However, since we are becoming a ZOMBIE, we will switch away shortly.
-    // Real OSs free this in the reaper/wait function.
-    // For simplicity in this OS: We mark it, and the PARENT or SCHEDULER should free it.
-    // BUT, since we don't have a complex reaper, let's free the USER PAGES now, 
-    // but keep the directory struct until the task is fully removed from queue.
+    // exit() in any thread ends them all. The leader goes last: the
+    // others run in its address space until they are gone.
+    process_t* leader = current_process->leader;
+    if (leader->thread_count > 1 || leader != current_process) process_kill_group(leader, code);
+    if (leader != current_process) thread_exit_self(code);
+    while (current_process->thread_count > 1)
+        wait_queue_wait(&current_process->group_wait, WAIT_FOREVER);
+    if (current_process->group_exiting) code = current_process->group_exit_code;
+
+    sys_close_all();
+    fpu_release(current_process);
+    sched_exit(current_process);
+    tty_release(current_process->pid);
+    elf_image_put(current_process->image);
+    elf_image_put(current_process->lib_image);
+    snapshot_image_put(current_process->snapshot);
+    current_process->image = 0;
+    current_process->lib_image = 0;
+    current_process->snapshot = 0;
     
-    // Actually, safest approach for this OS structure:
-    // Only free if we are not sharing the kernel directory (is_kernel checks)
-    if (current_process->cr3 != get_cr3()) { 
-         // If we are running on this CR3, we must be careful. 
-         // Usually, we switch to kernel_cr3 before dying.
-         // Let's assume the Scheduler handles the CR3 switch.
-         
-         // Helper: We simply flag it. The actual free should happen when the parent waits.
-         // But to stop the leak NOW without complex logic:
-         vmm_free_address_space((page_directory_t*)current_process->cr3);
+    // Our kernel stack and directory are still in use: the next schedule()
+    // (running on another process) hands them back to the pools.
+    process_reap_pending();
+    pending_reap[this_cpu()->id] = current_process;
+
+    // Orphans are never waited for
+    process_t* it = current_process->next;
+    while (it != current_process) {
+        process_t* next = it->next;
+        if (it->parent_pid == current_process->pid) {
+            it->detached = 1;
+            if (it->state == PROCESS_ZOMBIE && !process_reap_is_pending(it)) {
+                ready_queue_remove(it);
+                proc_free(it);
+            }
+        }
+        it = next;
     }
     
     current_process->state = PROCESS_ZOMBIE;
     current_process->exit_code = code;
     
-    process_unblock(current_process->pid); 
+    wait_queue_wake_all(&current_process->exit_wait);
+    if (!current_process->detached && current_process->parent)
+        wait_queue_wake_all(&current_process->parent->child_wait);
     
     schedule();
 }
 
-void process_block(int reason) {
-    current_process->state = PROCESS_BLOCKED;
-    current_process->wait_reason = reason;
-    schedule();
-}
-
-void process_unblock(int reason) {
-    process_t* node = ready_queue;
-    do {
-        if (node->state == PROCESS_BLOCKED && node->wait_reason == reason) {
-            node->state = PROCESS_READY;
-            node->wait_reason = 0;
-            return; 
-        }
-        node = node->next;
-    } while (node != ready_queue);
+int process_wait(int pid, int* status_ptr) {
+    return process_wait_timeout(pid, status_ptr, WAIT_FOREVER);
 }
 
-int process_wait(int pid, int* status_ptr) {
+// As process_wait(), but gives up with 0 once timeout_ns have passed
+int process_wait_timeout(int pid, int* status_ptr, uint64_t timeout_ns) {
+    uint64_t deadline = timeout_ns == WAIT_FOREVER ? 0 : clock_now_ns() + timeout_ns;
+    __asm__ volatile("cli");
     while(1) {
+        // Prefer a child that has already exited
         process_t* child = 0;
         process_t* it = ready_queue;
         do {
-            if (it->pid == pid || (pid == -1 && it->parent_pid == current_process->pid)) {
-                child = it;
-                break;
+            if (it != current_process && !it->detached && it->leader == it &&
+                (it->pid == pid || (pid == -1 && it->parent_pid == current_process->leader->pid))) {
+                if (!child || it->state == PROCESS_ZOMBIE) child = it;
+                if (child->state == PROCESS_ZOMBIE) break;
             }
             it = it->next;
         } while (it != ready_queue);
         
-        if (!child) return -1; 
+        if (!child) { __asm__ volatile("sti"); return -1; }
         
         if (child->state == PROCESS_ZOMBIE) {
             if (status_ptr) *status_ptr = child->exit_code;
+            int child_pid = child->pid;
+
+            // Free anything it still holds, then the process itself
+            process_free_zombie(child);
             
-            process_t* prev = ready_queue;
-            while (prev->next != child) prev = prev->next;
-            prev->next = child->next;
-            if (ready_queue == child) ready_queue = child->next;
-            
-            return child->pid;
+            __asm__ volatile("sti");
+            return child_pid;
+        }
+        wait_queue_t* wq = pid == -1 ? &current_process->leader->child_wait : &child->exit_wait;
+        int woken = wait_queue_wait_killable(wq, deadline);
+        if (woken != WAIT_WOKEN) {
+            __asm__ volatile("sti");
+            return woken == WAIT_TIMEOUT ? 0 : -1;
         }
-        process_block(child->pid); 
     }
-}
\ No newline at end of file
+}
@@ -4,6 +4,10 @@
 
 #include <stdint.h>
 #include "../mm/vmm.h" 
+#include "../cpu/idt.h" // For registers_t
+#include "../cpu/smp.h" // For current_process
+#include "wait.h"
+#include "timer.h"
 
 #define MAX_OPEN_FILES 16
 
@@ -15,33 +19,134 @@
 // Constants
 #define USER_STACK_TOP  0xBFFFF000 
 #define USER_STACK_SIZE 0x4000     
+#define KERNEL_STACK_SIZE 4096
+
+// Threads get user stacks in fixed slots below the main one, mapped on
+// first use and kept for the next thread in the slot
+#define THREAD_MAX          16
+#define THREAD_STACK_SIZE   0x4000
+#define THREAD_STACK_STRIDE 0x10000 // Unmapped gap between stacks as a guard
+#define THREAD_STACK_TOP(slot) (USER_STACK_TOP - USER_STACK_SIZE - (slot) * THREAD_STACK_STRIDE)
+
+// Program arguments copied onto the new user stack
+#define MAX_ARGS      16
+#define MAX_ARG_BYTES 256
 
 struct file_node;
 
+// File Descriptor Types
+#define FD_NONE       0
+#define FD_FILE       1
+#define FD_CONSOLE    2 // Reads the keyboard, writes the terminal
+#define FD_PIPE_READ  3 // pipe.c
+#define FD_PIPE_WRITE 4
+#define FD_TIMER      5 // timerfd.c
+#define FD_EPOLL      6 // epoll.c
+
+// Descriptor flags
+#define FD_NONBLOCK 0x1 // Reads and writes return FD_WOULD_BLOCK instead of sleeping
+
+// fcntl() commands
+#define F_GETFL 3
+#define F_SETFL 4
+
+#define FD_WOULD_BLOCK (-2)
+
 typedef struct {
     struct file_node* file_node; 
+    void* object;    // FD_PIPE_*, FD_TIMER, FD_EPOLL: the kernel object behind it
     int offset;
-    int flags;       
+    int flags;       // FD_NONBLOCK
+    int type;        // FD_*
+    struct file_node* dir_next; // getdents: child to return next (valid while offset == dir_index)
+    int dir_index;
 } file_descriptor_t;
 
+// Vectored I/O segment (readv/writev)
+#define IOV_MAX 64
+
+struct iovec {
+    void* base;
+    uint32_t len;
+};
+
+// One flow of control. A process is a thread group: the main thread (the
+// leader) owns everything the threads share - cr3, cwd, fd_table, the
+// program break, tracked pages, the ring and the images - and the other
+// threads reach it through ->leader, leaving their own copies unused.
+// Each thread has its own pid (the thread id), kernel stack, user stack,
+// FPU state and scheduling state.
 typedef struct process {
     int pid;
     int parent_pid;
     int state;
-    int wait_reason;
+    struct process* parent;   // Valid while !detached
+
+    // Blocked in wait_queue_wait() (wait.c)
+    wait_queue_t* wait_queue; // 0 for a plain sleep
+    struct process* wait_next;
+    struct process* wait_prev;
+    timer_event_t wait_timer; // Armed while the wait has a deadline
+    int wait_result;          // WAIT_WOKEN / WAIT_TIMEOUT
+    uint32_t wait_key;        // Tells apart waiters sharing a queue (futex.c)
+
+    wait_queue_t exit_wait;   // wait(pid) callers
+    wait_queue_t child_wait;  // wait(-1) callers: any child exits
     int exit_code;
+    int detached;             // No parent will wait: recycle as soon as we exit
     
     uint32_t esp;             
     uint32_t cr3;             
     void* kernel_stack_ptr;   
+    int bkl_depth;            // Big kernel lock nesting while switched out (smp.h)
     
     uint32_t program_break;   
     struct page_node* allocated_pages; 
+
+    void* fpu_state;          // 16-byte aligned FXSAVE area, allocated on first FPU use
+    void* fpu_alloc;          // Raw kmalloc pointer backing fpu_state
     
     struct file_node* cwd;
     file_descriptor_t fd_table[MAX_OPEN_FILES];
 
-    struct process *next;
+    struct io_ring* ring;     // Registered submission/completion ring (user memory)
+    struct elf_image* image;  // Shared read-only segments we map (elf.c), 0 if none
+    struct elf_image* lib_image; // Same for the shared library, 0 if statically linked
+    struct snapshot_image* snapshot; // Copy-on-write frames we were restored from (snapshot.c)
+
+    // Scheduling (sched.c)
+    int sched_class;          // SCHED_NORMAL / FIFO / DEADLINE
+    int nice;                 // SCHED_NICE_MIN..MAX, inherited from the parent
+    int sched_penalty;        // Levels lost to full slices, regained by blocking
+    int sched_level;          // Run queue we go on when READY
+    int slice_left;           // Ticks before we are preempted
+    int rt_priority;          // SCHED_FIFO: 0..SCHED_RT_LEVELS-1, higher first
+    uint64_t dl_period;       // SCHED_DEADLINE, all in ns
+    uint64_t dl_budget;
+    uint64_t dl_deadline;     // Absolute end of the current period
+    uint64_t dl_remaining;    // Budget left in it
+    uint64_t dl_replenish_at; // While throttled
+    uint32_t dl_util;         // Reserved per mille
+    int dl_throttled;
+    uint64_t run_start;       // When we were last picked
+    int queued;               // On a run queue
+    struct process* run_next;
+    int cpu;                  // Whose run queue we go on (where we run, while running)
+    int last_cpu;             // Where we last ran, -1 if never
+
+    // Threads
+    struct process* leader;   // Owner of the shared state; ourselves in the main thread
+    int thread_count;         // Leader: live threads, itself included
+    uint32_t thread_slots;    // Leader: user stack slots in use (bit per slot)
+    uint32_t thread_stacks;   // Leader: slots whose stack is mapped
+    int thread_slot;          // Our user stack slot, -1 in the main thread
+    wait_queue_t group_wait;  // Leader: waits here for the others to exit
+    int group_exiting;        // Leader: some thread called exit()
+    int group_exit_code;
+    int killed;               // Exit at the next return to user mode
+    int wait_killable;        // Blocked in wait_queue_wait_killable()
+
+    struct process *next;     // Every process, in any state (ready_queue)
 } process_t;
 
 // API
@@ -49,12 +154,21 @@ void init_multitasking();
 
 // NEW: Added 'is_kernel' parameter
 int create_process(void (*entry_point)(), char* args, uint32_t initial_break, int is_kernel);
+process_t* create_process_in(page_directory_t* pd, void (*entry_point)(), const char* const* argv, uint32_t initial_break);
+process_t* create_process_from_regs(page_directory_t* pd, const registers_t* regs, uint32_t initial_break);
+process_t* process_create_idle(int cpu);
+page_directory_t* process_alloc_address_space(); // Pooled; vmm_create_address_space() otherwise
+void process_free_address_space(page_directory_t* pd);
 
-void process_exit(int code);
+void process_init_fds(process_t* proc);
+void process_exit(int code);                    // From any thread: the whole process
+void process_exit_if_killed(const registers_t* regs); // On every way back to user mode
+int thread_create(uint32_t entry, uint32_t arg0, uint32_t arg1); // Returns the thread id or -1
+void thread_exit(int code);                     // From the main thread: process_exit()
+int thread_join(int tid, int* status);          // 0, or -1 if not a joinable thread of ours
 void schedule();
-void process_block(int reason);
-void process_unblock(int reason);
 int process_wait(int pid, int* status);
+int process_wait_timeout(int pid, int* status, uint64_t timeout_ns); // 0 on timeout
 void process_track_page(process_t* proc, void* phys, void* virt);
 
 #endif
\ No newline at end of file
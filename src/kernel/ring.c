@@ -0,0 +1,127 @@
+/* src/kernel/ring.c */
+#include "ring.h"
+#include "process.h"
+
+extern int is_valid_user_ptr(void* ptr, int size);
+extern void term_print(const char* str);
+extern int sys_open(const char* name);
+extern void sys_close(int fd);
+extern int sys_seek(int fd, int offset, int whence);
+extern int sys_pread(int fd, char* buf, int size, int offset);
+extern int sys_pwrite(int fd, char* buf, int size, int offset);
+
+static int is_pow2(uint32_t n) {
+    return n && !(n & (n - 1));
+}
+
+// Register a ring for the current process. The header and both arrays
+// must live in user memory; we re-check the header on every entry since
+// the process can scribble on it.
+int ring_setup(io_ring_t* ring) {
+    if (!is_valid_user_ptr(ring, sizeof(io_ring_t))) return -1;
+    if (!is_pow2(ring->sq_entries) || ring->sq_entries > RING_MAX_ENTRIES) return -1;
+    if (!is_pow2(ring->cq_entries) || ring->cq_entries > RING_MAX_ENTRIES) return -1;
+    if (!is_valid_user_ptr(ring->sqes, ring->sq_entries * sizeof(ring_sqe_t))) return -1;
+    if (!is_valid_user_ptr(ring->cqes, ring->cq_entries * sizeof(ring_cqe_t))) return -1;
+
+    ring->sq_head = 0;
+    ring->cq_tail = 0;
+    current_process->leader->ring = ring;
+    return 0;
+}
+
+static int ring_exec(ring_sqe_t* sqe) {
+    switch (sqe->opcode) {
+        case RING_OP_NOP:
+            return 0;
+
+        case RING_OP_OPEN:
+            if (!is_valid_user_ptr((void*)sqe->addr, 1)) return -1;
+            return sys_open((const char*)sqe->addr);
+
+        case RING_OP_READ:
+            if (!is_valid_user_ptr((void*)sqe->addr, sqe->len)) return -1;
+            return sys_pread(sqe->fd, (char*)sqe->addr, sqe->len, sqe->off);
+
+        case RING_OP_WRITE:
+            if (!is_valid_user_ptr((void*)sqe->addr, sqe->len)) return -1;
+            return sys_pwrite(sqe->fd, (char*)sqe->addr, sqe->len, sqe->off);
+
+        case RING_OP_SEEK:
+            return sys_seek(sqe->fd, sqe->off, (int)sqe->len);
+
+        case RING_OP_CLOSE:
+            sys_close(sqe->fd);
+            return 0;
+
+        case RING_OP_PRINT:
+            if (!is_valid_user_ptr((void*)sqe->addr, 1)) return -1;
+            term_print((const char*)sqe->addr);
+            return 0;
+    }
+    return -1;
+}
+
+// OPEN, READ and WRITE may sleep: on the file tree lock, or in a TTY or
+// pipe read or write. The timer interrupt must not.
+static int ring_op_may_sleep(uint8_t opcode) {
+    return opcode == RING_OP_OPEN || opcode == RING_OP_READ || opcode == RING_OP_WRITE;
+}
+
+// Consume up to 'budget' SQEs (0 = all pending). Stops early when the CQ is
+// full so no completion is ever dropped, and with 'polled' at the first op
+// that may sleep, which keeps its place for ring_enter(). Returns SQEs
+// consumed.
+static int ring_drain(io_ring_t* ring, uint32_t budget, int polled) {
+    uint32_t sq_mask = ring->sq_entries - 1;
+    uint32_t cq_mask = ring->cq_entries - 1;
+    uint32_t head = ring->sq_head;
+    uint32_t tail = ring->sq_tail;
+    uint32_t cq_tail = ring->cq_tail;
+    int done = 0;
+
+    while (head != tail) {
+        if (budget && (uint32_t)done == budget) break;
+        if (cq_tail - ring->cq_head >= ring->cq_entries) break; // CQ full
+
+        // Copy out first: the process may rewrite the slot once sq_head moves
+        ring_sqe_t sqe = ring->sqes[head & sq_mask];
+        if (polled && ring_op_may_sleep(sqe.opcode)) break;
+        head++;
+
+        ring_cqe_t* cqe = &ring->cqes[cq_tail & cq_mask];
+        cqe->user_data = sqe.user_data;
+        cqe->res = ring_exec(&sqe);
+        cq_tail++;
+        done++;
+    }
+
+    ring->sq_head = head;
+    ring->cq_tail = cq_tail;
+    return done;
+}
+
+static int ring_header_ok(io_ring_t* ring) {
+    return is_pow2(ring->sq_entries) && ring->sq_entries <= RING_MAX_ENTRIES &&
+           is_pow2(ring->cq_entries) && ring->cq_entries <= RING_MAX_ENTRIES &&
+           is_valid_user_ptr(ring->sqes, ring->sq_entries * sizeof(ring_sqe_t)) &&
+           is_valid_user_ptr(ring->cqes, ring->cq_entries * sizeof(ring_cqe_t));
+}
+
+int ring_enter(uint32_t to_submit) {
+    io_ring_t* ring = current_process->leader->ring;
+    if (!ring || !ring_header_ok(ring)) return -1;
+    return ring_drain(ring, to_submit, 0);
+}
+
+// Timer-tick hook for RING_SETUP_POLL rings: lets a process keep queueing
+// non-blocking work without ever entering the kernel. Only called when the
+// tick interrupted user mode, so we are in the owner's address space and
+// not in the middle of one of its syscalls. We are still in an interrupt
+// handler, so ops that may sleep are left for ring_enter().
+void ring_poll(process_t* proc) {
+    io_ring_t* ring = proc->leader->ring;
+    if (!ring || !(ring->flags & RING_SETUP_POLL)) return;
+    if (ring->sq_head == ring->sq_tail || !ring_header_ok(ring)) return;
+    ring_drain(ring, RING_POLL_BUDGET, 1);
+}
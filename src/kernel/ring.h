@@ -0,0 +1,61 @@
+/* src/kernel/ring.h */
+#ifndef RING_H
+#define RING_H
+
+#include <stdint.h>
+
+// Batched asynchronous syscalls (io_uring-style).
+// The process owns the memory; the kernel reads SQEs and writes CQEs in
+// place while running in that process's address space.
+// NOTE: Layout is mirrored in programs/stdlib.h - keep them in sync.
+
+#define RING_OP_NOP   0
+#define RING_OP_OPEN  1  // addr = path                   -> res = fd
+#define RING_OP_READ  2  // fd, addr, len, off            -> res = bytes
+#define RING_OP_WRITE 3  // fd, addr, len, off            -> res = bytes
+#define RING_OP_SEEK  4  // fd, off, len = whence         -> res = new offset
+#define RING_OP_CLOSE 5  // fd                            -> res = 0
+#define RING_OP_PRINT 6  // addr = NUL-terminated string  -> res = 0
+
+#define RING_OFF_CURRENT (-1) // READ/WRITE at (and advance) the fd offset
+
+#define RING_SETUP_POLL 0x1   // Kernel also drains the SQ on timer ticks, up to the first OPEN/READ/WRITE
+#define RING_MAX_ENTRIES 4096
+#define RING_POLL_BUDGET 32   // SQEs drained per timer tick
+
+typedef struct {
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t reserved;
+    int32_t fd;
+    uint32_t addr;
+    uint32_t len;
+    int32_t off;
+    uint32_t user_data;
+} ring_sqe_t;
+
+typedef struct {
+    uint32_t user_data;
+    int32_t res;
+} ring_cqe_t;
+
+typedef struct io_ring {
+    volatile uint32_t sq_head;  // Consumer: kernel
+    volatile uint32_t sq_tail;  // Producer: user
+    volatile uint32_t cq_head;  // Consumer: user
+    volatile uint32_t cq_tail;  // Producer: kernel
+    uint32_t sq_entries;        // Power of two
+    uint32_t cq_entries;        // Power of two
+    uint32_t flags;             // RING_SETUP_*
+    uint32_t sq_local_tail;     // User-private: SQEs handed out but not yet published
+    ring_sqe_t* sqes;
+    ring_cqe_t* cqes;
+} io_ring_t;
+
+struct process;
+
+int ring_setup(io_ring_t* ring);
+int ring_enter(uint32_t to_submit);
+void ring_poll(struct process* proc);
+
+#endif
@@ -0,0 +1,476 @@
+/* src/kernel/sched.c */
+#include "sched.h"
+#include "process.h"
+#include "clock.h"
+
+extern process_t* ready_queue;
+extern uint64_t div_u64(uint64_t n, uint32_t d, uint32_t* rem);
+
+// One per CPU. Everything here is under the big kernel lock.
+typedef struct {
+    // SCHED_NORMAL: one FIFO per level, linked through ->run_next
+    process_t* run_head[SCHED_LEVELS];
+    process_t* run_tail[SCHED_LEVELS];
+    uint32_t run_bitmap;            // Bit n set: level n is non-empty
+
+    // SCHED_FIFO: same again, indexed by SCHED_RT_LEVELS - 1 - priority
+    process_t* rt_head[SCHED_RT_LEVELS];
+    process_t* rt_tail[SCHED_RT_LEVELS];
+    uint32_t rt_bitmap;
+
+    // SCHED_DEADLINE: sorted by absolute deadline
+    process_t* dl_head;
+
+    int nr_queued;
+    int need_resched;
+} runqueue_t;
+
+static runqueue_t runqueues[SMP_MAX_CPUS];
+
+// Throttled deadline tasks wait off-queue for dl_replenish_at
+static process_t* dl_throttled = 0;
+static uint32_t dl_util = 0;        // Per mille reserved
+
+static uint64_t next_boost = 0;
+
+// --- Levels ---
+
+static int sched_level_of(process_t* p) {
+    int level = ((p->nice - SCHED_NICE_MIN) >> SCHED_NICE_SHIFT) + p->sched_penalty;
+    return level < SCHED_LEVELS ? level : SCHED_LEVELS - 1;
+}
+
+// Lower levels run less often, so they get longer slices: 1..4 ticks
+static void sched_refill(process_t* p) {
+    p->sched_level = sched_level_of(p);
+    p->slice_left = 1 + p->sched_level / 8;
+}
+
+// --- CPUs ---
+
+static int sched_running(process_t* p) {
+    return cpus[p->cpu].current == p;
+}
+
+static int sched_cpu_idle(int cpu) {
+    return cpus[cpu].online && cpus[cpu].current == cpus[cpu].idle;
+}
+
+static int sched_load(int cpu) {
+    return runqueues[cpu].nr_queued + !sched_cpu_idle(cpu);
+}
+
+// Least loaded CPU, for a process that has not run yet
+static int sched_select_cpu() {
+    int best = this_cpu()->id;
+    for (int i = 0; i < SMP_MAX_CPUS; i++)
+        if (cpus[i].online && sched_load(i) < sched_load(best)) best = i;
+    return best;
+}
+
+static void sched_resched_cpu(int cpu) {
+    runqueues[cpu].need_resched = 1;
+    smp_send_resched(cpu);  // Not needed for our own CPU
+}
+
+// Would a, made READY, preempt b?
+static int sched_outranks(process_t* a, process_t* b) {
+    if (a->sched_class != b->sched_class) return a->sched_class > b->sched_class;
+    if (a->sched_class == SCHED_DEADLINE) return a->dl_deadline < b->dl_deadline;
+    if (a->sched_class == SCHED_FIFO) return a->rt_priority > b->rt_priority;
+    return a->sched_level < b->sched_level;
+}
+
+void sched_init_process(process_t* p, process_t* parent) {
+    p->nice = parent ? parent->nice : 0;
+    p->sched_class = SCHED_NORMAL;
+    p->sched_penalty = 0;
+    p->rt_priority = 0;
+    p->dl_period = p->dl_budget = 0;
+    p->dl_deadline = p->dl_remaining = p->dl_replenish_at = 0;
+    p->dl_util = 0;
+    p->dl_throttled = 0;
+    p->run_start = 0;
+    p->queued = 0;
+    p->run_next = 0;
+    p->cpu = sched_select_cpu();
+    p->last_cpu = -1;
+    sched_refill(p);
+}
+
+// --- Run Queues ---
+
+static void fifo_push(process_t** head, process_t** tail, uint32_t* bitmap, int idx, process_t* p, int at_head) {
+    if (at_head) {
+        p->run_next = head[idx];
+        head[idx] = p;
+        if (!tail[idx]) tail[idx] = p;
+    } else {
+        p->run_next = 0;
+        if (tail[idx]) tail[idx]->run_next = p;
+        else head[idx] = p;
+        tail[idx] = p;
+    }
+    *bitmap |= 1u << idx;
+}
+
+static void fifo_remove(process_t** head, process_t** tail, uint32_t* bitmap, int idx, process_t* p) {
+    process_t* prev = 0;
+    process_t* it = head[idx];
+    while (it && it != p) { prev = it; it = it->run_next; }
+    if (!it) return;
+
+    if (prev) prev->run_next = p->run_next;
+    else head[idx] = p->run_next;
+    if (tail[idx] == p) tail[idx] = prev;
+    if (!head[idx]) *bitmap &= ~(1u << idx);
+}
+
+static process_t* fifo_pop(process_t** head, process_t** tail, uint32_t* bitmap) {
+    int idx = __builtin_ctz(*bitmap);
+    process_t* p = head[idx];
+    head[idx] = p->run_next;
+    if (!head[idx]) {
+        tail[idx] = 0;
+        *bitmap &= ~(1u << idx);
+    }
+    return p;
+}
+
+static void list_remove(process_t** head, process_t* p) {
+    while (*head && *head != p) head = &(*head)->run_next;
+    if (*head) *head = p->run_next;
+}
+
+// p was just queued: preempt its CPU if p outranks what runs there, wake
+// that CPU if it idles, and if it stays busy wake some idle CPU to steal p
+static void sched_kick(process_t* p) {
+    process_t* cur = cpus[p->cpu].current;
+    if (!cur || cur == p) return;
+    if (sched_cpu_idle(p->cpu) || (cur->state == PROCESS_READY && sched_outranks(p, cur))) {
+        sched_resched_cpu(p->cpu);
+        return;
+    }
+    // A current process that blocked is about to schedule() anyway
+    if (cur->state != PROCESS_READY) return;
+    for (int i = 0; i < SMP_MAX_CPUS; i++) {
+        if (sched_cpu_idle(i)) {
+            sched_resched_cpu(i);
+            return;
+        }
+    }
+}
+
+void sched_enqueue(process_t* p) {
+    if (p->queued || p->dl_throttled) return;
+    runqueue_t* rq = &runqueues[p->cpu];
+
+    if (p->sched_class == SCHED_DEADLINE) {
+        process_t** link = &rq->dl_head;
+        while (*link && (*link)->dl_deadline <= p->dl_deadline) link = &(*link)->run_next;
+        p->run_next = *link;
+        *link = p;
+    } else if (p->sched_class == SCHED_FIFO) {
+        // A FIFO task that was preempted keeps its place at the front
+        int preempted = sched_running(p) && rq->need_resched;
+        fifo_push(rq->rt_head, rq->rt_tail, &rq->rt_bitmap, SCHED_RT_LEVELS - 1 - p->rt_priority, p, preempted);
+    } else {
+        fifo_push(rq->run_head, rq->run_tail, &rq->run_bitmap, p->sched_level, p, 0);
+    }
+    p->queued = 1;
+    rq->nr_queued++;
+    sched_kick(p);
+}
+
+static void sched_dequeue(process_t* p) {
+    if (!p->queued) return;
+    runqueue_t* rq = &runqueues[p->cpu];
+    if (p->sched_class == SCHED_DEADLINE)
+        list_remove(&rq->dl_head, p);
+    else if (p->sched_class == SCHED_FIFO)
+        fifo_remove(rq->rt_head, rq->rt_tail, &rq->rt_bitmap, SCHED_RT_LEVELS - 1 - p->rt_priority, p);
+    else
+        fifo_remove(rq->run_head, rq->run_tail, &rq->run_bitmap, p->sched_level, p);
+    p->run_next = 0;
+    p->queued = 0;
+    rq->nr_queued--;
+}
+
+static process_t* rq_pop(runqueue_t* rq) {
+    process_t* p;
+    if (rq->dl_head) {
+        p = rq->dl_head;
+        rq->dl_head = p->run_next;
+    } else if (rq->rt_bitmap) {
+        p = fifo_pop(rq->rt_head, rq->rt_tail, &rq->rt_bitmap);
+    } else if (rq->run_bitmap) {
+        p = fifo_pop(rq->run_head, rq->run_tail, &rq->run_bitmap);
+    } else {
+        return 0;
+    }
+    p->run_next = 0;
+    p->queued = 0;
+    rq->nr_queued--;
+    return p;
+}
+
+// Work stealing: pull the best process off the busiest queue when it is
+// at least two longer than ours, or when ours is empty. Queued processes
+// are never running, so any of them is free to move.
+static void sched_balance(int self) {
+    int victim = -1;
+    for (int i = 0; i < SMP_MAX_CPUS; i++)
+        if (i != self && (victim < 0 || runqueues[i].nr_queued > runqueues[victim].nr_queued)) victim = i;
+    if (victim < 0) return;
+
+    int mine = runqueues[self].nr_queued;
+    int theirs = runqueues[victim].nr_queued;
+    if (theirs > mine + 1 || (theirs && !mine)) {
+        process_t* p = rq_pop(&runqueues[victim]);
+        p->cpu = self;
+        sched_enqueue(p);
+    }
+}
+
+process_t* sched_pick() {
+    int self = this_cpu()->id;
+    runqueue_t* rq = &runqueues[self];
+    sched_balance(self);
+    rq->need_resched = 0;
+    for (;;) {
+        process_t* p = rq_pop(rq);
+        if (!p) return 0;
+        if (p->state == PROCESS_READY) {
+            p->run_start = clock_now_ns();
+            return p;
+        }
+    }
+}
+
+// --- Deadline Budget ---
+
+static void sched_throttle(process_t* p) {
+    p->dl_throttled = 1;
+    p->dl_replenish_at = p->dl_deadline;
+    p->dl_deadline += p->dl_period;
+    p->dl_remaining = p->dl_budget;
+    p->run_next = dl_throttled;
+    dl_throttled = p;
+    timer_wake_idle(); // The boot CPU's one-shot must not sleep past dl_replenish_at
+}
+
+// Bill the CPU time since run_start; out of budget means throttled
+static void sched_charge(process_t* p) {
+    if (p->sched_class != SCHED_DEADLINE || p->dl_throttled) return;
+    uint64_t now = clock_now_ns();
+    uint64_t used = now - p->run_start;
+    p->run_start = now;
+    if (used < p->dl_remaining) p->dl_remaining -= used;
+    else if (p->state != PROCESS_ZOMBIE) sched_throttle(p);
+}
+
+void sched_replenish(uint64_t now) {
+    process_t** link = &dl_throttled;
+    while (*link) {
+        process_t* p = *link;
+        if (p->dl_replenish_at > now) { link = &p->run_next; continue; }
+        *link = p->run_next;
+        p->run_next = 0;
+        p->dl_throttled = 0;
+        if (p->dl_deadline <= now) p->dl_deadline = now + p->dl_period;
+        if (p->state == PROCESS_READY) sched_enqueue(p);
+    }
+}
+
+uint64_t sched_next_replenish() {
+    uint64_t next = ~0ULL;
+    for (process_t* p = dl_throttled; p; p = p->run_next)
+        if (p->dl_replenish_at < next) next = p->dl_replenish_at;
+    return next;
+}
+
+void sched_put_prev(process_t* p) {
+    sched_charge(p);
+    if (p->state == PROCESS_READY) sched_enqueue(p);
+}
+
+// A running process is never on a queue (schedule() puts it back), so
+// waking it only flips its state
+void sched_make_ready(process_t* p) {
+    p->state = PROCESS_READY;
+
+    if (p->sched_class == SCHED_DEADLINE) {
+        // Left over budget is only kept if it still fits before the
+        // deadline; otherwise a fresh period starts now
+        uint64_t now = clock_now_ns();
+        if (!p->dl_throttled && now + p->dl_remaining > p->dl_deadline) {
+            p->dl_deadline = now + p->dl_period;
+            p->dl_remaining = p->dl_budget;
+        }
+        p->run_start = now; // A running process runs on without a pick
+    } else if (p->sched_class == SCHED_NORMAL) {
+        // Blocking before the slice ran out earns a level back
+        if (p->sched_penalty > 0) p->sched_penalty--;
+        p->sched_level = sched_level_of(p);
+    }
+    if (!sched_running(p)) sched_enqueue(p);
+}
+
+static void sched_dl_release(process_t* p) {
+    if (p->dl_throttled) list_remove(&dl_throttled, p);
+    p->dl_throttled = 0;
+    dl_util -= p->dl_util;
+    p->dl_util = 0;
+}
+
+void sched_exit(process_t* p) {
+    if (p->sched_class != SCHED_DEADLINE) return;
+    sched_dl_release(p);
+    p->sched_class = SCHED_NORMAL;
+}
+
+// --- Tick ---
+
+// Every normal process back to its base level
+static void sched_boost_all() {
+    process_t* p = ready_queue;
+    do {
+        if (p->sched_class == SCHED_NORMAL) {
+            int was_queued = p->queued;
+            sched_dequeue(p);
+            p->sched_penalty = 0;
+            sched_refill(p);
+            if (was_queued) sched_enqueue(p);
+        }
+        p = p->next;
+    } while (p != ready_queue);
+}
+
+int sched_tick() {
+    cpu_t* cpu = this_cpu();
+    process_t* p = cpu->current;
+    if (!p || p == cpu->idle) return 0; // The idle loop schedules right after the interrupt
+    runqueue_t* rq = &runqueues[cpu->id];
+
+    uint64_t now = clock_now_ns();
+    if (now >= next_boost) {
+        if (next_boost) sched_boost_all();
+        next_boost = now + SCHED_BOOST_NS;
+    }
+    if (p->state != PROCESS_READY) return rq->need_resched;
+
+    if (p->sched_class == SCHED_DEADLINE) {
+        sched_charge(p);
+        if (p->dl_throttled) return 1;
+    } else if (p->sched_class == SCHED_NORMAL && --p->slice_left <= 0) {
+        // Used the whole slice: sink one level
+        if (p->sched_penalty < SCHED_MAX_PENALTY) p->sched_penalty++;
+        sched_refill(p);
+        return 1;
+    }
+    return rq->need_resched;
+}
+
+int sched_need_resched() {
+    cpu_t* cpu = this_cpu();
+    return cpu->current != cpu->idle && runqueues[cpu->id].need_resched;
+}
+
+// --- Configuration ---
+
+static process_t* sched_find(int pid) {
+    if (pid == 0) return current_process;
+    process_t* p = ready_queue;
+    do {
+        if (p->pid == pid && p->state != PROCESS_ZOMBIE) return p;
+        p = p->next;
+    } while (p != ready_queue);
+    return 0;
+}
+
+int sched_set_nice(int pid, int nice) {
+    if (nice < SCHED_NICE_MIN) nice = SCHED_NICE_MIN;
+    if (nice > SCHED_NICE_MAX) nice = SCHED_NICE_MAX;
+
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    process_t* p = sched_find(pid);
+    if (p) {
+        int was_queued = p->queued;
+        sched_dequeue(p);
+        p->nice = nice;
+        sched_refill(p);
+        if (was_queued) sched_enqueue(p);
+        // Lowering a running process may put someone else ahead
+        if (sched_running(p)) sched_resched_cpu(p->cpu);
+    }
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return p ? 0 : -1;
+}
+
+int sched_pid_is_ours(int pid) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    process_t* p = sched_find(pid);
+    int ours = p && p->leader == current_process->leader;
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return ours;
+}
+
+int sched_get_nice(int pid, int* nice) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    process_t* p = sched_find(pid);
+    if (p) *nice = p->nice;
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return p ? 0 : -1;
+}
+
+// Move pid into another class. Deadline reservations are admitted only
+// while the total stays under SCHED_DL_MAX_UTIL.
+int sched_set_class(int pid, int policy, const sched_attr_t* attr) {
+    uint32_t util = 0;
+    if (policy == SCHED_FIFO) {
+        if (attr->priority >= SCHED_RT_LEVELS) return -1;
+    } else if (policy == SCHED_DEADLINE) {
+        if (attr->period_us < SCHED_DL_MIN_PERIOD_US || attr->budget_us == 0 || attr->budget_us > attr->period_us) return -1;
+        util = (uint32_t)div_u64((uint64_t)attr->budget_us * 1000, attr->period_us, 0);
+        if (util == 0) util = 1;
+    } else if (policy != SCHED_NORMAL) {
+        return -1;
+    }
+
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    process_t* p = sched_find(pid);
+    int ok = p != 0;
+    if (ok) {
+        uint32_t old_util = p->sched_class == SCHED_DEADLINE ? p->dl_util : 0;
+        if (policy == SCHED_DEADLINE && dl_util - old_util + util > SCHED_DL_MAX_UTIL) ok = 0;
+    }
+    if (ok) {
+        sched_dequeue(p);
+        if (p->sched_class == SCHED_DEADLINE) sched_dl_release(p);
+
+        p->sched_class = policy;
+        if (policy == SCHED_FIFO) {
+            p->rt_priority = attr->priority;
+        } else if (policy == SCHED_DEADLINE) {
+            p->dl_period = (uint64_t)attr->period_us * 1000;
+            p->dl_budget = (uint64_t)attr->budget_us * 1000;
+            p->dl_deadline = clock_now_ns() + p->dl_period;
+            p->dl_remaining = p->dl_budget;
+            p->dl_util = util;
+            p->run_start = clock_now_ns();
+            dl_util += util;
+        } else {
+            p->sched_penalty = 0;
+            sched_refill(p);
+        }
+
+        if (sched_running(p)) sched_resched_cpu(p->cpu);
+        else if (p->state == PROCESS_READY) sched_enqueue(p);
+    }
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return ok ? 0 : -1;
+}
@@ -0,0 +1,64 @@
+/* src/kernel/sched.h */
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+
+// Three scheduling classes, each strictly ahead of the next:
+//
+// SCHED_DEADLINE  Earliest deadline first. The task reserves budget_us of
+//                 CPU every period_us; overrunning the budget throttles it
+//                 until its next period (constant bandwidth server).
+// SCHED_FIFO      Fixed priority 0..31, higher first, no time slicing.
+// SCHED_NORMAL    Multi-level feedback queue. Every READY process that is
+//                 not running sits on one FIFO per level; a bitmap of
+//                 non-empty levels makes pick-next O(1). A process's level
+//                 is its nice value (scaled) plus a penalty that grows each
+//                 time it uses up a whole slice and shrinks each time it
+//                 wakes from a block, so CPU hogs sink below interactive
+//                 tasks. All penalties are reset periodically.
+//
+// Children always start in SCHED_NORMAL, with their parent's nice value.
+
+#define SCHED_NORMAL   0
+#define SCHED_FIFO     1
+#define SCHED_DEADLINE 2
+
+#define SCHED_LEVELS      32    // 0 is the highest priority
+#define SCHED_NICE_MIN    (-20)
+#define SCHED_NICE_MAX    19
+#define SCHED_NICE_SHIFT  2     // Base level = (nice + 20) >> 2, 0..9
+#define SCHED_MAX_PENALTY 22    // Lowest base + penalty is level 31
+#define SCHED_BOOST_NS    1000000000ULL // Penalty reset period
+
+#define SCHED_RT_LEVELS   32    // FIFO priorities
+#define SCHED_DL_MIN_PERIOD_US 1000
+#define SCHED_DL_MAX_UTIL 900   // Per mille of the CPU deadline tasks may reserve
+
+// NOTE: Layout is mirrored in programs/stdlib.h - keep them in sync.
+typedef struct {
+    uint32_t priority;          // SCHED_FIFO
+    uint32_t period_us;         // SCHED_DEADLINE
+    uint32_t budget_us;
+} sched_attr_t;
+
+struct process;
+
+void sched_init_process(struct process* p, struct process* parent);
+void sched_exit(struct process* p);         // Release its reservation
+void sched_enqueue(struct process* p);      // p is READY, tail of its queue
+void sched_put_prev(struct process* p);     // Charge the outgoing process, requeue if READY
+void sched_make_ready(struct process* p);   // Wake from a block
+struct process* sched_pick();               // Dequeue the best, 0 if none
+int sched_tick();                           // Per timer tick: 1 to preempt
+int sched_need_resched();                   // A better process woke up
+
+void sched_replenish(uint64_t now);         // Timer: end throttling that is due
+uint64_t sched_next_replenish();            // ~0 if nothing is throttled
+
+int sched_set_nice(int pid, int nice);      // pid 0 = caller; 0 or -1
+int sched_get_nice(int pid, int* nice);
+int sched_set_class(int pid, int policy, const sched_attr_t* attr);
+int sched_pid_is_ours(int pid);             // pid 0, or a thread of the caller's process
+
+#endif
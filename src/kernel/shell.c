@@ -1,9 +1,15 @@
 /* src/kernel/shell.c */
 #include "../mm/heap.h"
+#include "syscall.h"
+#include "timer.h"
+#include "sched.h"
+#include "sync.h"
+#include "../cpu/irq.h"
 
 // --- Externs ---
 extern void term_print(const char* str);
 extern void term_clear();
+extern void term_print_dec(uint32_t n);
 extern int strcmp(const char* s1, const char* s2);
 extern int strlen(const char* str);
 extern void strcpy_safe(char* dest, const char* src);
@@ -56,6 +62,62 @@ void execute_command(char* input) {
     else if (strcmp(input, "clear") == 0) {
         term_clear();
     }
+    else if (strcmp(input, "sysstat") == 0) {
+        syscall_dump_stats();
+    }
+    else if (strcmp(input, "sysstat reset") == 0) {
+        syscall_reset_stats();
+    }
+    else if (strcmp(input, "lockstat") == 0) {
+        lock_dump_stats();
+    }
+    else if (strcmp(input, "timer") == 0) {
+        term_print(timer_source_name());
+        term_print(" timer at ");
+        term_print_dec(timer_get_hz());
+        term_print(" Hz\n");
+    }
+    else if (str_starts_with(input, "timer ")) {
+        uint32_t hz = 0;
+        for (char* c = input + 6; *c >= '0' && *c <= '9'; c++) hz = hz * 10 + (*c - '0');
+        if (timer_set_hz(hz) != 0) term_print("Rate must be 19-10000 Hz.\n");
+    }
+    else if (strcmp(input, "irq") == 0) {
+        term_print(irq_controller_name());
+        term_print("\n");
+        for (int irq = 0; irq < IRQ_COUNT; irq++) {
+            int vector = irq_vector(irq);
+            if (vector < 0) continue;
+            term_print("  IRQ ");
+            term_print_dec(irq);
+            term_print(": vector ");
+            term_print_dec(vector);
+            term_print(", CPU ");
+            term_print_dec(irq_get_affinity(irq));
+            term_print("\n");
+        }
+    }
+    else if (str_starts_with(input, "irq ")) {
+        // irq <n> <cpu>
+        char* c = input + 4;
+        int irq = 0, cpu = 0;
+        while (*c >= '0' && *c <= '9') irq = irq * 10 + (*c++ - '0');
+        while (*c == ' ') c++;
+        while (*c >= '0' && *c <= '9') cpu = cpu * 10 + (*c++ - '0');
+        if (irq_set_affinity(irq, cpu) != 0)
+            term_print("Cannot route that IRQ there.\n");
+    }
+    else if (str_starts_with(input, "nice ")) {
+        // nice <pid> <value>
+        char* c = input + 5;
+        int pid = 0, nice = 0, neg = 0;
+        while (*c >= '0' && *c <= '9') pid = pid * 10 + (*c++ - '0');
+        while (*c == ' ') c++;
+        if (*c == '-') { neg = 1; c++; }
+        while (*c >= '0' && *c <= '9') nice = nice * 10 + (*c++ - '0');
+        if (pid == 0 || sched_set_nice(pid, neg ? -nice : nice) != 0)
+            term_print("No such process.\n");
+    }
     else if (strcmp(input, "help") == 0) {
         term_print("\n--- MyOS Commands ---\n");
         term_print("  ls [path]       - List directory\n");
@@ -66,6 +128,11 @@ void execute_command(char* input) {
         term_print("  mkdir <name>    - Create directory\n");
         term_print("  rm <file>       - Delete file\n");
         term_print("  clear           - Clear screen\n");
+        term_print("  sysstat [reset] - Syscall counts and latency\n");
+        term_print("  lockstat        - Lock acquisitions and contention\n");
+        term_print("  timer [hz]      - Show or set the tick rate\n");
+        term_print("  nice <pid> <n>  - Set priority, -20 (high) to 19\n");
+        term_print("  irq [n cpu]     - Show interrupt routing, or steer IRQ n\n");
         term_print("  <program>       - Run program (e.g. hello.elf)\n");
     }
     else if (str_starts_with(input, "cd ")) {
@@ -76,7 +143,7 @@ void execute_command(char* input) {
     else {
         // Try to execute as program
         char filename[32];
-        char args[64];
+        char args[128];
         int i = 0;
         
         // Split filename and args
@@ -0,0 +1,274 @@
+/* src/kernel/snapshot.c */
+#include "snapshot.h"
+#include "process.h"
+#include "fs.h"
+#include "elf.h"
+#include "memops.h"
+#include "../mm/heap.h"
+#include "../mm/vmm.h"
+
+extern page_directory_t* kernel_directory;
+extern void* pmm_alloc_block();
+extern void pmm_free_block(void* p);
+extern void vmm_map_page_in_dir(page_directory_t* pd, void* phys, void* virt, int flags);
+extern void strcpy_safe(char* dest, const char* src);
+
+static snapshot_image_t* snapshot_cache = 0;
+
+// --- Capture ---
+
+// Count the user pages of pd, copying them out when pages is set. User
+// pages live in tables not shared with the kernel (vmm_create_address_space).
+static uint32_t snapshot_walk(page_directory_t* pd, snap_page_t* pages, uint8_t* data) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < 1024; i++) {
+        uint32_t pde = pd->tablesPhysical[i];
+        if (!(pde & I86_PTE_PRESENT) || vmm_pde_is_kernel(pd, i)) continue;
+
+        uint32_t* pt = (uint32_t*)(pde & 0xFFFFF000);
+        for (uint32_t j = 0; j < 1024; j++) {
+            uint32_t pte = pt[j];
+            if (!(pte & I86_PTE_PRESENT) || !(pte & I86_PTE_USER)) continue;
+            if (pages) {
+                pages[n].va = (i << 22) | (j << 12);
+                pages[n].flags = (pte & (I86_PTE_WRITABLE | I86_PTE_COW)) ? SNAP_PAGE_WRITABLE : 0;
+                memcpy(data + n * PAGE_SIZE, (void*)(pte & 0xFFFFF000), PAGE_SIZE);
+            }
+            n++;
+        }
+    }
+    return n;
+}
+
+// Write the calling process to 'path'. regs is its trap frame: a restored
+// copy resumes there with eax = 1, the caller gets 0. Only the calling
+// thread is restored; the others' stacks come along as plain memory.
+int snapshot_save(const char* path, registers_t* regs) {
+    process_t* proc = current_process ? current_process->leader : 0;
+    if (!proc || proc->cr3 == (uint32_t)kernel_directory) return -1;
+    page_directory_t* pd = (page_directory_t*)proc->cr3;
+    // Only the caller's registers are saved, so other threads would vanish
+    if (proc->thread_count > 1) return -1;
+
+    uint32_t nfds = 0;
+    for (int i = 0; i < MAX_OPEN_FILES; i++) {
+        file_descriptor_t* desc = &proc->fd_table[i];
+        if (desc->type == FD_NONE) continue;
+        // Pipes, timerfds and epoll sets are kernel objects with no path
+        if (desc->type != FD_FILE && desc->type != FD_CONSOLE) return -1;
+        nfds++;
+    }
+
+    uint32_t npages = snapshot_walk(pd, 0, 0);
+
+    uint32_t meta = sizeof(snap_header_t) + npages * sizeof(snap_page_t) + nfds * sizeof(snap_fd_t);
+    uint32_t size = meta + npages * PAGE_SIZE;
+    char* buf = (char*)kmalloc(size);
+    if (!buf) return -1;
+    memset(buf, 0, meta);
+
+    snap_header_t* hdr = (snap_header_t*)buf;
+    snap_page_t* pages = (snap_page_t*)(hdr + 1);
+    snap_fd_t* fds = (snap_fd_t*)(pages + npages);
+    uint8_t* data = (uint8_t*)(fds + nfds);
+
+    hdr->magic = SNAP_MAGIC;
+    hdr->version = SNAP_VERSION;
+    hdr->regs = *regs;
+    hdr->regs.eax = 1;
+    hdr->program_break = proc->program_break;
+    hdr->npages = npages;
+    hdr->nfds = nfds;
+    if (fs_get_path(proc->cwd, hdr->cwd, SNAP_PATH_MAX) < 0) strcpy_safe(hdr->cwd, "/");
+
+    // Files are recorded by path
+    snap_fd_t* out = fds;
+    for (int i = 0; i < MAX_OPEN_FILES; i++) {
+        file_descriptor_t* desc = &proc->fd_table[i];
+        if (desc->type == FD_NONE) continue;
+        out->fd = i;
+        out->type = desc->type;
+        out->offset = desc->offset;
+        if (desc->type == FD_FILE && fs_get_path(desc->file_node, out->path, SNAP_PATH_MAX) < 0) {
+            kfree(buf);
+            return -1;
+        }
+        out++;
+    }
+
+    snapshot_walk(pd, pages, data);
+
+    file_t* f = fs_create_file(path);
+    if (!f) { kfree(buf); return -1; }
+    fs_file_changed(f);
+    if (f->data) kfree(f->data);
+    f->data = buf;
+    f->size = size;
+    return 0;
+}
+
+// --- Image Cache ---
+
+int snapshot_is_image(file_t* f) {
+    return f && f->data && f->size >= sizeof(snap_header_t) && ((snap_header_t*)f->data)->magic == SNAP_MAGIC;
+}
+
+// Files can be written by anyone: sizes must add up, and every page must
+// be an aligned user address outside the kernel's tables
+static int snapshot_check(file_t* f) {
+    snap_header_t* hdr = (snap_header_t*)f->data;
+    if (hdr->version != SNAP_VERSION || hdr->nfds > MAX_OPEN_FILES) return 0;
+    if (hdr->npages == 0 || hdr->npages > f->size / PAGE_SIZE) return 0;
+    if (hdr->program_break > ELF_LIB_BASE) return 0;
+
+    uint32_t size = sizeof(snap_header_t) + hdr->npages * (sizeof(snap_page_t) + PAGE_SIZE) + hdr->nfds * sizeof(snap_fd_t);
+    if (size != f->size) return 0;
+
+    snap_page_t* pages = (snap_page_t*)(hdr + 1);
+    for (uint32_t i = 0; i < hdr->npages; i++) {
+        if (pages[i].va & 0xFFF) return 0;
+        if (kernel_directory->tablesPhysical[pages[i].va >> 22] & I86_PTE_PRESENT) return 0;
+    }
+    return 1;
+}
+
+static void snapshot_image_free(snapshot_image_t* img) {
+    snapshot_image_t** link = &snapshot_cache;
+    while (*link && *link != img) link = &(*link)->next;
+    if (*link) *link = img->next;
+
+    for (uint32_t p = 0; p < img->npages; p++)
+        if (img->frames[p]) pmm_free_block((void*)img->frames[p]);
+    kfree(img->frames);
+    kfree(img);
+}
+
+// Frames hold the page contents as of the snapshot; processes only ever
+// map them read-only (I86_PTE_COW copies on write)
+static snapshot_image_t* snapshot_image_build(file_t* f) {
+    snap_header_t* hdr = (snap_header_t*)f->data;
+    uint8_t* data = (uint8_t*)f->data + f->size - hdr->npages * PAGE_SIZE;
+
+    snapshot_image_t* img = (snapshot_image_t*)kmalloc(sizeof(snapshot_image_t));
+    if (!img) return 0;
+    memset(img, 0, sizeof(snapshot_image_t));
+    img->file = f;
+    img->data = f->data;
+    img->size = f->size;
+    img->npages = hdr->npages;
+    img->frames = (uint32_t*)kmalloc(hdr->npages * sizeof(uint32_t));
+    if (!img->frames) { kfree(img); return 0; }
+    memset(img->frames, 0, hdr->npages * sizeof(uint32_t));
+
+    for (uint32_t p = 0; p < hdr->npages; p++) {
+        void* frame = pmm_alloc_block();
+        if (!frame) { snapshot_image_free(img); return 0; }
+        memcpy(frame, data + p * PAGE_SIZE, PAGE_SIZE);
+        img->frames[p] = (uint32_t)frame;
+    }
+
+    img->next = snapshot_cache;
+    snapshot_cache = img;
+    return img;
+}
+
+// Returns a referenced image for f, building it on first use
+static snapshot_image_t* snapshot_image_get(file_t* f) {
+    for (snapshot_image_t* img = snapshot_cache; img; img = img->next) {
+        if (img->file != f || img->stale) continue;
+        if (img->data == f->data && img->size == f->size) {
+            img->refs++;
+            return img;
+        }
+        // File was replaced behind our back
+        img->stale = 1;
+        if (img->refs == 0) snapshot_image_free(img);
+        break;
+    }
+
+    snapshot_image_t* img = snapshot_image_build(f);
+    if (img) img->refs++;
+    return img;
+}
+
+void snapshot_image_put(snapshot_image_t* img) {
+    if (!img) return;
+    img->refs--;
+    if (img->stale && img->refs <= 0) snapshot_image_free(img);
+}
+
+// Called whenever a file's contents change or it is deleted
+void snapshot_invalidate(file_t* file) {
+    snapshot_image_t* img = snapshot_cache;
+    while (img) {
+        snapshot_image_t* next = img->next;
+        if (img->file == file) {
+            img->stale = 1;
+            if (img->refs == 0) snapshot_image_free(img);
+        }
+        img = next;
+    }
+}
+
+// --- Restore ---
+
+// Start a copy of the process saved in f. Its pages are mapped from the
+// cached frames (copy-on-write where they were writable), so no init code
+// runs again. Returns the new pid.
+int snapshot_restore(file_t* f) {
+    if (!snapshot_is_image(f) || !snapshot_check(f)) return -1;
+    snap_header_t* hdr = (snap_header_t*)f->data;
+    snap_page_t* pages = (snap_page_t*)(hdr + 1);
+    snap_fd_t* fds = (snap_fd_t*)(pages + hdr->npages);
+
+    page_directory_t* pd = process_alloc_address_space();
+    if (!pd) return -1;
+
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+
+    snapshot_image_t* img = snapshot_image_get(f);
+    if (!img) {
+        __asm__ volatile("push %0; popf" : : "r"(eflags));
+        process_free_address_space(pd);
+        return -1;
+    }
+
+    for (uint32_t p = 0; p < hdr->npages; p++) {
+        int flags = I86_PTE_PRESENT | I86_PTE_USER | I86_PTE_SHARED;
+        if (pages[p].flags & SNAP_PAGE_WRITABLE) flags |= I86_PTE_COW;
+        vmm_map_page_in_dir(pd, (void*)img->frames[p], (void*)pages[p].va, flags);
+    }
+
+    process_t* proc = create_process_from_regs(pd, &hdr->regs, hdr->program_break);
+    proc->snapshot = img;
+
+    char path[SNAP_PATH_MAX];
+    memcpy(path, hdr->cwd, SNAP_PATH_MAX);
+    path[SNAP_PATH_MAX - 1] = 0;
+    file_t* cwd = fs_resolve_path(path);
+    if (cwd && cwd->flags == FS_DIRECTORY) proc->cwd = cwd;
+
+    // Exactly the saved descriptors; files that have gone stay closed
+    memset(proc->fd_table, 0, sizeof(proc->fd_table));
+    for (uint32_t i = 0; i < hdr->nfds; i++) {
+        if (fds[i].fd < 0 || fds[i].fd >= MAX_OPEN_FILES) continue;
+        file_descriptor_t* desc = &proc->fd_table[fds[i].fd];
+        if (fds[i].type == FD_CONSOLE) {
+            desc->type = FD_CONSOLE;
+        } else if (fds[i].type == FD_FILE) {
+            memcpy(path, fds[i].path, SNAP_PATH_MAX);
+            path[SNAP_PATH_MAX - 1] = 0;
+            file_t* node = fs_resolve_path(path);
+            if (!node) continue;
+            desc->type = FD_FILE;
+            desc->file_node = node;
+            desc->offset = fds[i].offset;
+            desc->dir_next = node->children;
+            desc->dir_index = 0;
+        }
+    }
+
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return proc->pid;
+}
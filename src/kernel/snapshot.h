@@ -0,0 +1,65 @@
+/* src/kernel/snapshot.h */
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include "../cpu/idt.h" // For registers_t
+
+// Process snapshots: a warmed-up process saves its user pages, registers
+// and descriptors to a file; spawning that file (elf_spawn) resumes a copy
+// of it right after the snapshot() call instead of running main() again.
+// Restored pages are mapped copy-on-write from frames cached per file, so
+// starting another copy costs one page-table entry per page.
+// Only single-threaded processes whose descriptors are all the console or
+// files with a path can be saved; anything else makes snapshot() fail.
+
+#define SNAP_MAGIC   0x50414E53 // "SNAP" in little endian
+#define SNAP_VERSION 1
+#define SNAP_PATH_MAX 64
+
+#define SNAP_PAGE_WRITABLE 0x1
+
+// File layout: header, page table, fd table, then the page contents in
+// page-table order, PAGE_SIZE bytes each
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    registers_t regs;        // Trap frame of the snapshot() call, eax = 1
+    uint32_t program_break;
+    uint32_t npages;
+    uint32_t nfds;
+    char cwd[SNAP_PATH_MAX];
+} snap_header_t;
+
+typedef struct {
+    uint32_t va;             // Page-aligned user address
+    uint32_t flags;          // SNAP_PAGE_*
+} snap_page_t;
+
+typedef struct {
+    int fd;
+    int type;                // FD_*
+    int offset;
+    char path[SNAP_PATH_MAX]; // FD_FILE only
+} snap_fd_t;
+
+struct file_node;
+
+typedef struct snapshot_image {
+    struct file_node* file;
+    char* data;              // file->data / size when loaded, to catch rewrites
+    uint32_t size;
+    int refs;                // Running processes mapping us
+    int stale;               // File changed: drop when refs reaches 0
+    uint32_t npages;
+    uint32_t* frames;        // One per page-table entry
+    struct snapshot_image* next;
+} snapshot_image_t;
+
+int snapshot_save(const char* path, registers_t* regs);
+int snapshot_is_image(struct file_node* f);
+int snapshot_restore(struct file_node* f);
+void snapshot_image_put(snapshot_image_t* img);
+void snapshot_invalidate(struct file_node* file);
+
+#endif
@@ -0,0 +1,254 @@
+/* src/kernel/sync.c */
+#include "sync.h"
+#include "process.h"
+#include "clock.h"
+#include "../cpu/cpu.h"
+
+extern void term_print(const char* str);
+extern void term_print_dec(uint32_t n);
+extern uint64_t div_u64(uint64_t n, uint32_t d, uint32_t* rem);
+
+// --- Statistics ---
+
+#if SYNC_STATS
+static lock_stats_t* volatile stats_list = 0;
+
+static void stats_init(lock_stats_t* s, const char* name) {
+    s->name = name;
+    s->acquired = 0;
+    s->contended = 0;
+    s->wait_cycles = 0;
+    s->next = 0;
+    s->listed = 0;
+}
+
+// Called with the lock held. wait_start is 0 if we did not have to wait.
+static void stats_acquired(lock_stats_t* s, uint64_t wait_start) {
+    if (!s->listed && !__sync_lock_test_and_set(&s->listed, 1)) {
+        do s->next = stats_list;
+        while (!__sync_bool_compare_and_swap(&stats_list, s->next, s));
+    }
+    s->acquired++;
+    if (wait_start) {
+        s->contended++;
+        s->wait_cycles += rdtsc() - wait_start;
+    }
+}
+#else
+#define stats_init(s, name)       ((void)(name))
+#define stats_acquired(s, start)  ((void)(start))
+#endif
+
+// --- Spinlock ---
+
+void spinlock_init(spinlock_t* l, const char* name) {
+    l->next = 0;
+    l->owner = 0;
+    stats_init(&l->stats, name);
+}
+
+uint32_t spin_lock_irqsave(spinlock_t* l) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+
+    uint16_t ticket = __sync_fetch_and_add(&l->next, 1);
+    uint64_t start = 0;
+    if (l->owner != ticket) {
+        start = rdtsc();
+        while (l->owner != ticket) __asm__ volatile("pause" ::: "memory");
+    }
+    stats_acquired(&l->stats, start);
+    return eflags;
+}
+
+void spin_unlock_irqrestore(spinlock_t* l, uint32_t eflags) {
+    __atomic_store_n(&l->owner, (uint16_t)(l->owner + 1), __ATOMIC_RELEASE);
+    __asm__ volatile("push %0; popf" : : "r"(eflags) : "memory");
+}
+
+// --- Mutex ---
+
+void mutex_init(mutex_t* m, const char* name) {
+    m->locked = 0;
+    m->owner = 0;
+    wait_queue_init(&m->waiters);
+    stats_init(&m->stats, name);
+}
+
+void mutex_lock(mutex_t* m) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+
+    process_t* me = current_process;
+    uint64_t start = 0;
+    if (m->locked) {
+        // mutex_unlock() hands the lock straight to the first waiter
+        start = rdtsc();
+        while (m->owner != me)
+            wait_queue_wait(&m->waiters, WAIT_FOREVER);
+    } else {
+        m->locked = 1;
+        m->owner = me;
+    }
+    stats_acquired(&m->stats, start);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+int mutex_trylock(mutex_t* m) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    int taken = !m->locked;
+    if (taken) {
+        m->locked = 1;
+        m->owner = current_process;
+        stats_acquired(&m->stats, 0);
+    }
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return taken;
+}
+
+void mutex_unlock(mutex_t* m) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    if (m->waiters.head) {
+        m->owner = m->waiters.head;
+        wait_queue_wake_one(&m->waiters);
+    } else {
+        m->locked = 0;
+        m->owner = 0;
+    }
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+// --- Reader-writer lock ---
+
+void rwlock_init(rwlock_t* l, const char* name) {
+    l->readers = 0;
+    l->writer = 0;
+    l->writers_waiting = 0;
+    wait_queue_init(&l->read_wait);
+    wait_queue_init(&l->write_wait);
+    stats_init(&l->stats, name);
+}
+
+void read_lock(rwlock_t* l) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    uint64_t start = 0;
+    if (l->writer || l->writers_waiting) {
+        start = rdtsc();
+        while (l->writer || l->writers_waiting)
+            wait_queue_wait(&l->read_wait, WAIT_FOREVER);
+    }
+    l->readers++;
+    stats_acquired(&l->stats, start);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+void read_unlock(rwlock_t* l) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    if (--l->readers == 0 && l->writers_waiting)
+        wait_queue_wake_one(&l->write_wait);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+void write_lock(rwlock_t* l) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    uint64_t start = 0;
+    if (l->writer || l->readers) {
+        start = rdtsc();
+        l->writers_waiting++;
+        while (l->writer || l->readers)
+            wait_queue_wait(&l->write_wait, WAIT_FOREVER);
+        l->writers_waiting--;
+    }
+    l->writer = 1;
+    stats_acquired(&l->stats, start);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+// Writers first; readers held back by them go once none is left
+void write_unlock(rwlock_t* l) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    l->writer = 0;
+    if (l->writers_waiting) wait_queue_wake_one(&l->write_wait);
+    else wait_queue_wake_all(&l->read_wait);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+// --- Semaphore ---
+
+void sem_init(semaphore_t* s, const char* name, int count) {
+    s->count = count;
+    wait_queue_init(&s->waiters);
+    stats_init(&s->stats, name);
+}
+
+int sem_down_timeout(semaphore_t* s, uint64_t timeout_ns) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+
+    int result = WAIT_WOKEN;
+    uint64_t start = 0;
+    if (s->count <= 0) {
+        start = rdtsc();
+        uint64_t deadline = timeout_ns == WAIT_FOREVER ? 0 : clock_now_ns() + timeout_ns;
+        while (s->count <= 0 && result == WAIT_WOKEN)
+            result = wait_queue_wait_until(&s->waiters, deadline);
+        if (s->count > 0) result = WAIT_WOKEN; // Came up just as we timed out
+    }
+    if (result == WAIT_WOKEN) {
+        s->count--;
+        stats_acquired(&s->stats, start);
+    }
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return result;
+}
+
+void sem_down(semaphore_t* s) {
+    sem_down_timeout(s, WAIT_FOREVER);
+}
+
+int sem_trydown(semaphore_t* s) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    int taken = s->count > 0;
+    if (taken) {
+        s->count--;
+        stats_acquired(&s->stats, 0);
+    }
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return taken;
+}
+
+void sem_up(semaphore_t* s) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    s->count++;
+    wait_queue_wake_one(&s->waiters);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+// --- Report ---
+
+void lock_dump_stats() {
+#if SYNC_STATS
+    term_print("\n--- Lock Stats (wait in cycles) ---\n");
+    for (lock_stats_t* s = stats_list; s; s = s->next) {
+        term_print("  "); term_print(s->name);
+        term_print(": taken="); term_print_dec(s->acquired);
+        term_print(" waited="); term_print_dec(s->contended);
+        if (s->contended) {
+            term_print(" avg=");
+            term_print_dec((uint32_t)div_u64(s->wait_cycles, s->contended, 0));
+        }
+        term_print("\n");
+    }
+    term_print("-----------------------------------\n");
+#else
+    term_print("Lock statistics are compiled out (SYNC_STATS).\n");
+#endif
+}
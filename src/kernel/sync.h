@@ -0,0 +1,115 @@
+/* src/kernel/sync.h */
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <stdint.h>
+#include "wait.h"
+
+// Kernel locks.
+//
+//   spinlock_t   Ticket lock, held with interrupts off, so usable from
+//                interrupt handlers; CPUs get it in arrival order. Never
+//                sleep while holding one.
+//   mutex_t      Sleeping lock with one owner, handed to waiters in order.
+//   rwlock_t     Sleeping; many readers or one writer. A waiting writer
+//                holds back new readers, so read locks must not nest.
+//   semaphore_t  Counting; sem_down() sleeps while the count is zero.
+//
+// The sleeping locks cannot be contended before multitasking starts, and
+// simply succeed then. Every kernel path still runs under the big kernel
+// lock (smp.h), but a process gives that up whenever it blocks: these are
+// what keep things consistent across the sleeps.
+//
+// With SYNC_STATS each lock counts acquisitions, how many of them had to
+// wait, and the cycles spent waiting. A lock shows up in
+// lock_dump_stats() once it has been taken.
+
+#define SYNC_STATS 1
+
+typedef struct lock_stats {
+#if SYNC_STATS
+    const char* name;
+    uint32_t acquired;
+    uint32_t contended;
+    uint64_t wait_cycles;
+    struct lock_stats* next;    // Every lock taken so far
+    volatile int listed;
+#endif
+} lock_stats_t;
+
+#if SYNC_STATS
+#define LOCK_STATS_INIT(name) { name, 0, 0, 0, 0, 0 }
+#else
+#define LOCK_STATS_INIT(name) { }
+#endif
+
+struct process;
+
+// --- Spinlock ---
+
+typedef struct {
+    volatile uint16_t next;     // Ticket for the next arrival
+    volatile uint16_t owner;    // Ticket being served
+    lock_stats_t stats;
+} spinlock_t;
+
+#define SPINLOCK_INIT(name) { 0, 0, LOCK_STATS_INIT(name) }
+
+void spinlock_init(spinlock_t* l, const char* name);
+uint32_t spin_lock_irqsave(spinlock_t* l);              // Returns the EFLAGS to restore
+void spin_unlock_irqrestore(spinlock_t* l, uint32_t eflags);
+
+// --- Mutex ---
+
+typedef struct {
+    int locked;
+    struct process* owner;      // 0 when taken before multitasking
+    wait_queue_t waiters;
+    lock_stats_t stats;
+} mutex_t;
+
+#define MUTEX_INIT(name) { 0, 0, WAIT_QUEUE_INIT, LOCK_STATS_INIT(name) }
+
+void mutex_init(mutex_t* m, const char* name);
+void mutex_lock(mutex_t* m);
+int mutex_trylock(mutex_t* m);  // 1 if taken
+void mutex_unlock(mutex_t* m);
+
+// --- Reader-writer lock ---
+
+typedef struct {
+    int readers;                // Holding it for reading
+    int writer;                 // 1 while held for writing
+    int writers_waiting;
+    wait_queue_t read_wait;
+    wait_queue_t write_wait;
+    lock_stats_t stats;
+} rwlock_t;
+
+#define RWLOCK_INIT(name) { 0, 0, 0, WAIT_QUEUE_INIT, WAIT_QUEUE_INIT, LOCK_STATS_INIT(name) }
+
+void rwlock_init(rwlock_t* l, const char* name);
+void read_lock(rwlock_t* l);
+void read_unlock(rwlock_t* l);
+void write_lock(rwlock_t* l);
+void write_unlock(rwlock_t* l);
+
+// --- Semaphore ---
+
+typedef struct {
+    int count;
+    wait_queue_t waiters;
+    lock_stats_t stats;
+} semaphore_t;
+
+#define SEMAPHORE_INIT(name, count) { count, WAIT_QUEUE_INIT, LOCK_STATS_INIT(name) }
+
+void sem_init(semaphore_t* s, const char* name, int count);
+void sem_down(semaphore_t* s);
+int sem_down_timeout(semaphore_t* s, uint64_t timeout_ns);  // WAIT_WOKEN or WAIT_TIMEOUT
+int sem_trydown(semaphore_t* s);                            // 1 if taken
+void sem_up(semaphore_t* s);
+
+void lock_dump_stats();
+
+#endif
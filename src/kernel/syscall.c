@@ -2,23 +2,82 @@
 #include "syscall.h"
 #include "process.h"
 #include "fs.h" 
+#include "../cpu/cpu.h"
+#include "../cpu/gdt.h"
+#include "ring.h"
+#include "clock.h"
+#include "../drivers/rtc.h"
+#include "../drivers/tty.h"
+#include "elf.h"
+#include "snapshot.h"
+#include "sched.h"
+#include "timer.h"
+#include "wait.h"
+#include "futex.h"
+#include "epoll.h"
+#include "../mm/heap.h"
 
 extern void term_print(const char* str); 
 extern void process_exit(int code);
-extern char kbd_buffer_read();
 extern void term_clear();
 extern int sys_open(const char* name);
 extern void sys_close(int fd);
 extern int sys_read_file(int fd, char* buf, int size);
 extern int sys_readdir(int index, char* buf);
-extern void vmm_map_page(void* phys, void* virt, int flags);
+extern void vmm_map_page_in_dir(page_directory_t* pd, void* phys, void* virt, int flags);
+extern page_directory_t* kernel_directory;
 extern void* pmm_alloc_block();
 extern void fs_delete(const char* name);
 extern int sys_chdir(const char* path);
 extern void sys_getcwd(char* buf, int size);
 extern int sys_write_file(int fd, char* buffer, int size);
-extern process_t* current_process;
+extern int sys_fcntl(int fd, int cmd, int arg);
+extern int sys_pipe(int* fds);
+extern int sys_timerfd_create();
+extern int sys_timerfd_set(int fd, uint64_t first_ns, uint64_t interval_ns);
+extern int sys_epoll_create();
+extern int sys_epoll_ctl(int epfd, int op, int fd, const epoll_event_t* ev);
+extern int sys_epoll_wait(int epfd, epoll_event_t* events, int max, int timeout_ms);
+extern int sys_seek(int fd, int offset, int whence);
+extern int sys_getdents(int fd, char* buf, int size);
+extern int sys_readv(int fd, const struct iovec* iov, int iovcnt);
+extern int sys_writev(int fd, const struct iovec* iov, int iovcnt);
 extern void* memset(void* ptr, int value, uint32_t num); 
+extern void* memcpy(void* dest, const void* src, uint32_t n);
+extern void sysenter_entry();
+extern void serial_log(char *str);
+
+#define MSR_SYSENTER_CS  0x174
+#define MSR_SYSENTER_ESP 0x175
+#define MSR_SYSENTER_EIP 0x176
+
+int sysenter_enabled = 0;
+
+// Early Pentium Pro parts report SEP but do not implement it
+int cpu_sysenter_usable() {
+    if (!cpu_has_edx1(CPUID_EDX_SEP)) return 0;
+    if (cpu_info.family == 6 && cpu_info.model < 3 && cpu_info.stepping < 3) return 0;
+    return 1;
+}
+
+// Program the SYSENTER MSRs. int 0x80 stays installed as the fallback.
+void init_syscalls() {
+    if (!cpu_sysenter_usable()) {
+        serial_log(" [SYSCALL] SYSENTER unsupported, using int 0x80 only.\n");
+        return;
+    }
+    sysenter_enabled = 1;
+    syscall_init_cpu();
+    serial_log(" [SYSCALL] SYSENTER/SYSEXIT enabled.\n");
+}
+
+// Per CPU: the entry stack comes from this CPU's own TSS
+void syscall_init_cpu() {
+    if (!sysenter_enabled) return;
+    wrmsr(MSR_SYSENTER_CS, 0x08); // SYSEXIT derives 0x1B/0x23 from this
+    wrmsr(MSR_SYSENTER_ESP, (uint32_t)&tss_entry[this_cpu()->id].esp0);
+    wrmsr(MSR_SYSENTER_EIP, (uint32_t)sysenter_entry);
+}
 
 // Security Check
 // Ensure the pointer + size is NOT within Kernel Space (0 - 128MB).
@@ -38,7 +97,7 @@ int is_valid_user_ptr(void* ptr, int size) {
 
 void* sys_sbrk(int increment) {
     if (!current_process) return (void*)-1;
-    process_t* proc = current_process;
+    process_t* proc = current_process->leader; // One heap for all threads
     uint32_t old_break = proc->program_break;
     uint32_t new_break = old_break + increment;
     
@@ -46,6 +105,9 @@ void* sys_sbrk(int increment) {
     uint32_t old_page_top = (old_break + 4095) & 0xFFFFF000;
     uint32_t new_page_top = (new_break + 4095) & 0xFFFFF000;
 
+    // The heap must not run into the shared library
+    if (increment > 0 && (new_break < old_break || new_page_top > ELF_LIB_BASE)) return (void*)-1;
+
     if (new_page_top > old_page_top) {
         uint32_t pages_needed = (new_page_top - old_page_top) / 4096;
         for (uint32_t i = 0; i < pages_needed; i++) {
@@ -55,7 +117,7 @@ void* sys_sbrk(int increment) {
             // SECURITY FIX: Zero out the new memory to prevent leaking kernel data
             memset(phys, 0, 4096);
 
-            vmm_map_page(phys, (void*)(old_page_top + (i * 4096)), 0x7);
+            vmm_map_page_in_dir((page_directory_t*)proc->cr3, phys, (void*)(old_page_top + (i * 4096)), 0x7);
             process_track_page(proc, phys, (void*)(old_page_top + (i * 4096)));
         }
     }
@@ -63,70 +125,469 @@ void* sys_sbrk(int increment) {
     return (void*)old_break;
 }
 
+// --- Syscall Handlers ---
+// Each takes the trapped register frame: arguments in EBX/ECX/EDX,
+// result written back to EAX.
+
+static void sys_print_handler(registers_t* regs) {
+    regs->eax = -1;
+    if (!is_valid_user_ptr((void*)regs->ebx, 1)) return;
+    term_print((const char*)regs->ebx);
+    regs->eax = 0;
+}
+
+static void sys_yield_handler(registers_t* regs) {
+    (void)regs;
+    schedule();
+}
+
+// One byte from the console; sleeps until the TTY has input for us.
+// ebx = timeout in ms (0: none). Returns the byte, or -1 on timeout.
+static void sys_read_handler(registers_t* regs) {
+    char c = 0;
+    uint64_t timeout = (uint64_t)regs->ebx * 1000000;
+    if (tty_read_timeout(&c, 1, timeout ? timeout : WAIT_FOREVER) < 0) regs->eax = -1;
+    else regs->eax = (unsigned char)c;
+}
+
+static void sys_exit_handler(registers_t* regs) {
+    process_exit((int)regs->ebx);
+}
+
+// ebx = pid, ecx = status, edx = timeout in ms (0: none). Returns 0 on timeout.
+static void sys_wait_handler(registers_t* regs) {
+    int* status = (int*)regs->ecx;
+    if (status && !is_valid_user_ptr(status, sizeof(int))) { regs->eax = -1; return; }
+    uint64_t timeout = (uint64_t)regs->edx * 1000000;
+    regs->eax = process_wait_timeout((int)regs->ebx, status, timeout ? timeout : WAIT_FOREVER);
+}
+
+// ebx = const struct { uint32_t sec, nsec; }*
+static void sys_nanosleep_handler(registers_t* regs) {
+    regs->eax = -1;
+    if (!is_valid_user_ptr((void*)regs->ebx, 2 * sizeof(uint32_t))) return;
+    uint32_t* ts = (uint32_t*)regs->ebx;
+    if (ts[1] >= 1000000000) return;
+    timer_sleep_ns((uint64_t)ts[0] * 1000000000 + ts[1]);
+    regs->eax = 0;
+}
+
+static void sys_sleep_ms_handler(registers_t* regs) {
+    timer_sleep_ns((uint64_t)regs->ebx * 1000000);
+    regs->eax = 0;
+}
+
+// ebx = entry, ecx/edx = its two stack arguments. Returns the tid or -1.
+static void sys_thread_create_handler(registers_t* regs) {
+    regs->eax = -1;
+    if (!is_valid_user_ptr((void*)regs->ebx, 1)) return;
+    regs->eax = thread_create(regs->ebx, regs->ecx, regs->edx);
+}
+
+static void sys_thread_exit_handler(registers_t* regs) {
+    thread_exit((int)regs->ebx);
+}
+
+// ebx = tid, ecx = status (may be 0)
+static void sys_thread_join_handler(registers_t* regs) {
+    int* status = (int*)regs->ecx;
+    if (status && !is_valid_user_ptr(status, sizeof(int))) { regs->eax = -1; return; }
+    regs->eax = thread_join((int)regs->ebx, status);
+}
+
+// ebx = word, ecx = expected value, edx = timeout in ms (0: none)
+static void sys_futex_wait_handler(registers_t* regs) {
+    uint64_t timeout = (uint64_t)regs->edx * 1000000;
+    regs->eax = futex_wait((uint32_t*)regs->ebx, regs->ecx, timeout ? timeout : WAIT_FOREVER);
+}
+
+// ebx = word, ecx = how many to wake. Returns the number woken.
+static void sys_futex_wake_handler(registers_t* regs) {
+    regs->eax = futex_wake((uint32_t*)regs->ebx, (int)regs->ecx);
+}
+
+// ebx = fd, ecx = F_GETFL / F_SETFL, edx = flags
+static void sys_fcntl_handler(registers_t* regs) {
+    regs->eax = sys_fcntl((int)regs->ebx, (int)regs->ecx, (int)regs->edx);
+}
+
+// ebx = int[2]: read end, write end
+static void sys_pipe_handler(registers_t* regs) {
+    regs->eax = -1;
+    if (is_valid_user_ptr((void*)regs->ebx, 2 * sizeof(int)))
+        regs->eax = sys_pipe((int*)regs->ebx);
+}
+
+static void sys_timerfd_create_handler(registers_t* regs) {
+    regs->eax = sys_timerfd_create();
+}
+
+// ebx = fd, ecx = first expiry in ms (0: disarm), edx = period in ms (0: once)
+static void sys_timerfd_set_handler(registers_t* regs) {
+    regs->eax = sys_timerfd_set((int)regs->ebx, (uint64_t)regs->ecx * 1000000, (uint64_t)regs->edx * 1000000);
+}
+
+static void sys_epoll_create_handler(registers_t* regs) {
+    regs->eax = sys_epoll_create();
+}
+
+// ebx = epfd | op << 16, ecx = fd, edx = event (unused for EPOLL_CTL_DEL)
+static void sys_epoll_ctl_handler(registers_t* regs) {
+    const epoll_event_t* ev = (const epoll_event_t*)regs->edx;
+    regs->eax = -1;
+    if (ev && !is_valid_user_ptr((void*)ev, sizeof(epoll_event_t))) return;
+    regs->eax = sys_epoll_ctl((int)(regs->ebx & 0xFFFF), (int)(regs->ebx >> 16), (int)regs->ecx, ev);
+}
+
+// ebx = epfd | max events << 16, ecx = events, edx = timeout in ms
+// (-1: none, 0: don't wait). Returns how many are ready.
+static void sys_epoll_wait_handler(registers_t* regs) {
+    int max = (int)(regs->ebx >> 16);
+    regs->eax = -1;
+    if (!is_valid_user_ptr((void*)regs->ecx, max * sizeof(epoll_event_t))) return;
+    regs->eax = sys_epoll_wait((int)(regs->ebx & 0xFFFF), (epoll_event_t*)regs->ecx, max, (int)regs->edx);
+}
+
+// ebx = path, ecx = NULL-terminated argv (may be 0). Returns the pid or -1.
+// spawn's argv, copied into the kernel so that another thread can't swap a
+// pointer between the check here and setup_user_stack()
+typedef struct {
+    const char* argv[MAX_ARGS + 1];
+    char strings[MAX_ARGS * MAX_ARG_BYTES];
+} spawn_args_t;
+
+// Reads each user pointer and byte exactly once. Returns 0 if invalid.
+static spawn_args_t* argv_copy_in(const char* const* uargv) {
+    spawn_args_t* args = (spawn_args_t*)kmalloc(sizeof(spawn_args_t));
+    if (!args) return 0;
+    char* out = args->strings;
+    for (int i = 0; ; i++) {
+        if (i > MAX_ARGS || !is_valid_user_ptr((void*)&uargv[i], sizeof(char*))) break;
+        const char* s = uargv[i];
+        args->argv[i] = s ? out : 0;
+        if (!s) return args;
+        if (!is_valid_user_ptr((void*)s, 1)) break;
+        uint32_t n = 0;
+        while ((out[n] = s[n]) != 0 && n < MAX_ARG_BYTES - 1) n++;
+        if (out[n]) break; // Longer than MAX_ARG_BYTES
+        out += n + 1;
+    }
+    kfree(args);
+    return 0;
+}
+
+static void sys_spawn_handler(registers_t* regs) {
+    const char* path = (const char*)regs->ebx;
+    const char* const* uargv = (const char* const*)regs->ecx;
+    regs->eax = -1;
+    if (!is_valid_user_ptr((void*)path, 1)) return;
+
+    spawn_args_t* args = 0;
+    if (uargv && !(args = argv_copy_in(uargv))) return;
+    regs->eax = elf_spawn(path, args ? args->argv : 0);
+    if (args) kfree(args);
+}
+
+// 0 to the caller; a copy later restored from the file sees 1 (snapshot.c)
+static void sys_snapshot_handler(registers_t* regs) {
+    regs->eax = -1;
+    if (is_valid_user_ptr((void*)regs->ebx, 1))
+        regs->eax = snapshot_save((const char*)regs->ebx, regs);
+}
+
+// ebx = pid (0: self), ecx = nice, clamped to SCHED_NICE_MIN..MAX. User
+// processes may only raise nice; lowering it is for kernel threads.
+static void sys_setpriority_handler(registers_t* regs) {
+    int nice = (int)regs->ecx, old;
+    regs->eax = -1;
+    if (!sched_pid_is_ours((int)regs->ebx)) return;
+    if (current_process->cr3 != (uint32_t)kernel_directory &&
+        (sched_get_nice((int)regs->ebx, &old) < 0 || nice < old)) return;
+    regs->eax = sched_set_nice((int)regs->ebx, nice);
+}
+
+// ebx = pid (0: self). Returns 20 - nice (1..40) so errors stay negative.
+static void sys_getpriority_handler(registers_t* regs) {
+    int nice;
+    regs->eax = sched_get_nice((int)regs->ebx, &nice) == 0 ? 20 - nice : -1;
+}
+
+// ebx = pid (0: self), ecx = SCHED_* policy, edx = sched_attr_t (may be
+// 0 for SCHED_NORMAL). Returns 0, or -1 if refused. FIFO and DEADLINE have
+// no time slice to stop a spinning process, so only kernel threads (which
+// call sched_set_class() directly) get them.
+static void sys_sched_set_handler(registers_t* regs) {
+    sched_attr_t attr = { 0, 0, 0 };
+    regs->eax = -1;
+    if (!sched_pid_is_ours((int)regs->ebx)) return;
+    if ((int)regs->ecx != SCHED_NORMAL && current_process->cr3 != (uint32_t)kernel_directory) return;
+    if (regs->edx) {
+        if (!is_valid_user_ptr((void*)regs->edx, sizeof(sched_attr_t))) return;
+        attr = *(sched_attr_t*)regs->edx;
+    } else if ((int)regs->ecx != SCHED_NORMAL) {
+        return;
+    }
+    regs->eax = sched_set_class((int)regs->ebx, (int)regs->ecx, &attr);
+}
+
+static void sys_open_handler(registers_t* regs) {
+    regs->eax = -1;
+    if (is_valid_user_ptr((void*)regs->ebx, 1))
+        regs->eax = sys_open((const char*)regs->ebx);
+}
+
+static void sys_close_handler(registers_t* regs) {
+    sys_close((int)regs->ebx);
+}
+
+static void sys_fread_handler(registers_t* regs) {
+    regs->eax = -1;
+    if (is_valid_user_ptr((void*)regs->ecx, (int)regs->edx))
+        regs->eax = sys_read_file((int)regs->ebx, (char*)regs->ecx, (int)regs->edx);
+}
+
+static void sys_readdir_handler(registers_t* regs) {
+    regs->eax = -1;
+    if (is_valid_user_ptr((void*)regs->ecx, 32))
+        regs->eax = sys_readdir((int)regs->ebx, (char*)regs->ecx);
+}
+
+static void sys_getdents_handler(registers_t* regs) {
+    regs->eax = -1;
+    if (is_valid_user_ptr((void*)regs->ecx, (int)regs->edx))
+        regs->eax = sys_getdents((int)regs->ebx, (char*)regs->ecx, (int)regs->edx);
+}
+
+static void sys_sbrk_handler(registers_t* regs) {
+    regs->eax = (uint32_t)sys_sbrk((int)regs->ebx);
+}
+
+// Same layout as the user-side time_t; copied from the cached RTC reading
+static void sys_time_handler(registers_t* regs) {
+    regs->eax = -1;
+    if (!is_valid_user_ptr((void*)regs->ebx, sizeof(rtc_time_t))) return;
+    rtc_time_t* t = (rtc_time_t*)regs->ebx;
+    t->second = time_page->second;
+    t->minute = time_page->minute;
+    t->hour   = time_page->hour;
+    t->day    = time_page->day;
+    t->month  = time_page->month;
+    t->year   = time_page->year;
+    regs->eax = 0;
+}
+
+static void sys_write_handler(registers_t* regs) {
+    regs->eax = -1;
+    if (is_valid_user_ptr((void*)regs->ecx, (int)regs->edx))
+        regs->eax = sys_write_file((int)regs->ebx, (char*)regs->ecx, (int)regs->edx);
+}
+
+// Copies the vector into the kernel, then validates every segment of the
+// copy. Another thread can rewrite the user array at any point, so only the
+// copy may be used from here on. Returns 0 (nothing to free) if invalid.
+static struct iovec* iovec_copy_in(const struct iovec* uiov, int iovcnt) {
+    if (iovcnt < 0 || iovcnt > IOV_MAX) return 0;
+    if (!is_valid_user_ptr((void*)uiov, iovcnt * sizeof(struct iovec))) return 0;
+    // Off the heap: IOV_MAX segments would take an eighth of the kernel stack
+    struct iovec* iov = (struct iovec*)kmalloc((iovcnt ? iovcnt : 1) * sizeof(struct iovec));
+    if (!iov) return 0;
+    memcpy(iov, uiov, iovcnt * sizeof(struct iovec));
+    for (int i = 0; i < iovcnt; i++) {
+        if ((int)iov[i].len < 0 ||
+            (iov[i].len && !is_valid_user_ptr(iov[i].base, iov[i].len))) {
+            kfree(iov);
+            return 0;
+        }
+    }
+    return iov;
+}
+
+static void sys_readv_handler(registers_t* regs) {
+    regs->eax = -1;
+    struct iovec* iov = iovec_copy_in((const struct iovec*)regs->ecx, (int)regs->edx);
+    if (!iov) return;
+    regs->eax = sys_readv((int)regs->ebx, iov, (int)regs->edx);
+    kfree(iov);
+}
+
+static void sys_writev_handler(registers_t* regs) {
+    regs->eax = -1;
+    struct iovec* iov = iovec_copy_in((const struct iovec*)regs->ecx, (int)regs->edx);
+    if (!iov) return;
+    regs->eax = sys_writev((int)regs->ebx, iov, (int)regs->edx);
+    kfree(iov);
+}
+
+static void sys_seek_handler(registers_t* regs) {
+    regs->eax = sys_seek((int)regs->ebx, (int)regs->ecx, (int)regs->edx);
+}
+
+static void sys_clear_handler(registers_t* regs) {
+    term_clear();
+    regs->eax = 0;
+}
+
+static void sys_unlink_handler(registers_t* regs) {
+    regs->eax = -1;
+    if (!is_valid_user_ptr((void*)regs->ebx, 1)) return;
+    fs_delete((const char*)regs->ebx);
+    regs->eax = 0;
+}
+
+static void sys_chdir_handler(registers_t* regs) {
+    regs->eax = -1;
+    if (is_valid_user_ptr((void*)regs->ebx, 1))
+        regs->eax = sys_chdir((const char*)regs->ebx);
+}
+
+static void sys_getcwd_handler(registers_t* regs) {
+    regs->eax = -1;
+    if (!is_valid_user_ptr((void*)regs->ebx, (int)regs->ecx)) return;
+    sys_getcwd((char*)regs->ebx, (int)regs->ecx);
+    regs->eax = 0;
+}
+
+static void sys_getpid_handler(registers_t* regs) {
+    regs->eax = current_process->leader->pid;
+}
+
+// ebx = new mode, or -1 to only query. Returns the previous mode.
+static void sys_tty_mode_handler(registers_t* regs) {
+    if ((int)regs->ebx == -1) regs->eax = tty_get_mode();
+    else regs->eax = tty_set_mode((int)regs->ebx);
+}
+
+static void sys_ring_setup_handler(registers_t* regs) {
+    regs->eax = ring_setup((io_ring_t*)regs->ebx);
+}
+
+static void sys_ring_enter_handler(registers_t* regs) {
+    regs->eax = ring_enter(regs->ebx);
+}
+
+// --- Dispatch Table ---
+
+syscall_entry_t syscall_table[NUM_SYSCALLS] = {
+    [SYS_PRINT]   = { "print",   sys_print_handler },
+    [SYS_YIELD]   = { "yield",   sys_yield_handler },
+    [SYS_READ]    = { "read",    sys_read_handler },
+    [SYS_EXIT]    = { "exit",    sys_exit_handler },
+    [SYS_WAIT]    = { "wait",    sys_wait_handler },
+    [SYS_OPEN]    = { "open",    sys_open_handler },
+    [SYS_CLOSE]   = { "close",   sys_close_handler },
+    [SYS_FREAD]   = { "fread",   sys_fread_handler },
+    [SYS_READDIR] = { "readdir", sys_readdir_handler },
+    [SYS_SBRK]    = { "sbrk",    sys_sbrk_handler },
+    [SYS_TIME]    = { "time",    sys_time_handler },
+    [SYS_WRITE]   = { "write",   sys_write_handler },
+    [SYS_SEEK]    = { "seek",    sys_seek_handler },
+    [SYS_CLEAR]   = { "clear",   sys_clear_handler },
+    [SYS_UNLINK]  = { "unlink",  sys_unlink_handler },
+    [SYS_CHDIR]   = { "chdir",   sys_chdir_handler },
+    [SYS_GETCWD]  = { "getcwd",  sys_getcwd_handler },
+    [SYS_GETPID]  = { "getpid",  sys_getpid_handler },
+    [SYS_RING_SETUP] = { "ring_setup", sys_ring_setup_handler },
+    [SYS_RING_ENTER] = { "ring_enter", sys_ring_enter_handler },
+    [SYS_READV]   = { "readv",   sys_readv_handler },
+    [SYS_WRITEV]  = { "writev",  sys_writev_handler },
+    [SYS_GETDENTS] = { "getdents", sys_getdents_handler },
+    [SYS_TTY_MODE] = { "tty_mode", sys_tty_mode_handler },
+    [SYS_SPAWN]   = { "spawn",   sys_spawn_handler },
+    [SYS_SNAPSHOT] = { "snapshot", sys_snapshot_handler },
+    [SYS_SETPRIORITY] = { "setpriority", sys_setpriority_handler },
+    [SYS_GETPRIORITY] = { "getpriority", sys_getpriority_handler },
+    [SYS_SCHED_SET] = { "sched_set", sys_sched_set_handler },
+    [SYS_NANOSLEEP] = { "nanosleep", sys_nanosleep_handler },
+    [SYS_SLEEP_MS] = { "sleep_ms", sys_sleep_ms_handler },
+    [SYS_THREAD_CREATE] = { "thread_create", sys_thread_create_handler },
+    [SYS_THREAD_EXIT] = { "thread_exit", sys_thread_exit_handler },
+    [SYS_THREAD_JOIN] = { "thread_join", sys_thread_join_handler },
+    [SYS_FUTEX_WAIT] = { "futex_wait", sys_futex_wait_handler },
+    [SYS_FUTEX_WAKE] = { "futex_wake", sys_futex_wake_handler },
+    [SYS_FCNTL]   = { "fcntl",   sys_fcntl_handler },
+    [SYS_PIPE]    = { "pipe",    sys_pipe_handler },
+    [SYS_TIMERFD_CREATE] = { "timerfd_create", sys_timerfd_create_handler },
+    [SYS_TIMERFD_SET] = { "timerfd_set", sys_timerfd_set_handler },
+    [SYS_EPOLL_CREATE] = { "epoll_create", sys_epoll_create_handler },
+    [SYS_EPOLL_CTL] = { "epoll_ctl", sys_epoll_ctl_handler },
+    [SYS_EPOLL_WAIT] = { "epoll_wait", sys_epoll_wait_handler },
+};
+
+// Bucket i counts calls that took [2^(i+6), 2^(i+7)) cycles; the first
+// and last buckets are open-ended.
+static int syscall_hist_bucket(uint32_t cycles) {
+    int log2 = 31 - __builtin_clz(cycles | 1);
+    int b = log2 - 6;
+    if (b < 0) b = 0;
+    if (b >= SYSCALL_HIST_BUCKETS) b = SYSCALL_HIST_BUCKETS - 1;
+    return b;
+}
+
 void syscall_handler(registers_t* regs) {
-    switch (regs->eax) {
-        case SYS_PRINT: 
-            if (is_valid_user_ptr((void*)regs->ebx, 1)) 
-                term_print((const char*)regs->ebx);
-            break;
-            
-        case SYS_YIELD: schedule(); break;
-        
-        case SYS_READ: {
-            __asm__ volatile("cli");
-            char c = kbd_buffer_read();
-            if (c != 0) {
-                __asm__ volatile("sti");
-                regs->eax = (uint32_t)c;
-            } else {
-                process_block(1);
-                regs->eax = 0;
-                __asm__ volatile("sti");
-            }
-            break;
+    uint32_t num = regs->eax;
+    if (num >= NUM_SYSCALLS || !syscall_table[num].fn) {
+        regs->eax = (uint32_t)-1;
+        return;
+    }
+
+    syscall_entry_t* entry = &syscall_table[num];
+    entry->calls++;
+
+    if (!cpu_has_edx1(CPUID_EDX_TSC)) {
+        entry->fn(regs);
+        return;
+    }
+
+    // NOTE: Calls that block or yield include the time spent switched out
+    uint64_t start = rdtsc();
+    entry->fn(regs);
+    uint64_t elapsed = rdtsc() - start;
+
+    entry->cycles += elapsed;
+    entry->hist[syscall_hist_bucket(elapsed > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)elapsed)]++;
+}
+
+// SYSENTER path (isr_asm.S). int 0x80 comes in through isr_handler(),
+// which takes the big kernel lock itself.
+void sysenter_handler(registers_t* regs) {
+    bkl_lock();
+    syscall_handler(regs);
+    process_exit_if_killed(regs);
+    bkl_unlock();
+}
+
+// --- Statistics ---
+
+extern void term_print_dec(uint32_t n);
+extern uint64_t div_u64(uint64_t n, uint32_t d, uint32_t* rem);
+
+void syscall_reset_stats() {
+    for (int i = 0; i < NUM_SYSCALLS; i++) {
+        syscall_table[i].calls = 0;
+        syscall_table[i].cycles = 0;
+        for (int b = 0; b < SYSCALL_HIST_BUCKETS; b++) syscall_table[i].hist[b] = 0;
+    }
+}
+
+void syscall_dump_stats() {
+    term_print("\n--- Syscall Stats (cycles) ---\n");
+    for (int i = 0; i < NUM_SYSCALLS; i++) {
+        syscall_entry_t* e = &syscall_table[i];
+        if (!e->fn || e->calls == 0) continue;
+
+        term_print("  "); term_print(e->name);
+        term_print(": calls="); term_print_dec(e->calls);
+        term_print(" avg="); term_print_dec((uint32_t)div_u64(e->cycles, e->calls, 0));
+        term_print("\n    ");
+
+        for (int b = 0; b < SYSCALL_HIST_BUCKETS; b++) {
+            if (!e->hist[b]) continue;
+            term_print(b == SYSCALL_HIST_BUCKETS - 1 ? ">=" : "<");
+            term_print_dec(b == SYSCALL_HIST_BUCKETS - 1 ? (1u << (b + 6)) : (1u << (b + 7)));
+            term_print(":"); term_print_dec(e->hist[b]);
+            term_print(" ");
         }
-        
-        case SYS_EXIT: process_exit((int)regs->ebx); break;
-        case SYS_WAIT: regs->eax = process_wait((int)regs->ebx, (int*)regs->ecx); break;
-        
-        case SYS_OPEN: 
-            if (is_valid_user_ptr((void*)regs->ebx, 1))
-                regs->eax = sys_open((const char*)regs->ebx);
-            break;
-            
-        case SYS_CLOSE: sys_close((int)regs->ebx); break;
-        
-        case SYS_FREAD: 
-            if (is_valid_user_ptr((void*)regs->ecx, (int)regs->edx))
-                regs->eax = sys_read_file((int)regs->ebx, (char*)regs->ecx, (int)regs->edx);
-            break;
-            
-        case SYS_READDIR: 
-             if (is_valid_user_ptr((void*)regs->ecx, 32))
-                regs->eax = sys_readdir((int)regs->ebx, (char*)regs->ecx);
-            break;
-             
-        case SYS_SBRK: regs->eax = (uint32_t)sys_sbrk((int)regs->ebx); break;
-        
-        case SYS_WRITE: 
-            if (is_valid_user_ptr((void*)regs->ecx, (int)regs->edx))
-                regs->eax = sys_write_file((int)regs->ebx, (char*)regs->ecx, (int)regs->edx);
-            break;
-        
-        case 13: term_clear(); regs->eax = 0; break;
-        case 14: 
-            if (is_valid_user_ptr((void*)regs->ebx, 1))
-                fs_delete((const char*)regs->ebx);
-            regs->eax = 0; 
-            break;
-            
-        case 15: 
-            if (is_valid_user_ptr((void*)regs->ebx, 1))
-                regs->eax = sys_chdir((const char*)regs->ebx);
-            break;
-        case 16: 
-            if (is_valid_user_ptr((void*)regs->ebx, (int)regs->ecx))
-                sys_getcwd((char*)regs->ebx, (int)regs->ecx);
-            break;
+        term_print("\n");
     }
-}
\ No newline at end of file
+    term_print("------------------------------\n");
+}
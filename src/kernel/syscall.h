@@ -7,24 +7,76 @@
 
 // Syscall ID numbers
 
-#define SYS_PRINT 0
-#define SYS_YIELD 1
-#define SYS_READ  2
-#define SYS_EXIT  3
-#define SYS_WAIT  4
-#define SYS_SBRK  9
+#define SYS_PRINT   0
+#define SYS_YIELD   1
+#define SYS_READ    2
+#define SYS_EXIT    3
+#define SYS_WAIT    4
 #define SYS_OPEN    5
 #define SYS_CLOSE   6
 #define SYS_FREAD   7  // "FREAD" to avoid conflict with keyboard READ
 #define SYS_READDIR 8
-#define SYS_WRITE 11
-#define SYS_SEEK 12
-#define SYS_IOCTL 13
+#define SYS_SBRK    9
+#define SYS_TIME    10 // Normally served from the time page; kept for old binaries
+#define SYS_WRITE   11
+#define SYS_SEEK    12
+#define SYS_CLEAR   13
+#define SYS_UNLINK  14
+#define SYS_CHDIR   15
+#define SYS_GETCWD  16
+#define SYS_GETPID  17
+#define SYS_RING_SETUP 18
+#define SYS_RING_ENTER 19
+#define SYS_READV   20
+#define SYS_WRITEV  21
+#define SYS_GETDENTS 22
+#define SYS_TTY_MODE 23
+#define SYS_SPAWN   24
+#define SYS_SNAPSHOT 25
+#define SYS_SETPRIORITY 26
+#define SYS_GETPRIORITY 27
+#define SYS_SCHED_SET 28
+#define SYS_NANOSLEEP 29
+#define SYS_SLEEP_MS 30
+#define SYS_THREAD_CREATE 31
+#define SYS_THREAD_EXIT 32
+#define SYS_THREAD_JOIN 33
+#define SYS_FUTEX_WAIT 34
+#define SYS_FUTEX_WAKE 35
+#define SYS_FCNTL   36
+#define SYS_PIPE    37
+#define SYS_TIMERFD_CREATE 38
+#define SYS_TIMERFD_SET 39
+#define SYS_EPOLL_CREATE 40
+#define SYS_EPOLL_CTL 41
+#define SYS_EPOLL_WAIT 42
+
+#define NUM_SYSCALLS 64
+#define SYSCALL_HIST_BUCKETS 16
+
+typedef void (*syscall_fn_t)(registers_t* regs);
+
+// One slot per syscall number: handler plus its own counters
+typedef struct {
+    const char* name;
+    syscall_fn_t fn;
+    uint32_t calls;
+    uint64_t cycles;                      // Total TSC cycles spent in fn
+    uint32_t hist[SYSCALL_HIST_BUCKETS];  // log2 latency histogram
+} syscall_entry_t;
+
+extern syscall_entry_t syscall_table[NUM_SYSCALLS];
 
 // The dispatcher function called by the Interrupt Handler
 void syscall_handler(registers_t* regs);
+void sysenter_handler(registers_t* regs);   // Same, from the SYSENTER stub
 
 // Initialization
 void init_syscalls();
+void syscall_init_cpu();                    // SYSENTER MSRs, on each CPU
+
+// Statistics (shell: 'sysstat', 'sysstat reset')
+void syscall_dump_stats();
+void syscall_reset_stats();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,287 @@
+/* src/kernel/timer.c */
+#include "timer.h"
+#include "clock.h"
+#include "process.h"
+#include "sched.h"
+#include "wait.h"
+#include "../cpu/lapic.h"
+#include "../cpu/irq.h"
+#include "../drivers/pit.h"
+#include "../drivers/serial.h"
+
+extern uint64_t div_u64(uint64_t n, uint32_t d, uint32_t* rem);
+
+static int use_lapic = 0;
+static uint32_t timer_hz = 0;
+static uint32_t tick_ns = 0;        // Periodic interval
+
+// Idle one-shot in flight: the next timer interrupt ends it
+static int oneshot = 0;
+static uint64_t oneshot_ns = 0;
+static volatile int idling = 0;
+
+// --- Hardware ---
+
+static void timer_arm_periodic() {
+    if (use_lapic) {
+        tick_ns = lapic_timer_periodic(timer_hz);
+    } else {
+        uint32_t divisor = pit_set_periodic(timer_hz);
+        tick_ns = (uint32_t)div_u64(1000000000ULL * divisor, PIT_BASE_HZ, 0);
+    }
+}
+
+static void timer_arm_oneshot(uint64_t ns) {
+    if (use_lapic) {
+        oneshot_ns = lapic_timer_oneshot(ns);
+    } else {
+        uint32_t count = pit_set_oneshot((uint32_t)div_u64(ns * PIT_BASE_HZ, 1000000000, 0));
+        oneshot_ns = div_u64(1000000000ULL * count, PIT_BASE_HZ, 0);
+    }
+    oneshot = 1;
+}
+
+// How far the one-shot got before something else woke us
+static uint64_t timer_oneshot_elapsed() {
+    if (use_lapic) return lapic_timer_elapsed_ns();
+    uint64_t total = div_u64(oneshot_ns * PIT_BASE_HZ, 1000000000, 0);
+    uint32_t left = pit_read_count();
+    if (left > total) left = total;
+    return div_u64((total - left) * 1000000000ULL, PIT_BASE_HZ, 0);
+}
+
+// --- Timer Wheel ---
+
+static timer_event_t* wheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+static uint64_t wheel_occupied[TIMER_WHEEL_LEVELS]; // Bit per non-empty slot
+static uint64_t wheel_now = 0;      // Last unit processed
+static uint32_t wheel_count = 0;
+
+#define WHEEL_SPAN(level) (1ULL << (TIMER_WHEEL_BITS * (level)))
+
+// Offset from 'from' of the first set bit, wrapping around; -1 if none
+static int wheel_find(uint64_t bits, int from) {
+    uint64_t rot = from ? (bits >> from) | (bits << (TIMER_WHEEL_SLOTS - from)) : bits;
+    if (!rot) return -1;
+    uint32_t lo = (uint32_t)rot;
+    return lo ? __builtin_ctz(lo) : 32 + __builtin_ctz((uint32_t)(rot >> 32));
+}
+
+static void wheel_insert(timer_event_t* ev) {
+    uint64_t expires = ev->expires;
+    if (expires <= wheel_now) expires = wheel_now + 1;
+    uint64_t delta = expires - wheel_now;
+
+    int level = 0;
+    while (level < TIMER_WHEEL_LEVELS - 1 && delta >= WHEEL_SPAN(level + 1)) level++;
+    // Beyond the last level: parked in its furthest slot, re-filed from there
+    if (delta >= WHEEL_SPAN(TIMER_WHEEL_LEVELS)) expires = wheel_now + WHEEL_SPAN(TIMER_WHEEL_LEVELS) - 1;
+
+    int slot = (expires >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1);
+    timer_event_t** head = &wheel[level][slot];
+    ev->next = *head;
+    if (*head) (*head)->pprev = &ev->next;
+    *head = ev;
+    ev->pprev = head;
+    ev->level = level;
+    ev->slot = slot;
+    wheel_occupied[level] |= 1ULL << slot;
+    wheel_count++;
+}
+
+static void wheel_remove(timer_event_t* ev) {
+    *ev->pprev = ev->next;
+    if (ev->next) ev->next->pprev = ev->pprev;
+    ev->pprev = 0;
+    if (!wheel[ev->level][ev->slot]) wheel_occupied[ev->level] &= ~(1ULL << ev->slot);
+    wheel_count--;
+}
+
+// Next unit at which something happens: a level-0 slot comes due or a
+// higher slot cascades. ~0 if the wheel is empty.
+static uint64_t wheel_next() {
+    uint64_t next = ~0ULL;
+    if (!wheel_count) return next;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        uint64_t cur = wheel_now >> (TIMER_WHEEL_BITS * level);
+        int off = wheel_find(wheel_occupied[level], (cur + 1) & (TIMER_WHEEL_SLOTS - 1));
+        if (off < 0) continue;
+        uint64_t at = (cur + 1 + off) << (TIMER_WHEEL_BITS * level);
+        if (at < next) next = at;
+    }
+    return next;
+}
+
+static void wheel_cascade(int level, int slot) {
+    timer_event_t* ev = wheel[level][slot];
+    while (ev) {
+        timer_event_t* next = ev->next;
+        wheel_remove(ev);
+        wheel_insert(ev);
+        ev = next;
+    }
+}
+
+// Run everything due by now, jumping straight over empty stretches
+static void wheel_run(uint64_t now_ns) {
+    uint64_t target = div_u64(now_ns, TIMER_WHEEL_RES_NS, 0);
+    while (wheel_now < target) {
+        uint64_t next = wheel_next();
+        if (next > target) { wheel_now = target; return; }
+        wheel_now = next;
+
+        for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if (wheel_now & (WHEEL_SPAN(level) - 1)) break;
+            wheel_cascade(level, (wheel_now >> (TIMER_WHEEL_BITS * level)) & (TIMER_WHEEL_SLOTS - 1));
+        }
+
+        // Events re-added from fn land in a later slot
+        timer_event_t** head = &wheel[0][wheel_now & (TIMER_WHEEL_SLOTS - 1)];
+        while (*head) {
+            timer_event_t* ev = *head;
+            wheel_remove(ev);
+            ev->fn(ev);
+        }
+    }
+}
+
+void timer_event_add(timer_event_t* ev, uint64_t deadline_ns, void (*fn)(timer_event_t*), void* data) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    if (ev->pprev) wheel_remove(ev);
+    // Rounded up: never early
+    ev->expires = div_u64(deadline_ns + TIMER_WHEEL_RES_NS - 1, TIMER_WHEEL_RES_NS, 0);
+    ev->fn = fn;
+    ev->data = data;
+    wheel_insert(ev);
+    timer_wake_idle();
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+void timer_event_cancel(timer_event_t* ev) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    if (ev->pprev) wheel_remove(ev);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+static void timer_run_events(uint64_t now) {
+    sched_replenish(now);
+    wheel_run(now);
+}
+
+static uint64_t timer_next_deadline() {
+    uint64_t next = sched_next_replenish();
+    uint64_t unit = wheel_next();
+    if (unit != ~0ULL && unit * TIMER_WHEEL_RES_NS < next) next = unit * TIMER_WHEEL_RES_NS;
+    return next;
+}
+
+void timer_sleep_until(uint64_t deadline_ns) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    wait_queue_wait_killable(0, deadline_ns);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+void timer_sleep_ns(uint64_t ns) {
+    timer_sleep_until(clock_now_ns() + ns);
+}
+
+// --- Interrupt & Idle ---
+
+int timer_interrupt() {
+    if (this_cpu()->id != 0) return 1;
+
+    uint64_t elapsed = tick_ns;
+    if (oneshot) {
+        elapsed = oneshot_ns;
+        oneshot = 0;
+        timer_arm_periodic();
+    }
+    clock_tick((uint32_t)elapsed);
+    timer_run_events(clock_now_ns());
+    // An idle CPU schedules from its idle loop as soon as hlt returns
+    return !idling;
+}
+
+void timer_idle() {
+    // The other CPUs just wait for their next tick or an IPI
+    if (this_cpu()->id != 0) {
+        bkl_halt();
+        __asm__ volatile("sti");
+        return;
+    }
+
+    uint64_t now = clock_now_ns();
+    uint64_t deadline = timer_next_deadline();
+    if (deadline <= now) {
+        timer_run_events(now);
+        __asm__ volatile("sti");
+        return;
+    }
+
+    uint64_t wait = deadline - now;
+    if (wait > TIMER_IDLE_MAX_NS) wait = TIMER_IDLE_MAX_NS;
+    // Never shorter than one tick: a deadline that close is served by it
+    if (wait > tick_ns) timer_arm_oneshot(wait);
+
+    idling = 1;
+    bkl_halt();
+    idling = 0;
+
+    if (oneshot) {
+        // Woken early by another interrupt
+        uint64_t elapsed = timer_oneshot_elapsed();
+        oneshot = 0;
+        timer_arm_periodic();
+        clock_tick((uint32_t)elapsed);
+        timer_run_events(clock_now_ns());
+    }
+    __asm__ volatile("sti");
+}
+
+// The boot CPU may be halted on a one-shot that ends after whatever was
+// just added; its idle loop re-plans when woken
+void timer_wake_idle() {
+    if (idling && this_cpu()->id != 0) smp_send_resched(0);
+}
+
+// --- Configuration ---
+
+int timer_set_hz(uint32_t hz) {
+    if (hz < TIMER_MIN_HZ || hz > TIMER_MAX_HZ) return -1;
+
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    timer_hz = hz;
+    oneshot = 0;
+    timer_arm_periodic();
+    clock_set_tick_ns(tick_ns);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return 0;
+}
+
+uint32_t timer_get_hz() {
+    return timer_hz;
+}
+
+const char* timer_source_name() {
+    return use_lapic ? "LAPIC" : "PIT";
+}
+
+void init_timer() {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+
+    use_lapic = init_lapic();
+    if (use_lapic) {
+        // The PIT keeps counting but its IRQ 0 is masked
+        irq_mask(IRQ_TIMER);
+    }
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+
+    timer_set_hz(TIMER_DEFAULT_HZ);
+    serial_log(use_lapic ? " [TIMER] LAPIC timer, tickless idle.\n"
+                         : " [TIMER] PIT timer, tickless idle.\n");
+}
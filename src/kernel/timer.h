@@ -0,0 +1,55 @@
+/* src/kernel/timer.h */
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+
+// Scheduler tick and timed sleeps. The tick comes from the local APIC
+// timer when there is one, the PIT otherwise. While nothing is runnable
+// the tick is stopped: the timer is armed once for the next sleeper's
+// deadline and the CPU halts (tickless idle).
+//
+// Only the boot CPU keeps time and runs timer events. The other CPUs'
+// APIC timers tick periodically at the rate set at boot and only drive
+// their own schedulers.
+
+#define TIMER_DEFAULT_HZ 100
+#define TIMER_MIN_HZ     19    // PIT divisor limit
+#define TIMER_MAX_HZ     10000
+
+#define TIMER_IDLE_MAX_NS 1000000000ULL // Longest idle one-shot
+
+// Kernel timer events sit on a hierarchical timing wheel: 4 levels of 64
+// slots, 1ms / 64ms / 4.1s / 262s apart. Adding and cancelling are O(1);
+// an event is re-filed one level down as its time gets closer and runs
+// from the timer interrupt (interrupts off) at or after its deadline.
+#define TIMER_WHEEL_RES_NS 1000000ULL
+#define TIMER_WHEEL_BITS   6
+#define TIMER_WHEEL_SLOTS  (1 << TIMER_WHEEL_BITS)
+#define TIMER_WHEEL_LEVELS 4
+
+typedef struct timer_event {
+    uint64_t expires;                   // In TIMER_WHEEL_RES_NS units
+    void (*fn)(struct timer_event* ev);
+    void* data;
+    struct timer_event* next;
+    struct timer_event** pprev;         // 0 while not pending
+    uint8_t level;
+    uint8_t slot;
+} timer_event_t;
+
+void init_timer();
+int timer_set_hz(uint32_t hz);          // 0 on success
+uint32_t timer_get_hz();
+const char* timer_source_name();
+
+int timer_interrupt();                  // 1 if the scheduler should run
+void timer_idle();                      // Interrupts off on entry, on at return
+void timer_wake_idle();                 // Something new is due: an idle boot CPU re-arms
+void timer_sleep_until(uint64_t deadline_ns);
+void timer_sleep_ns(uint64_t ns);
+
+void timer_event_add(timer_event_t* ev, uint64_t deadline_ns, void (*fn)(timer_event_t*), void* data);
+void timer_event_cancel(timer_event_t* ev); // No-op if it already ran
+
+#endif
@@ -0,0 +1,84 @@
+/* src/kernel/timerfd.c */
+#include "timerfd.h"
+#include "process.h"
+#include "clock.h"
+#include "memops.h"
+#include "../mm/heap.h"
+
+timerfd_t* timerfd_create() {
+    timerfd_t* t = (timerfd_t*)kmalloc(sizeof(timerfd_t));
+    if (!t) return 0;
+    memset(t, 0, sizeof(timerfd_t));
+    wait_queue_init(&t->readers);
+    return t;
+}
+
+// Timer interrupt. Periods that went by unnoticed count too.
+static void timerfd_expire(timer_event_t* ev) {
+    timerfd_t* t = (timerfd_t*)ev->data;
+    uint64_t now = clock_now_ns();
+    do {
+        t->expirations++;
+        t->next_ns += t->interval_ns;
+    } while (t->interval_ns && t->next_ns <= now);
+    if (t->interval_ns) timer_event_add(&t->event, t->next_ns, timerfd_expire, t);
+
+    wait_queue_wake_all(&t->readers);
+    poll_wake(&t->poll, EPOLLIN);
+}
+
+void timerfd_set(timerfd_t* t, uint64_t first_ns, uint64_t interval_ns) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+
+    timer_event_cancel(&t->event);
+    t->expirations = 0;
+    t->interval_ns = interval_ns;
+    if (first_ns) {
+        t->next_ns = clock_now_ns() + first_ns;
+        timer_event_add(&t->event, t->next_ns, timerfd_expire, t);
+    }
+
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+int timerfd_read(timerfd_t* t, char* buf, int size, int nonblock) {
+    if (size < (int)sizeof(uint32_t)) return -1;
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+
+    int n = sizeof(uint32_t);
+    t->busy++;
+    while (t->expirations == 0) {
+        if (nonblock || t->closed || wait_queue_wait_killable(&t->readers, 0) != WAIT_WOKEN) {
+            n = nonblock && !t->closed ? FD_WOULD_BLOCK : -1;
+            break;
+        }
+    }
+    if (n > 0) {
+        memcpy(buf, &t->expirations, sizeof(uint32_t));
+        t->expirations = 0;
+    }
+    if (--t->busy == 0 && t->closed) kfree(t);
+
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return n;
+}
+
+// Another thread may still be asleep in timerfd_read(): it gets -1 and
+// frees the timer on its way out
+void timerfd_close(timerfd_t* t) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    timer_event_cancel(&t->event);
+    poll_head_detach(&t->poll);
+    t->closed = 1;
+    wait_queue_wake_all(&t->readers);
+    if (t->busy == 0) kfree(t);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+uint32_t timerfd_poll(timerfd_t* t, poll_head_t** head) {
+    if (head) *head = &t->poll;
+    return t->expirations ? EPOLLIN : 0;
+}
@@ -0,0 +1,31 @@
+/* src/kernel/timerfd.h */
+#ifndef TIMERFD_H
+#define TIMERFD_H
+
+#include <stdint.h>
+#include "wait.h"
+#include "timer.h"
+#include "epoll.h"
+
+// A timer event behind a descriptor, so timeouts can be waited for with
+// everything else. It becomes readable when it expires; a read returns
+// the uint32_t number of expirations since the last read.
+
+typedef struct timerfd {
+    timer_event_t event;
+    uint64_t next_ns;           // Next expiry while armed
+    uint64_t interval_ns;       // 0: one-shot
+    uint32_t expirations;       // Since the last read
+    int closed;                 // Freed once the last reader has left
+    int busy;                   // Readers inside timerfd_read()
+    wait_queue_t readers;
+    poll_head_t poll;
+} timerfd_t;
+
+timerfd_t* timerfd_create();    // Disarmed
+void timerfd_set(timerfd_t* t, uint64_t first_ns, uint64_t interval_ns); // first_ns 0: disarm
+int timerfd_read(timerfd_t* t, char* buf, int size, int nonblock);
+void timerfd_close(timerfd_t* t);
+uint32_t timerfd_poll(timerfd_t* t, poll_head_t** head);
+
+#endif
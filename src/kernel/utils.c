@@ -38,13 +38,6 @@ void serial_print_dec(uint32_t n) {
     
     serial_log(&buffer[i + 1]);
 }
-int strlen(const char* str) {
-    int len = 0;
-    while (str[len])
-        len++;
-    return len;
-}
-
 int strcmp(const char* s1, const char* s2) {
     while (*s1 && (*s1 == *s2)) {
         s1++;
@@ -60,4 +53,16 @@ void strcpy_safe(char* dest, const char* src) {
         i++;
     }
     dest[i] = 0; // Null terminate
-}
\ No newline at end of file
+}
+
+// 64-by-32 division without libgcc's __udivdi3: two DIVs, high word first
+uint64_t div_u64(uint64_t n, uint32_t d, uint32_t* rem) {
+    uint32_t hi = (uint32_t)(n >> 32);
+    uint32_t lo = (uint32_t)n;
+    uint32_t q_hi = hi / d;
+    uint32_t r = hi % d;
+    uint32_t q_lo;
+    __asm__("divl %4" : "=a"(q_lo), "=d"(r) : "a"(lo), "d"(r), "rm"(d));
+    if (rem) *rem = r;
+    return ((uint64_t)q_hi << 32) | q_lo;
+}
@@ -0,0 +1,112 @@
+/* src/kernel/wait.c */
+#include "wait.h"
+#include "process.h"
+#include "sched.h"
+#include "clock.h"
+#include "timer.h"
+
+void wait_queue_init(wait_queue_t* wq) {
+    wq->head = 0;
+    wq->tail = 0;
+}
+
+static void wait_unlink(process_t* p) {
+    wait_queue_t* wq = p->wait_queue;
+    if (!wq) return;
+    if (p->wait_prev) p->wait_prev->wait_next = p->wait_next;
+    else wq->head = p->wait_next;
+    if (p->wait_next) p->wait_next->wait_prev = p->wait_prev;
+    else wq->tail = p->wait_prev;
+    p->wait_next = p->wait_prev = 0;
+    p->wait_queue = 0;
+}
+
+static void wait_timer_fn(timer_event_t* ev) {
+    wait_timeout((process_t*)ev->data);
+}
+
+static int wait_sleep(wait_queue_t* wq, uint64_t deadline_ns, int killable) {
+    process_t* p = current_process;
+    if (deadline_ns && clock_now_ns() >= deadline_ns) return WAIT_TIMEOUT;
+    if (killable && p->killed) return WAIT_KILLED;
+
+    if (wq) {
+        p->wait_next = 0;
+        p->wait_prev = wq->tail;
+        if (wq->tail) wq->tail->wait_next = p;
+        else wq->head = p;
+        wq->tail = p;
+    }
+    p->wait_queue = wq;
+    if (deadline_ns) timer_event_add(&p->wait_timer, deadline_ns, wait_timer_fn, p);
+    p->wait_result = WAIT_TIMEOUT;
+    p->wait_killable = killable;
+    p->state = PROCESS_BLOCKED;
+
+    // schedule() only comes back once we are picked again
+    do {
+        schedule();
+        __asm__ volatile("cli");
+    } while (p->state == PROCESS_BLOCKED);
+    p->wait_killable = 0;
+    return p->wait_result;
+}
+
+int wait_queue_wait_until(wait_queue_t* wq, uint64_t deadline_ns) {
+    return wait_sleep(wq, deadline_ns, 0);
+}
+
+int wait_queue_wait_killable(wait_queue_t* wq, uint64_t deadline_ns) {
+    return wait_sleep(wq, deadline_ns, 1);
+}
+
+int wait_queue_wait(wait_queue_t* wq, uint64_t timeout_ns) {
+    if (timeout_ns == WAIT_FOREVER) return wait_queue_wait_until(wq, 0);
+    return wait_queue_wait_until(wq, clock_now_ns() + timeout_ns);
+}
+
+static void wait_wake(process_t* p, int result) {
+    wait_unlink(p);
+    timer_event_cancel(&p->wait_timer);
+    p->wait_result = result;
+    sched_make_ready(p);
+}
+
+void wait_queue_wake_one(wait_queue_t* wq) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    if (wq->head) wait_wake(wq->head, WAIT_WOKEN);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+void wait_queue_wake_all(wait_queue_t* wq) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    while (wq->head) wait_wake(wq->head, WAIT_WOKEN);
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+}
+
+int wait_queue_wake_key(wait_queue_t* wq, uint32_t key, int n) {
+    uint32_t eflags;
+    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    int woken = 0;
+    process_t* p = wq->head;
+    while (p && woken < n) {
+        process_t* next = p->wait_next;
+        if (p->wait_key == key) {
+            wait_wake(p, WAIT_WOKEN);
+            woken++;
+        }
+        p = next;
+    }
+    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    return woken;
+}
+
+void wait_timeout(process_t* p) {
+    if (p->state == PROCESS_BLOCKED) wait_wake(p, WAIT_TIMEOUT);
+}
+
+void wait_kill(process_t* p) {
+    if (p->state == PROCESS_BLOCKED && p->wait_killable) wait_wake(p, WAIT_KILLED);
+}
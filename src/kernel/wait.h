@@ -0,0 +1,51 @@
+/* src/kernel/wait.h */
+#ifndef WAIT_H
+#define WAIT_H
+
+#include <stdint.h>
+
+// Wait queues live inside whatever is being waited on (the TTY's input,
+// a process's exit, the disk). Waiters are linked through their process_t,
+// so waking one is O(1) and any number may wait on the same queue.
+//
+// The usual pattern, with interrupts off across check and wait so a
+// wakeup cannot slip in between:
+//
+//     while (!condition)
+//         if (wait_queue_wait(&wq, timeout) == WAIT_TIMEOUT) break;
+
+#define WAIT_WOKEN   0
+#define WAIT_TIMEOUT (-1)
+#define WAIT_KILLED  (-2)   // Killable waits only: our process is exiting
+
+#define WAIT_FOREVER 0
+
+struct process;
+
+typedef struct wait_queue {
+    struct process* head;       // Linked through ->wait_next / ->wait_prev
+    struct process* tail;
+} wait_queue_t;
+
+#define WAIT_QUEUE_INIT { 0, 0 }
+
+void wait_queue_init(wait_queue_t* wq);
+
+// Interrupts must be off; they are off again on return. wq may be 0 to
+// just sleep until the deadline. Returns WAIT_WOKEN or WAIT_TIMEOUT.
+int wait_queue_wait(wait_queue_t* wq, uint64_t timeout_ns);   // WAIT_FOREVER: no timeout
+int wait_queue_wait_until(wait_queue_t* wq, uint64_t deadline_ns);
+
+// For waits on behalf of user code that may last indefinitely (input, a
+// child, a thread, a sleep): also ends with WAIT_KILLED once another
+// thread is tearing the process down (process_exit). Kernel-internal
+// waits, e.g. for a lock someone holds, must not use it.
+int wait_queue_wait_killable(wait_queue_t* wq, uint64_t deadline_ns);
+
+void wait_queue_wake_one(wait_queue_t* wq);
+void wait_queue_wake_all(wait_queue_t* wq);
+int wait_queue_wake_key(wait_queue_t* wq, uint32_t key, int n); // Up to n with this wait_key; returns how many
+void wait_timeout(struct process* p);   // Deadline passed
+void wait_kill(struct process* p);      // Ends a killable wait with WAIT_KILLED
+
+#endif
@@ -1,5 +1,6 @@
 /* src/mm/heap.c */
 #include "heap.h"
+#include "../kernel/sync.h"
 
 extern void* pmm_alloc_block();
 extern void vmm_map_page(void* phys, void* virt, int flags); 
@@ -16,6 +17,7 @@ typedef struct alloc_header {
 } alloc_header_t;
 
 alloc_header_t* free_list_head = 0;
+static spinlock_t heap_lock = SPINLOCK_INIT("heap");
 
 void init_heap() {
     void* heap_start = (void*)HEAP_START;
@@ -35,9 +37,8 @@ void init_heap() {
 }
 
 void* kmalloc(size_t size) {
-    uint32_t eflags;
-    // Save interrupt state and disable
-    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
+    // Interrupt handlers allocate too
+    uint32_t eflags = spin_lock_irqsave(&heap_lock);
 
     if (size % 4 != 0) size += (4 - (size % 4));
     alloc_header_t* current = free_list_head;
@@ -53,16 +54,14 @@ void* kmalloc(size_t size) {
                 current->next = new_block;
             }
             current->is_free = 0;
-            
-            // Restore interrupt state
-            __asm__ volatile("push %0; popf" : : "r"(eflags));
+
+            spin_unlock_irqrestore(&heap_lock, eflags);
             return (void*)((uint32_t)current + sizeof(alloc_header_t));
         }
         current = current->next;
     }
-    
-    // Restore interrupt state
-    __asm__ volatile("push %0; popf" : : "r"(eflags));
+
+    spin_unlock_irqrestore(&heap_lock, eflags);
     return 0;
 }
 
@@ -80,14 +79,11 @@ void heap_coalesce() {
 
 void kfree(void* ptr) {
     if (!ptr) return;
-    uint32_t eflags;
-    // Save interrupt state and disable
-    __asm__ volatile("pushf; pop %0; cli" : "=r"(eflags));
-    
+    uint32_t eflags = spin_lock_irqsave(&heap_lock);
+
     alloc_header_t* header = (alloc_header_t*)((uint32_t)ptr - sizeof(alloc_header_t));
     header->is_free = 1;
     heap_coalesce();
 
-    // Restore interrupt state
-    __asm__ volatile("push %0; popf" : : "r"(eflags));
+    spin_unlock_irqrestore(&heap_lock, eflags);
 }
\ No newline at end of file
@@ -5,6 +5,8 @@ extern void *pmm_alloc_block();
 extern void pmm_free_block(void *p);
 extern void serial_log(char *str);
 extern void *memset(void *ptr, int value, uint32_t num);
+extern void *memcpy(void *dest, const void *src, uint32_t n);
+extern void smp_tlb_shootdown(uint32_t cr3);
 
 page_directory_t *current_directory = 0;
 page_directory_t *kernel_directory = 0;
@@ -20,6 +22,7 @@ void vmm_load_pd(uint32_t *addr)
     uint32_t cr0;
     __asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
     cr0 |= 0x80000000; // Enable Paging
+    cr0 |= 0x00010000; // WP: the kernel honours read-only user pages too, so its writes trigger copy-on-write
     __asm__ volatile("mov %0, %%cr0" ::"r"(cr0));
 }
 
@@ -51,7 +54,8 @@ void vmm_map_page_in_dir(page_directory_t *dir, void *phys, void *virt, int flag
     uint32_t *pt_virt = (uint32_t *)pt_phys; // NOTE: In a real higher-half kernel, we would need to map this temporarily.
                                              // Since we identity map low memory, this works for now.
 
-    pt_virt[ptindex] = ((uint32_t)phys) | I86_PTE_PRESENT | I86_PTE_WRITABLE | flags;
+    // Writable is up to the caller so read-only user pages are possible
+    pt_virt[ptindex] = ((uint32_t)phys) | I86_PTE_PRESENT | flags;
 
     if (dir == current_directory)
     {
@@ -59,6 +63,51 @@ void vmm_map_page_in_dir(page_directory_t *dir, void *phys, void *virt, int flag
     }
 }
 
+uint32_t vmm_get_pte_in_dir(page_directory_t *dir, void *virt)
+{
+    uint32_t pde = dir->tablesPhysical[(uint32_t)virt >> 22];
+    if (!(pde & I86_PTE_PRESENT))
+        return 0;
+    uint32_t *pt = (uint32_t *)(pde & 0xFFFFF000);
+    return pt[((uint32_t)virt >> 12) & 0x03FF];
+}
+
+// Page fault on a copy-on-write page (present + write): give the current
+// address space a private, writable copy. The shared frame stays with its
+// owner (see snapshot.c).
+int vmm_handle_cow_fault(uint32_t addr, uint32_t err_code)
+{
+    if ((err_code & 0x3) != 0x3)
+        return 0;
+
+    page_directory_t *dir = (page_directory_t *)get_cr3();
+    uint32_t pde = dir->tablesPhysical[addr >> 22];
+    if (!(pde & I86_PTE_PRESENT))
+        return 0;
+    uint32_t *pte = &((uint32_t *)(pde & 0xFFFFF000))[(addr >> 12) & 0x03FF];
+
+    // Another thread got here first (the big kernel lock had us wait) and
+    // copied the page: our TLB may still have the read-only entry
+    uint32_t need = I86_PTE_PRESENT | I86_PTE_WRITABLE | ((err_code & 0x4) ? I86_PTE_USER : 0);
+    if (!(*pte & I86_PTE_COW) && (*pte & need) == need)
+    {
+        vmm_flush_tlb_entry((void *)(addr & 0xFFFFF000));
+        return 1;
+    }
+    if (!(*pte & I86_PTE_COW))
+        return 0;
+
+    void *frame = pmm_alloc_block();
+    if (!frame)
+        return 0;
+    memcpy(frame, (void *)(*pte & 0xFFFFF000), PAGE_SIZE);
+    *pte = (uint32_t)frame | I86_PTE_PRESENT | I86_PTE_WRITABLE | I86_PTE_USER;
+    vmm_flush_tlb_entry((void *)(addr & 0xFFFFF000));
+    // Threads on other CPUs would go on reading the old frame
+    smp_tlb_shootdown((uint32_t)dir);
+    return 1;
+}
+
 void vmm_map_page(void *phys, void *virt, int flags)
 {
     vmm_map_page_in_dir(current_directory, phys, virt, flags);
@@ -68,23 +117,36 @@ page_directory_t *vmm_create_address_space()
 {
     page_directory_t *new_pd = (page_directory_t *)pmm_alloc_block();
     memset(new_pd, 0, sizeof(page_directory_t));
-    // Copy Kernel Identity Mappings (0-128MB)
+    // Share every kernel table: identity map (0-128MB), heap, framebuffer and the time page.
     // Critical: We share kernel tables, we do NOT copy the pages themselves, just the pointers to tables.
-    for (int i = 0; i < 32; i++)
+    // NOTE: Tables the kernel creates after this point are not propagated.
+    for (int i = 0; i < 1024; i++)
     {
         new_pd->tablesPhysical[i] = kernel_directory->tablesPhysical[i];
     }
     return new_pd;
 }
 
-// --- FIX: Added Cleanup Function ---
-void vmm_free_address_space(page_directory_t *pd)
+// The CPU sets Accessed/Dirty in whichever directory it walks, so a
+// process's copy of a kernel PDE need not match bit for bit: compare
+// the tables only
+int vmm_pde_is_kernel(page_directory_t *pd, uint32_t i)
+{
+    uint32_t kernel = kernel_directory->tablesPhysical[i];
+    return (kernel & I86_PTE_PRESENT) && (pd->tablesPhysical[i] & 0xFFFFF000) == (kernel & 0xFFFFF000);
+}
+
+// Free every user page and page table, leaving only the shared kernel
+// tables. The directory can then be handed to a new process as-is.
+void vmm_clear_user_space(page_directory_t *pd)
 {
     // 1. Loop through all Page Directory Entries
-    // Start at 32 to skip Kernel Identity map (0-128MB)
-    for (int i = 32; i < 1024; i++)
+    // Skip tables shared with the kernel directory (see vmm_create_address_space)
+    for (int i = 0; i < 1024; i++)
     {
         uint32_t entry = pd->tablesPhysical[i];
+        if (vmm_pde_is_kernel(pd, i))
+            continue;
 
         if (entry & I86_PTE_PRESENT)
         {
@@ -96,7 +158,8 @@ void vmm_free_address_space(page_directory_t *pd)
                 uint32_t pt_entry = pt_phys[j];
 
                 // Only free if Present and NOT a kernel page (sanity check)
-                if ((pt_entry & I86_PTE_PRESENT) && (pt_entry & I86_PTE_USER))
+                // Shared frames belong to their owner (see elf.c image cache)
+                if ((pt_entry & I86_PTE_PRESENT) && (pt_entry & I86_PTE_USER) && !(pt_entry & I86_PTE_SHARED))
                 {
                     void *frame = (void *)(pt_entry & 0xFFFFF000);
                     pmm_free_block(frame);
@@ -106,7 +169,14 @@ void vmm_free_address_space(page_directory_t *pd)
             // 3. Free the Page Table itself
             pmm_free_block(pt_phys);
         }
+        pd->tablesPhysical[i] = kernel_directory->tablesPhysical[i];
     }
+}
+
+// --- FIX: Added Cleanup Function ---
+void vmm_free_address_space(page_directory_t *pd)
+{
+    vmm_clear_user_space(pd);
     // 4. Free the Directory itself
     pmm_free_block(pd);
 }
@@ -8,8 +8,11 @@
 #define I86_PTE_PRESENT 0x1
 #define I86_PTE_WRITABLE 0x2
 #define I86_PTE_USER 0x4
+#define I86_PTE_PCD 0x10 // Cache disable (MMIO)
 #define I86_PTE_ACCESSED 0x20
 #define I86_PTE_DIRTY 0x40
+#define I86_PTE_SHARED 0x200 // AVL bit: frame is owned elsewhere (e.g. ELF image cache), never freed with the address space
+#define I86_PTE_COW 0x400    // AVL bit: read-only shared frame, copied on the first write (with I86_PTE_SHARED)
 
 #define PAGE_SIZE 4096
 
@@ -27,10 +30,15 @@ void vmm_flush_tlb_entry(void *addr);
 
 // --- Multi-Process Support ---
 page_directory_t *vmm_create_address_space();
+void vmm_clear_user_space(page_directory_t *pd);
+int vmm_pde_is_kernel(page_directory_t *pd, uint32_t i);     // PDE i shares the kernel's table
+void vmm_free_address_space(page_directory_t *pd);
 void vmm_map_page_in_dir(page_directory_t *dir, void *phys, void *virt, int flags);
 void vmm_switch_directory(page_directory_t *dir);
 page_directory_t *vmm_get_current_directory();
 void *vmm_get_phys(uint32_t virt); // Helper for debugging
+uint32_t vmm_get_pte_in_dir(page_directory_t *dir, void *virt); // Raw PTE, 0 if unmapped
+int vmm_handle_cow_fault(uint32_t addr, uint32_t err_code);     // 1 if the fault was resolved
 
 // Assembly Helpers
 extern void vmm_load_pd(uint32_t *addr);